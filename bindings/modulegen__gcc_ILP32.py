@@ -284,6 +284,10 @@ def register_types(module):
     module.add_enum('EncapsulationMode', ['ILLEGAL', 'DIX', 'LLC'], outer_class=root_module['ns3::CsmaNetDevice'], import_from_module='ns.csma')
     ## ethernet-net-device.h (module 'ethernet'): ns3::EthernetNetDevice [class]
     module.add_class('EthernetNetDevice', parent=root_module['ns3::NetDevice'])
+    ## ethernet-stats-buffer.h (module 'ethernet'): ns3::EthernetStatsBuffer [class]
+    module.add_class('EthernetStatsBuffer', parent=root_module['ns3::Object'])
+    ## ethernet-stats-buffer.h (module 'ethernet'): ns3::EthernetStatsBuffer::Field [enumeration]
+    module.add_enum('Field', ['TX_FRAMES', 'TX_BYTES', 'TX_DROPS', 'RX_FRAMES', 'RX_BYTES', 'RX_DROPS', 'QUEUE_FRAMES', 'QUEUE_BYTES', 'N_FIELDS'], outer_class=root_module['ns3::EthernetStatsBuffer'])
     
     ## Register a nested module for the namespace FatalImpl
     
@@ -416,6 +420,7 @@ def register_methods(root_module):
     register_Ns3AddressValue_methods(root_module, root_module['ns3::AddressValue'])
     register_Ns3CsmaNetDevice_methods(root_module, root_module['ns3::CsmaNetDevice'])
     register_Ns3EthernetNetDevice_methods(root_module, root_module['ns3::EthernetNetDevice'])
+    register_Ns3EthernetStatsBuffer_methods(root_module, root_module['ns3::EthernetStatsBuffer'])
     return
 
 def register_Ns3Address_methods(root_module, cls):
@@ -2798,6 +2803,14 @@ def register_Ns3EthernetHelper_methods(root_module, cls):
     cls.add_method('Install', 
                    'ns3::NetDeviceContainer', 
                    [param('std::string', 'aNode'), param('std::string', 'bNode')])
+    ## ethernet-helper.h (module 'ethernet'): ns3::NetDeviceContainer ns3::EthernetHelper::Install(ns3::NodeContainer a, ns3::NodeContainer b) [member function]
+    cls.add_method('Install', 
+                   'ns3::NetDeviceContainer', 
+                   [param('ns3::NodeContainer', 'a'), param('ns3::NodeContainer', 'b')])
+    ## ethernet-helper.h (module 'ethernet'): ns3::Ptr<ns3::EthernetStatsBuffer> ns3::EthernetHelper::CreateStatsBuffer(ns3::NetDeviceContainer c) [member function]
+    cls.add_method('CreateStatsBuffer', 
+                   'ns3::Ptr< ns3::EthernetStatsBuffer >', 
+                   [param('ns3::NetDeviceContainer', 'c')])
     ## ethernet-helper.h (module 'ethernet'): void ns3::EthernetHelper::SetChannelAttribute(std::string name, ns3::AttributeValue const & value) [member function]
     cls.add_method('SetChannelAttribute', 
                    'void', 
@@ -4866,6 +4879,16 @@ def register_Ns3EthernetNetDevice_methods(root_module, cls):
                    is_static=True)
     ## ethernet-net-device.h (module 'ethernet'): ns3::EthernetNetDevice::EthernetNetDevice() [constructor]
     cls.add_constructor([])
+    ## ethernet-net-device.h (module 'ethernet'): uint64_t ns3::EthernetNetDevice::GetNReceivedFrames() const [member function]
+    cls.add_method('GetNReceivedFrames', 
+                   'uint64_t', 
+                   [], 
+                   is_const=True)
+    ## ethernet-net-device.h (module 'ethernet'): uint64_t ns3::EthernetNetDevice::GetNReceivedBytes() const [member function]
+    cls.add_method('GetNReceivedBytes', 
+                   'uint64_t', 
+                   [], 
+                   is_const=True)
     ## ethernet-net-device.h (module 'ethernet'): bool ns3::EthernetNetDevice::SetMac48Address(ns3::Mac48Address address) [member function]
     cls.add_method('SetMac48Address', 
                    'bool', 
@@ -5042,6 +5065,51 @@ def register_Ns3EthernetNetDevice_methods(root_module, cls):
                    visibility='protected', is_virtual=True)
     return
 
+def register_Ns3EthernetStatsBuffer_methods(root_module, cls):
+    ## ethernet-stats-buffer.h (module 'ethernet'): ns3::EthernetStatsBuffer::EthernetStatsBuffer(ns3::EthernetStatsBuffer const & arg0) [copy constructor]
+    cls.add_constructor([param('ns3::EthernetStatsBuffer const &', 'arg0')])
+    ## ethernet-stats-buffer.h (module 'ethernet'): ns3::EthernetStatsBuffer::EthernetStatsBuffer() [constructor]
+    cls.add_constructor([])
+    ## ethernet-stats-buffer.h (module 'ethernet'): static ns3::TypeId ns3::EthernetStatsBuffer::GetTypeId() [member function]
+    cls.add_method('GetTypeId', 
+                   'ns3::TypeId', 
+                   [], 
+                   is_static=True)
+    ## ethernet-stats-buffer.h (module 'ethernet'): void ns3::EthernetStatsBuffer::SetDevices(ns3::NetDeviceContainer c) [member function]
+    cls.add_method('SetDevices', 
+                   'void', 
+                   [param('ns3::NetDeviceContainer', 'c')])
+    ## ethernet-stats-buffer.h (module 'ethernet'): void ns3::EthernetStatsBuffer::Update() [member function]
+    cls.add_method('Update', 
+                   'void', 
+                   [])
+    ## ethernet-stats-buffer.h (module 'ethernet'): uint32_t ns3::EthernetStatsBuffer::GetNDevices() const [member function]
+    cls.add_method('GetNDevices', 
+                   'uint32_t', 
+                   [], 
+                   is_const=True)
+    ## ethernet-stats-buffer.h (module 'ethernet'): uint32_t ns3::EthernetStatsBuffer::GetNFields() const [member function]
+    cls.add_method('GetNFields', 
+                   'uint32_t', 
+                   [], 
+                   is_const=True)
+    ## ethernet-stats-buffer.h (module 'ethernet'): uint64_t ns3::EthernetStatsBuffer::Get(uint32_t device, ns3::EthernetStatsBuffer::Field field) const [member function]
+    cls.add_method('Get', 
+                   'uint64_t', 
+                   [param('uint32_t', 'device'), param('ns3::EthernetStatsBuffer::Field', 'field')], 
+                   is_const=True)
+    ## ethernet-stats-buffer.h (module 'ethernet'): uint32_t ns3::EthernetStatsBuffer::GetBufferSize() const [member function]
+    cls.add_method('GetBufferSize', 
+                   'uint32_t', 
+                   [], 
+                   is_const=True)
+    ## ethernet-stats-buffer.h (module 'ethernet'): void ns3::EthernetStatsBuffer::DoDispose() [member function]
+    cls.add_method('DoDispose', 
+                   'void', 
+                   [], 
+                   visibility='protected', is_virtual=True)
+    return
+
 def register_functions(root_module):
     module = root_module
     register_functions_ns3_FatalImpl(module.get_submodule('FatalImpl'), root_module)
@@ -0,0 +1,66 @@
+def post_register_types(root_module):
+    ## EthernetStatsBuffer::GetBuffer returns a raw pointer, which pybindgen
+    ## cannot wrap; give the wrapper type the buffer protocol instead, and
+    ## have GetBuffer return a read-only view of the wrapper itself, so
+    ## numpy.frombuffer can view the counters without copying them and the
+    ## view keeps the object alive.
+    cls = root_module['ns3::EthernetStatsBuffer']
+    cls.add_custom_method_wrapper('GetBuffer', '_wrap_EthernetStatsBuffer_GetBuffer',
+                                  flags=['METH_NOARGS'],
+                                  wrapper_body='''
+#if PY_VERSION_HEX >= 0x03000000
+static int
+_EthernetStatsBuffer_getbuffer (PyObject *obj, Py_buffer *view, int flags)
+{
+    PyNs3EthernetStatsBuffer *self = (PyNs3EthernetStatsBuffer *) obj;
+    return PyBuffer_FillInfo (view, obj, (void *) self->obj->GetBuffer (),
+                              self->obj->GetBufferSize (), 1, flags);
+}
+
+static PyBufferProcs _EthernetStatsBuffer_as_buffer = {
+    _EthernetStatsBuffer_getbuffer,
+    0
+};
+#else
+static Py_ssize_t
+_EthernetStatsBuffer_getreadbuffer (PyObject *obj, Py_ssize_t segment, void **ptr)
+{
+    PyNs3EthernetStatsBuffer *self = (PyNs3EthernetStatsBuffer *) obj;
+    if (segment != 0) {
+        PyErr_SetString (PyExc_SystemError, "accessing non-existent buffer segment");
+        return -1;
+    }
+    *ptr = (void *) self->obj->GetBuffer ();
+    return self->obj->GetBufferSize ();
+}
+
+static Py_ssize_t
+_EthernetStatsBuffer_getsegcount (PyObject *obj, Py_ssize_t *len)
+{
+    PyNs3EthernetStatsBuffer *self = (PyNs3EthernetStatsBuffer *) obj;
+    if (len) {
+        *len = self->obj->GetBufferSize ();
+    }
+    return 1;
+}
+
+static PyBufferProcs _EthernetStatsBuffer_as_buffer = {
+    _EthernetStatsBuffer_getreadbuffer,
+    0,
+    _EthernetStatsBuffer_getsegcount,
+    0
+};
+#endif
+
+static PyObject *
+_wrap_EthernetStatsBuffer_GetBuffer (PyNs3EthernetStatsBuffer *self)
+{
+#if PY_VERSION_HEX >= 0x03000000
+    return PyMemoryView_FromObject ((PyObject *) self);
+#else
+    return PyBuffer_FromObject ((PyObject *) self, 0, Py_END_OF_BUFFER);
+#endif
+}
+''')
+    root_module.before_init.write_code(
+        'PyNs3EthernetStatsBuffer_Type.tp_as_buffer = &_EthernetStatsBuffer_as_buffer;')
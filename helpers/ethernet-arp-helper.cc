@@ -0,0 +1,144 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/object-vector.h"
+#include "ns3/ipv4.h"
+#include "ns3/arp-cache.h"
+#include "ns3/arp-l3-protocol.h"
+#include "ns3/ethernet-helper.h"
+#include "ethernet-arp-helper.h"
+
+NS_LOG_COMPONENT_DEFINE ("EthernetArpHelper");
+
+namespace ns3 {
+
+namespace {
+
+Ptr<ArpCache>
+FindArpCache (Ptr<NetDevice> device)
+{
+  Ptr<ArpL3Protocol> arp = device->GetNode ()->GetObject<ArpL3Protocol> ();
+  if (arp == 0)
+    {
+      return 0;
+    }
+  ObjectVectorValue caches;
+  arp->GetAttribute ("CacheList", caches);
+  for (uint32_t i = 0; i < caches.GetN (); ++i)
+    {
+      Ptr<ArpCache> cache = caches.Get (i)->GetObject<ArpCache> ();
+      if (cache->GetDevice () == device)
+        {
+          return cache;
+        }
+    }
+  return 0;
+}
+
+void
+AddArpEntries (Ptr<NetDevice> device, NetDeviceContainer neighbors, bool enableExpiry)
+{
+  Ptr<Ipv4> ipv4 = device->GetNode ()->GetObject<Ipv4> ();
+  Ptr<ArpCache> cache = FindArpCache (device);
+  if (ipv4 == 0 || cache == 0)
+    {
+      return;
+    }
+  int32_t interface = ipv4->GetInterfaceForDevice (device);
+  if (interface < 0)
+    {
+      return;
+    }
+  if (!enableExpiry)
+    {
+      cache->SetAliveTimeout (Simulator::GetMaximumSimulationTime ());
+    }
+
+  for (NetDeviceContainer::Iterator i = neighbors.Begin (); i != neighbors.End (); ++i)
+    {
+      Ptr<Ipv4> neighborIpv4 = (*i)->GetNode ()->GetObject<Ipv4> ();
+      if (*i == device || neighborIpv4 == 0)
+        {
+          continue;
+        }
+      int32_t neighborInterface = neighborIpv4->GetInterfaceForDevice (*i);
+      if (neighborInterface < 0)
+        {
+          continue;
+        }
+      for (uint32_t j = 0; j < neighborIpv4->GetNAddresses (neighborInterface); ++j)
+        {
+          Ipv4Address address = neighborIpv4->GetAddress (neighborInterface, j).GetLocal ();
+          for (uint32_t k = 0; k < ipv4->GetNAddresses (interface); ++k)
+            {
+              Ipv4InterfaceAddress local = ipv4->GetAddress (interface, k);
+              if (!local.GetMask ().IsMatch (local.GetLocal (), address))
+                {
+                  continue;
+                }
+              ArpCache::Entry *entry = cache->Lookup (address);
+              if (entry == 0)
+                {
+                  entry = cache->Add (address);
+                }
+              if (!entry->IsWaitReply ())
+                {
+                  //
+                  // ArpCache has no static entries: an entry comes alive
+                  // only the way ArpL3Protocol brings it, when the reply
+                  // it waits for arrives.  Nothing is sent meanwhile.
+                  //
+                  entry->MarkWaitReply (0);
+                  entry->MarkAlive ((*i)->GetAddress ());
+                  entry->DequeuePending ();
+                }
+              break;
+            }
+        }
+    }
+}
+
+} // anonymous namespace
+
+void
+EthernetArpHelper::PopulateArpCaches (bool enableExpiry)
+{
+  NS_LOG_FUNCTION (enableExpiry);
+  std::vector<NetDeviceContainer> domains = EthernetHelper::GetLayer2Domains ();
+  for (std::vector<NetDeviceContainer>::iterator i = domains.begin (); i != domains.end (); ++i)
+    {
+      PopulateArpCaches (*i, enableExpiry);
+    }
+}
+
+void
+EthernetArpHelper::PopulateArpCaches (NetDeviceContainer c, bool enableExpiry)
+{
+  NS_LOG_FUNCTION (enableExpiry);
+  for (NetDeviceContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      AddArpEntries (*i, c, enableExpiry);
+    }
+}
+
+} // namespace ns3
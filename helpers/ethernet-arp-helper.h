@@ -0,0 +1,63 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_ARP_HELPER_H
+#define ETHERNET_ARP_HELPER_H
+
+#include "ns3/net-device-container.h"
+
+namespace ns3 {
+
+/**
+ * \brief Fill the IPv4 ARP caches of the Ethernet endpoints up front.
+ *
+ * This lives in the ethernet-arp library, built when the internet module
+ * is, so that the ethernet module itself does not depend on it.
+ */
+class EthernetArpHelper
+{
+public:
+  /**
+   * @param enableExpiry let the entries expire, so ARP takes over for
+   *        anything not covered
+   *
+   * Fill the ARP cache of every IPv4 interface on an Ethernet endpoint
+   * with the addresses of the endpoints of the same layer 2 domain (see
+   * EthernetHelper::GetLayer2Domains) and subnet; members of an
+   * ns3::EthernetBondNetDevice use the addresses of the bond.  Together
+   * with EthernetHelper::PopulateForwardingTables, no learning flood or
+   * ARP exchange is then needed.
+   *
+   * Call it once the IPv4 addresses are assigned.  Without enableExpiry
+   * the entries never expire.
+   */
+  static void PopulateArpCaches (bool enableExpiry = false);
+  /**
+   * @param c the devices of one layer 2 domain
+   * @param enableExpiry let the entries expire
+   *
+   * Same as above for the devices of c only.
+   */
+  static void PopulateArpCaches (NetDeviceContainer c, bool enableExpiry = false);
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_ARP_HELPER_H */
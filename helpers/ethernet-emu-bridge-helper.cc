@@ -0,0 +1,79 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include "ns3/abort.h"
+#include "ns3/string.h"
+#include "ns3/enum.h"
+#include "ns3/ethernet-net-device.h"
+#include "ethernet-emu-bridge-helper.h"
+
+namespace ns3 {
+
+EthernetEmuBridgeHelper::EthernetEmuBridgeHelper ()
+{
+  m_bridgeFactory.SetTypeId ("ns3::EthernetEmuBridge");
+}
+
+void
+EthernetEmuBridgeHelper::SetAttribute (std::string name, const AttributeValue &value)
+{
+  m_bridgeFactory.Set (name, value);
+}
+
+Ptr<EthernetEmuBridge>
+EthernetEmuBridgeHelper::Create (Ptr<NetDevice> device) const
+{
+  Ptr<EthernetNetDevice> ethernet = device->GetObject<EthernetNetDevice> ();
+  NS_ABORT_MSG_IF (ethernet == 0, "EthernetEmuBridgeHelper::Install(): not an EthernetNetDevice");
+  Ptr<EthernetEmuBridge> bridge = m_bridgeFactory.Create<EthernetEmuBridge> ();
+  bridge->SetDevice (ethernet);
+  ethernet->AggregateObject (bridge);
+  return bridge;
+}
+
+Ptr<EthernetEmuBridge>
+EthernetEmuBridgeHelper::Install (Ptr<NetDevice> device, std::string deviceName)
+{
+  Ptr<EthernetEmuBridge> bridge = Create (device);
+  bridge->SetAttribute ("Mode", EnumValue (EthernetEmuBridge::PACKET_MMAP));
+  bridge->SetAttribute ("DeviceName", StringValue (deviceName));
+  bridge->Start ();
+  return bridge;
+}
+
+Ptr<EthernetEmuBridge>
+EthernetEmuBridgeHelper::Install (Ptr<NetDevice> device, int fd)
+{
+  Ptr<EthernetEmuBridge> bridge = Create (device);
+  bridge->SetFileDescriptor (fd);
+  bridge->Start ();
+  return bridge;
+}
+
+Ptr<EthernetEmuBridge>
+EthernetEmuBridgeHelper::InstallSocketPair (Ptr<NetDevice> device, int &peerFd)
+{
+  Ptr<EthernetEmuBridge> bridge = Create (device);
+  peerFd = bridge->CreateSocketPair ();
+  bridge->Start ();
+  return bridge;
+}
+
+} // namespace ns3
@@ -0,0 +1,82 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_EMU_BRIDGE_HELPER_H
+#define ETHERNET_EMU_BRIDGE_HELPER_H
+
+#include <string>
+
+#include "ns3/object-factory.h"
+#include "ns3/net-device.h"
+#include "ns3/ethernet-emu-bridge.h"
+
+namespace ns3 {
+
+/**
+ * \brief Connect Ethernet devices to real interfaces.
+ *
+ * Creates an EthernetEmuBridge for a device, aggregates it to the device
+ * and starts it.  See EthernetEmuBridge for the modes and the need for a
+ * real-time simulator.
+ */
+class EthernetEmuBridgeHelper
+{
+public:
+  EthernetEmuBridgeHelper ();
+
+  /**
+   * Set an attribute on each EthernetEmuBridge created by Install.
+   *
+   * @param name the name of the attribute to set
+   * @param value the value of the attribute to set
+   */
+  void SetAttribute (std::string name, const AttributeValue &value);
+
+  /**
+   * @param device the ns3::EthernetNetDevice standing for the real side
+   *        of its channel
+   * @param deviceName the interface to bind the packet socket to
+   * @return the bridge
+   */
+  Ptr<EthernetEmuBridge> Install (Ptr<NetDevice> device, std::string deviceName);
+  /**
+   * @param device the ns3::EthernetNetDevice standing for the real side
+   *        of its channel
+   * @param fd a datagram or seqpacket socket carrying a frame per message
+   * @return the bridge
+   */
+  Ptr<EthernetEmuBridge> Install (Ptr<NetDevice> device, int fd);
+  /**
+   * @param device the ns3::EthernetNetDevice standing for the real side
+   *        of its channel
+   * @param peerFd set to the socket playing the real side
+   * @return the bridge, on the other socket of a new socket pair
+   */
+  Ptr<EthernetEmuBridge> InstallSocketPair (Ptr<NetDevice> device, int &peerFd);
+
+private:
+  Ptr<EthernetEmuBridge> Create (Ptr<NetDevice> device) const;
+
+  ObjectFactory m_bridgeFactory;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_EMU_BRIDGE_HELPER_H */
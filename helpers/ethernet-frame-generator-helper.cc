@@ -0,0 +1,60 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include "ns3/node.h"
+#include "ns3/ethernet-net-device.h"
+#include "ns3/ethernet-frame-generator.h"
+#include "ethernet-frame-generator-helper.h"
+
+namespace ns3 {
+
+EthernetFrameGeneratorHelper::EthernetFrameGeneratorHelper (Mac48Address destination)
+{
+  m_factory.SetTypeId ("ns3::EthernetFrameGenerator");
+  m_factory.Set ("Destination", Mac48AddressValue (destination));
+}
+
+void
+EthernetFrameGeneratorHelper::SetAttribute (std::string name, const AttributeValue &value)
+{
+  m_factory.Set (name, value);
+}
+
+ApplicationContainer
+EthernetFrameGeneratorHelper::Install (Ptr<NetDevice> device) const
+{
+  Ptr<EthernetFrameGenerator> app = m_factory.Create<EthernetFrameGenerator> ();
+  app->SetDevice (device->GetObject<EthernetNetDevice> ());
+  device->GetNode ()->AddApplication (app);
+  return ApplicationContainer (app);
+}
+
+ApplicationContainer
+EthernetFrameGeneratorHelper::Install (NetDeviceContainer c) const
+{
+  ApplicationContainer apps;
+  for (NetDeviceContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      apps.Add (Install (*i));
+    }
+  return apps;
+}
+
+} // namespace ns3
@@ -0,0 +1,74 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_FRAME_GENERATOR_HELPER_H
+#define ETHERNET_FRAME_GENERATOR_HELPER_H
+
+#include <string>
+
+#include "ns3/object-factory.h"
+#include "ns3/mac48-address.h"
+#include "ns3/application-container.h"
+#include "ns3/net-device-container.h"
+
+namespace ns3 {
+
+/**
+ * \brief Create EthernetFrameGenerator applications on EthernetNetDevices.
+ */
+class EthernetFrameGeneratorHelper
+{
+public:
+  /**
+   * @param destination the destination MAC address of the frames
+   */
+  EthernetFrameGeneratorHelper (Mac48Address destination);
+
+  /**
+   * Set an attribute on each EthernetFrameGenerator created by Install.
+   *
+   * @param name the name of the attribute to set
+   * @param value the value of the attribute to set
+   */
+  void SetAttribute (std::string name, const AttributeValue &value);
+
+  /**
+   * Install a generator on the node of the device, sending through that
+   * device.
+   *
+   * @param device the EthernetNetDevice to send the frames through
+   */
+  ApplicationContainer Install (Ptr<NetDevice> device) const;
+
+  /**
+   * Install a generator for each device of the container.  All of them
+   * send to the same destination.
+   *
+   * @param c the EthernetNetDevices to send the frames through
+   */
+  ApplicationContainer Install (NetDeviceContainer c) const;
+
+private:
+  ObjectFactory m_factory;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_FRAME_GENERATOR_HELPER_H */
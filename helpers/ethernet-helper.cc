@@ -18,6 +18,13 @@
  * Author: Andrey Churin <aachurin@gmail.com>
  */
 
+#include <algorithm>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <set>
+#include <deque>
+
 #include "ns3/abort.h"
 #include "ns3/log.h"
 #include "ns3/simulator.h"
@@ -25,8 +32,24 @@
 #include "ns3/config.h"
 #include "ns3/packet.h"
 #include "ns3/names.h"
+#include "ns3/node-list.h"
+#include "ns3/channel-list.h"
+#include "ns3/string.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "ns3/data-rate.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv6-address.h"
 #include "ns3/ethernet-net-device.h"
 #include "ns3/ethernet-channel.h"
+#include "ns3/ethernet-virtual-function.h"
+#include "ns3/ethernet-queue-sampler.h"
+#include "ns3/ethernet-flow-monitor.h"
+#include "ns3/ethernet-failover-monitor.h"
+#include "ns3/ethernet-stats-buffer.h"
+#include "ns3/ethernet-switch-net-device.h"
+#include "ns3/ethernet-bond-net-device.h"
+#include "ns3/ethernet-snapshot.h"
 
 #include "ns3/trace-helper.h"
 #include "ethernet-helper.h"
@@ -36,10 +59,13 @@ NS_LOG_COMPONENT_DEFINE ("EthernetHelper");
 namespace ns3 {
 
 EthernetHelper::EthernetHelper ()
+  : m_pcapSampling (1),
+    m_pcapSnapLen (65535)
 {
   m_queueFactory.SetTypeId ("ns3::DropTailQueue");
   m_deviceFactory.SetTypeId ("ns3::EthernetNetDevice");
   m_channelFactory.SetTypeId ("ns3::EthernetChannel");
+  m_virtualFunctionFactory.SetTypeId ("ns3::EthernetVirtualFunction");
 }
 
 void 
@@ -68,6 +94,111 @@ EthernetHelper::SetChannelAttribute (std::string n1, const AttributeValue &v1)
   m_channelFactory.Set (n1, v1);
 }
 
+void
+EthernetHelper::SetVirtualFunctionAttribute (std::string n1, const AttributeValue &v1)
+{
+  m_virtualFunctionFactory.Set (n1, v1);
+}
+
+void
+EthernetHelper::SetPcapSampling (uint32_t n)
+{
+  NS_ASSERT (n > 0);
+  m_pcapSampling = n;
+}
+
+void
+EthernetHelper::SetPcapSnapLen (uint32_t snapLen)
+{
+  m_pcapSnapLen = snapLen;
+}
+
+void
+EthernetHelper::SetPcapFilter (const EthernetCaptureFilter &filter)
+{
+  m_pcapFilter = filter;
+}
+
+void
+EthernetHelper::SetSpeedPreset (SpeedPreset speed, uint16_t mtu)
+{
+  NS_LOG_FUNCTION (speed << mtu);
+
+  static const uint64_t GBPS = 1000000000;
+  static const double INTERFRAME_GAP_BITS = 96;
+
+  uint64_t bps = 0;
+  switch (speed)
+    {
+    case SPEED_1G:
+      bps = GBPS;
+      break;
+    case SPEED_10G:
+      bps = 10 * GBPS;
+      break;
+    case SPEED_25G:
+      bps = 25 * GBPS;
+      break;
+    case SPEED_40G:
+      bps = 40 * GBPS;
+      break;
+    case SPEED_100G:
+      bps = 100 * GBPS;
+      break;
+    case SPEED_400G:
+      bps = 400 * GBPS;
+      break;
+    default:
+      NS_FATAL_ERROR ("EthernetHelper::SetSpeedPreset(): unknown speed");
+      break;
+    }
+
+  m_channelFactory.Set ("DataRate", DataRateValue (DataRate (bps)));
+  m_deviceFactory.Set ("InterframeGap", TimeValue (Seconds (INTERFRAME_GAP_BITS / bps)));
+  m_deviceFactory.Set ("AccurateFraming", BooleanValue (true));
+  m_deviceFactory.Set ("Mtu", UintegerValue (mtu));
+}
+
+namespace {
+
+/**
+ * Write the frames matching a filter, one out of every few, to a pcap
+ * file.
+ */
+class PcapCaptureSink : public SimpleRefCount<PcapCaptureSink>
+{
+public:
+  PcapCaptureSink (Ptr<PcapFileWrapper> file, const EthernetCaptureFilter &filter, uint32_t sampling)
+    : m_file (file),
+      m_filter (filter),
+      m_sampling (sampling),
+      m_count (0)
+  {
+  }
+
+  void Capture (Ptr<const Packet> packet)
+  {
+    if (!m_filter.Match (packet))
+      {
+        return;
+      }
+    if (++m_count < m_sampling)
+      {
+        return;
+      }
+    m_count = 0;
+    m_file->Write (Simulator::Now (), packet);
+  }
+
+private:
+  Ptr<PcapFileWrapper> m_file;
+  EthernetCaptureFilter m_filter;
+  uint32_t m_sampling;
+  uint32_t m_count;
+};
+
+} // anonymous namespace
+
 void 
 EthernetHelper::EnablePcapInternal (std::string prefix, Ptr<NetDevice> nd, bool promiscuous, bool explicitFilename)
 {
@@ -89,8 +220,18 @@ EthernetHelper::EnablePcapInternal (std::string prefix, Ptr<NetDevice> nd, bool
       filename = pcapHelper.GetFilenameFromDevice (prefix, device);
     }
 
-  Ptr<PcapFileWrapper> file = pcapHelper.CreateFile (filename, std::ios::out, PcapHelper::DLT_EN10MB);
-  pcapHelper.HookDefaultSink<EthernetNetDevice> (device, "PromiscSniffer", file);
+  //
+  // The file writes at most snapLen bytes of each frame.
+  //
+  Ptr<PcapFileWrapper> file = pcapHelper.CreateFile (filename, std::ios::out, PcapHelper::DLT_EN10MB, m_pcapSnapLen);
+  std::string traceName = promiscuous ? "PromiscSniffer" : "Sniffer";
+  if (m_pcapSampling == 1 && m_pcapFilter.IsEmpty ())
+    {
+      pcapHelper.HookDefaultSink<EthernetNetDevice> (device, traceName, file);
+      return;
+    }
+  Ptr<PcapCaptureSink> sink = Create<PcapCaptureSink> (file, m_pcapFilter, m_pcapSampling);
+  device->TraceConnectWithoutContext (traceName, MakeCallback (&PcapCaptureSink::Capture, sink));
 }
 
 void 
@@ -253,4 +394,721 @@ EthernetHelper::Install (std::string aName, std::string bName)
   return Install (a, b);
 }
 
+NetDeviceContainer
+EthernetHelper::Install (NodeContainer a, NodeContainer b)
+{
+  NS_ABORT_MSG_IF (a.GetN () != b.GetN (), "EthernetHelper::Install(): containers of different sizes");
+  NetDeviceContainer container;
+  for (uint32_t i = 0; i < a.GetN (); ++i)
+    {
+      container.Add (Install (a.Get (i), b.Get (i)));
+    }
+  return container;
+}
+
+NetDeviceContainer
+EthernetHelper::InstallVirtualFunctions (Ptr<NetDevice> device, NodeContainer c)
+{
+  Ptr<EthernetNetDevice> physical = device->GetObject<EthernetNetDevice> ();
+  NS_ABORT_MSG_IF (physical == 0, "EthernetHelper::InstallVirtualFunctions(): not an EthernetNetDevice");
+
+  NetDeviceContainer container;
+  for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      Ptr<EthernetVirtualFunction> vf = m_virtualFunctionFactory.Create<EthernetVirtualFunction> ();
+      vf->SetAddress (Mac48Address::Allocate ());
+      (*i)->AddDevice (vf);
+      physical->AddVirtualFunction (vf);
+      container.Add (vf);
+    }
+  return container;
+}
+
+void
+EthernetHelper::EnableLatencyHistograms (NetDeviceContainer c)
+{
+  for (NetDeviceContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      Ptr<EthernetNetDevice> device = (*i)->GetObject<EthernetNetDevice> ();
+      if (device != 0)
+        {
+          device->SetLatencyHistograms (true);
+        }
+    }
+}
+
+void
+EthernetHelper::PrintLatencyHistograms (std::ostream &os)
+{
+  static const char *names[] = { "queueing", "transmission", "link", "end-to-end" };
+
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); ++i)
+    {
+      Ptr<Node> node = *i;
+      for (uint32_t j = 0; j < node->GetNDevices (); ++j)
+        {
+          Ptr<EthernetNetDevice> device = node->GetDevice (j)->GetObject<EthernetNetDevice> ();
+          if (device == 0 || !device->GetLatencyHistograms ())
+            {
+              continue;
+            }
+          for (uint32_t k = 0; k < sizeof (names) / sizeof (names[0]); ++k)
+            {
+              os << "/NodeList/" << node->GetId () << "/DeviceList/" << j << " " << names[k] << " ";
+              device->GetLatencyHistogram (EthernetNetDevice::LatencyInterval (k)).Print (os);
+              os << std::endl;
+            }
+        }
+    }
+}
+
+//
+// The records of a snapshot file: the kind of device, its node and index,
+// and the length of the state that follows.
+//
+enum SnapshotRecord
+{
+  SNAPSHOT_END = 0,
+  SNAPSHOT_NET_DEVICE = 1,
+  SNAPSHOT_VIRTUAL_FUNCTION = 2,
+  SNAPSHOT_SWITCH = 3,
+  SNAPSHOT_CHANNEL = 4
+};
+
+void
+EthernetHelper::SaveSnapshot (std::string filename)
+{
+  NS_LOG_FUNCTION (filename);
+
+  std::ofstream os (filename.c_str (), std::ios::binary | std::ios::trunc);
+  NS_ABORT_MSG_UNLESS (os, "EthernetHelper::SaveSnapshot(): cannot open " << filename);
+  os.write ("ECS2", 4);
+  EthernetSnapshotWriter file (os);
+
+  //
+  // The channels come first, so that the devices are restored on links
+  // already in their saved state.  Their records carry the channel index
+  // in place of the node id.
+  //
+  for (uint32_t i = 0; i < ChannelList::GetNChannels (); ++i)
+    {
+      Ptr<EthernetChannel> channel = ChannelList::GetChannel (i)->GetObject<EthernetChannel> ();
+      if (channel == 0)
+        {
+          continue;
+        }
+      std::ostringstream state;
+      EthernetSnapshotWriter writer (state);
+      channel->SaveState (writer);
+      std::string bytes = state.str ();
+      file.WriteU8 (SNAPSHOT_CHANNEL);
+      file.WriteU32 (i);
+      file.WriteU32 (0);
+      file.WriteU32 (bytes.size ());
+      os.write (bytes.data (), bytes.size ());
+    }
+
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); ++i)
+    {
+      Ptr<Node> node = *i;
+      for (uint32_t j = 0; j < node->GetNDevices (); ++j)
+        {
+          Ptr<NetDevice> device = node->GetDevice (j);
+          std::ostringstream state;
+          EthernetSnapshotWriter writer (state);
+          uint8_t kind;
+          if (Ptr<EthernetNetDevice> ethernet = device->GetObject<EthernetNetDevice> ())
+            {
+              kind = SNAPSHOT_NET_DEVICE;
+              ethernet->SaveState (writer);
+            }
+          else if (Ptr<EthernetVirtualFunction> function = device->GetObject<EthernetVirtualFunction> ())
+            {
+              kind = SNAPSHOT_VIRTUAL_FUNCTION;
+              function->SaveState (writer);
+            }
+          else if (Ptr<EthernetSwitchNetDevice> sw = device->GetObject<EthernetSwitchNetDevice> ())
+            {
+              kind = SNAPSHOT_SWITCH;
+              sw->SaveState (writer);
+            }
+          else
+            {
+              continue;
+            }
+          std::string bytes = state.str ();
+          file.WriteU8 (kind);
+          file.WriteU32 (node->GetId ());
+          file.WriteU32 (j);
+          file.WriteU32 (bytes.size ());
+          os.write (bytes.data (), bytes.size ());
+        }
+    }
+  file.WriteU8 (SNAPSHOT_END);
+  NS_ABORT_MSG_UNLESS (os, "EthernetHelper::SaveSnapshot(): cannot write " << filename);
+}
+
+void
+EthernetHelper::RestoreSnapshot (std::string filename)
+{
+  NS_LOG_FUNCTION (filename);
+
+  std::ifstream is (filename.c_str (), std::ios::binary);
+  NS_ABORT_MSG_UNLESS (is, "EthernetHelper::RestoreSnapshot(): cannot open " << filename);
+  char magic[4];
+  is.read (magic, 4);
+  NS_ABORT_MSG_UNLESS (is && std::string (magic, 4) == "ECS2",
+                       "EthernetHelper::RestoreSnapshot(): " << filename << " is not an Ethernet snapshot");
+  EthernetSnapshotReader file (is);
+
+  for (uint8_t kind = file.ReadU8 (); kind != SNAPSHOT_END; kind = file.ReadU8 ())
+    {
+      uint32_t nodeId = file.ReadU32 ();
+      uint32_t index = file.ReadU32 ();
+      std::string bytes (file.ReadU32 (), '\0');
+      is.read (&bytes[0], bytes.size ());
+      NS_ABORT_MSG_UNLESS (is, "EthernetHelper::RestoreSnapshot(): " << filename << " is truncated");
+      if (kind == SNAPSHOT_CHANNEL)
+        {
+          Ptr<EthernetChannel> channel = nodeId < ChannelList::GetNChannels () ?
+            ChannelList::GetChannel (nodeId)->GetObject<EthernetChannel> () : 0;
+          NS_ABORT_MSG_IF (channel == 0, "EthernetHelper::RestoreSnapshot(): channel " << nodeId
+                           << " does not match the snapshot");
+          std::istringstream state (bytes);
+          EthernetSnapshotReader reader (state);
+          channel->RestoreState (reader);
+          continue;
+        }
+      NS_ABORT_MSG_IF (nodeId >= NodeList::GetNNodes () || index >= NodeList::GetNode (nodeId)->GetNDevices (),
+                       "EthernetHelper::RestoreSnapshot(): no device " << index << " on node " << nodeId);
+
+      Ptr<NetDevice> device = NodeList::GetNode (nodeId)->GetDevice (index);
+      std::istringstream state (bytes);
+      EthernetSnapshotReader reader (state);
+      Ptr<EthernetNetDevice> ethernet = device->GetObject<EthernetNetDevice> ();
+      Ptr<EthernetVirtualFunction> function = device->GetObject<EthernetVirtualFunction> ();
+      Ptr<EthernetSwitchNetDevice> sw = device->GetObject<EthernetSwitchNetDevice> ();
+      if (kind == SNAPSHOT_NET_DEVICE && ethernet != 0)
+        {
+          ethernet->RestoreState (reader);
+        }
+      else if (kind == SNAPSHOT_VIRTUAL_FUNCTION && function != 0)
+        {
+          function->RestoreState (reader);
+        }
+      else if (kind == SNAPSHOT_SWITCH && sw != 0)
+        {
+          sw->RestoreState (reader);
+        }
+      else
+        {
+          NS_FATAL_ERROR ("EthernetHelper::RestoreSnapshot(): device " << index << " on node " << nodeId
+                          << " does not match the snapshot");
+        }
+    }
+}
+
+void
+EthernetHelper::EnableQueueSampler (std::string prefix, NetDeviceContainer c, Time interval)
+{
+  for (NetDeviceContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      Ptr<EthernetNetDevice> device = (*i)->GetObject<EthernetNetDevice> ();
+      if (device == 0)
+        {
+          continue;
+        }
+      std::ostringstream oss;
+      oss << prefix << "-" << device->GetNode ()->GetId () << "-" << device->GetIfIndex () << ".eqs";
+
+      Ptr<EthernetQueueSampler> sampler = CreateObject<EthernetQueueSampler> ();
+      sampler->SetAttribute ("Filename", StringValue (oss.str ()));
+      sampler->SetAttribute ("Interval", TimeValue (interval));
+      sampler->SetQueue (device->GetQueue ());
+      device->AggregateObject (sampler);
+      sampler->Start ();
+      Simulator::ScheduleDestroy (&EthernetQueueSampler::Flush, sampler);
+    }
+}
+
+Ptr<EthernetFlowMonitor>
+EthernetHelper::EnableFlowMonitor (NetDeviceContainer c)
+{
+  Ptr<EthernetFlowMonitor> monitor = CreateObject<EthernetFlowMonitor> ();
+  for (NetDeviceContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      Ptr<EthernetNetDevice> device = (*i)->GetObject<EthernetNetDevice> ();
+      if (device != 0)
+        {
+          monitor->Install (device);
+        }
+    }
+  return monitor;
+}
+
+Ptr<EthernetFailoverMonitor>
+EthernetHelper::EnableFailoverMonitor (Ptr<EthernetChannel> channel, NetDeviceContainer c)
+{
+  Ptr<EthernetFailoverMonitor> monitor = CreateObject<EthernetFailoverMonitor> ();
+  monitor->WatchChannel (channel);
+  for (NetDeviceContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      monitor->WatchDevice (*i);
+    }
+  return monitor;
+}
+
+Ptr<EthernetStatsBuffer>
+EthernetHelper::CreateStatsBuffer (NetDeviceContainer c)
+{
+  Ptr<EthernetStatsBuffer> stats = CreateObject<EthernetStatsBuffer> ();
+  stats->SetDevices (c);
+  return stats;
+}
+
+namespace {
+
+typedef std::map<Ptr<NetDevice>, Ptr<EthernetSwitchNetDevice> > PortMap;
+typedef std::map<Ptr<NetDevice>, Ptr<NetDevice> > BondMap;
+
+/**
+ * @return the device carrying the IPv4 interface of a device: its bond if
+ * it is a bond member, the device itself otherwise
+ */
+Ptr<NetDevice>
+GetL3Device (Ptr<NetDevice> device, const BondMap &bonds)
+{
+  BondMap::const_iterator i = bonds.find (device);
+  return i == bonds.end () ? device : i->second;
+}
+
+/**
+ * @return the device at the other end of the Ethernet link of a device, or
+ * 0 if it is not an attached EthernetNetDevice
+ */
+Ptr<NetDevice>
+GetPeer (Ptr<NetDevice> device)
+{
+  Ptr<EthernetChannel> channel = DynamicCast<EthernetChannel> (device->GetChannel ());
+  if (channel == 0 || channel->GetNDevices () != 2)
+    {
+      return 0;
+    }
+  return channel->GetDevice (0) == device ? channel->GetDevice (1) : channel->GetDevice (0);
+}
+
+/**
+ * Join or leave a group on the multicast filter of a device, or of each
+ * member of a bond.
+ */
+void
+ProgramMulticastFilter (Ptr<NetDevice> device, Mac48Address group, bool join)
+{
+  std::vector<Ptr<NetDevice> > devices;
+  Ptr<EthernetBondNetDevice> bond = device->GetObject<EthernetBondNetDevice> ();
+  if (bond != 0)
+    {
+      for (uint32_t i = 0; i < bond->GetNMembers (); ++i)
+        {
+          devices.push_back (bond->GetMember (i));
+        }
+    }
+  else
+    {
+      devices.push_back (device);
+    }
+
+  for (std::vector<Ptr<NetDevice> >::iterator i = devices.begin (); i != devices.end (); ++i)
+    {
+      Ptr<EthernetNetDevice> ethernet = (*i)->GetObject<EthernetNetDevice> ();
+      NS_ABORT_MSG_IF (ethernet == 0, "EthernetHelper: not an Ethernet device");
+      if (join)
+        {
+          ethernet->JoinGroup (group);
+        }
+      else
+        {
+          ethernet->LeaveGroup (group);
+        }
+    }
+}
+
+uint16_t
+InternetChecksum (const uint8_t *data, uint32_t size, uint32_t sum = 0)
+{
+  for (uint32_t i = 0; i + 1 < size; i += 2)
+    {
+      sum += (data[i] << 8) | data[i + 1];
+    }
+  if (size & 1)
+    {
+      sum += data[size - 1] << 8;
+    }
+  while (sum >> 16)
+    {
+      sum = (sum & 0xffff) + (sum >> 16);
+    }
+  return ~sum & 0xffff;
+}
+
+void
+SendIgmp (Ptr<NetDevice> device, Ipv4Address group, Ipv4Address source, bool join)
+{
+  static const uint8_t V2_REPORT = 0x16;
+  static const uint8_t V2_LEAVE = 0x17;
+  static const uint8_t IGMP_PROT_NUMBER = 2;
+  static const uint16_t IPV4_PROT_NUMBER = 0x0800;
+  static const uint32_t IGMP_SIZE = 8;
+
+  //
+  // IPv4 header, IGMPv2 message.  Leaves go to all-routers, reports to
+  // the group itself.
+  //
+  uint8_t frame[20 + IGMP_SIZE] = { 0 };
+  Ipv4Address destination = join ? group : Ipv4Address ("224.0.0.2");
+  frame[0] = 0x45;
+  frame[3] = sizeof (frame);
+  frame[8] = 1;
+  frame[9] = IGMP_PROT_NUMBER;
+  source.Serialize (frame + 12);
+  destination.Serialize (frame + 16);
+  uint16_t checksum = InternetChecksum (frame, 20);
+  frame[10] = checksum >> 8;
+  frame[11] = checksum & 0xff;
+
+  uint8_t *igmp = frame + 20;
+  igmp[0] = join ? V2_REPORT : V2_LEAVE;
+  group.Serialize (igmp + 4);
+  checksum = InternetChecksum (igmp, IGMP_SIZE);
+  igmp[2] = checksum >> 8;
+  igmp[3] = checksum & 0xff;
+
+  Ptr<Packet> packet = Create<Packet> (frame, sizeof (frame));
+  device->Send (packet, Mac48Address::GetMulticast (destination), IPV4_PROT_NUMBER);
+}
+
+void
+SendMld (Ptr<NetDevice> device, Ipv6Address group, bool join)
+{
+  static const uint8_t V1_REPORT = 131;
+  static const uint8_t V1_DONE = 132;
+  static const uint8_t HOP_BY_HOP_HEADER = 0;
+  static const uint8_t ICMPV6_PROT_NUMBER = 58;
+  static const uint16_t IPV6_PROT_NUMBER = 0x86dd;
+  static const uint32_t MLD_SIZE = 24;
+
+  //
+  // IPv6 header, hop-by-hop options header with the router alert option,
+  // MLDv1 message.  The unspecified address is a valid source when the
+  // interface has no link-local address.
+  //
+  uint8_t frame[40 + 8 + MLD_SIZE] = { 0 };
+  Ipv6Address destination = join ? group : Ipv6Address ("ff02::2");
+  frame[0] = 0x60;
+  frame[5] = 8 + MLD_SIZE;
+  frame[6] = HOP_BY_HOP_HEADER;
+  frame[7] = 1;
+  destination.Serialize (frame + 24);
+
+  uint8_t *options = frame + 40;
+  options[0] = ICMPV6_PROT_NUMBER;
+  options[2] = 5;
+  options[3] = 2;
+  options[6] = 1;
+
+  uint8_t *mld = options + 8;
+  mld[0] = join ? V1_REPORT : V1_DONE;
+  group.Serialize (mld + 8);
+
+  uint32_t sum = 0;
+  for (uint32_t i = 8; i < 40; i += 2)
+    {
+      sum += (frame[i] << 8) | frame[i + 1];
+    }
+  sum += MLD_SIZE + ICMPV6_PROT_NUMBER;
+  uint16_t checksum = InternetChecksum (mld, MLD_SIZE, sum);
+  mld[2] = checksum >> 8;
+  mld[3] = checksum & 0xff;
+
+  Ptr<Packet> packet = Create<Packet> (frame, sizeof (frame));
+  device->Send (packet, Mac48Address::GetMulticast (destination), IPV6_PROT_NUMBER);
+}
+
+/**
+ * Add a device met on a walk to the neighbors, along with the virtual
+ * functions it carries.
+ */
+void
+AddNeighbor (Ptr<NetDevice> device, std::vector<Ptr<NetDevice> > &neighbors)
+{
+  neighbors.push_back (device);
+  Ptr<EthernetNetDevice> physical = device->GetObject<EthernetNetDevice> ();
+  if (physical != 0)
+    {
+      for (uint32_t i = 0; i < physical->GetNVirtualFunctions (); ++i)
+        {
+          neighbors.push_back (physical->GetVirtualFunction (i));
+        }
+    }
+}
+
+/**
+ * Find the switches and which device belongs to which switch or bond;
+ * every other Ethernet device is an endpoint, and so is every switch and
+ * every virtual function.  A bond is a single endpoint: it stands for its
+ * first member.
+ */
+void
+FindEndpoints (PortMap &owners, BondMap &bonds, std::vector<Ptr<EthernetSwitchNetDevice> > &switches,
+               std::vector<Ptr<NetDevice> > &endpoints)
+{
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); ++i)
+    {
+      for (uint32_t j = 0; j < (*i)->GetNDevices (); ++j)
+        {
+          Ptr<EthernetBondNetDevice> bond = (*i)->GetDevice (j)->GetObject<EthernetBondNetDevice> ();
+          if (bond != 0)
+            {
+              for (uint32_t k = 0; k < bond->GetNMembers (); ++k)
+                {
+                  bonds[bond->GetMember (k)] = bond;
+                }
+              continue;
+            }
+          Ptr<EthernetSwitchNetDevice> sw = (*i)->GetDevice (j)->GetObject<EthernetSwitchNetDevice> ();
+          if (sw == 0)
+            {
+              continue;
+            }
+          switches.push_back (sw);
+          endpoints.push_back (sw);
+          for (uint32_t k = 0; k < sw->GetNSwitchPorts (); ++k)
+            {
+              owners[sw->GetSwitchPort (k)] = sw;
+            }
+        }
+    }
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); ++i)
+    {
+      for (uint32_t j = 0; j < (*i)->GetNDevices (); ++j)
+        {
+          Ptr<NetDevice> device = (*i)->GetDevice (j);
+          Ptr<EthernetVirtualFunction> function = device->GetObject<EthernetVirtualFunction> ();
+          if (function != 0)
+            {
+              if (function->GetPhysicalDevice () != 0)
+                {
+                  endpoints.push_back (device);
+                }
+              continue;
+            }
+          if (device->GetObject<EthernetNetDevice> () == 0 || owners.find (device) != owners.end ())
+            {
+              continue;
+            }
+          BondMap::iterator bond = bonds.find (device);
+          if (bond == bonds.end ()
+              || bond->second->GetObject<EthernetBondNetDevice> ()->GetMember (0) == device)
+            {
+              endpoints.push_back (device);
+            }
+        }
+    }
+}
+
+/**
+ * Walk the topology breadth first from an endpoint, which reaches every
+ * switch over its shortest path; the port it is reached through leads
+ * back to the endpoint.  A bond is walked from all its members at once,
+ * a virtual function from its physical device.
+ *
+ * @param endpoint the endpoint to walk from
+ * @param install whether to give each switch met a static entry for the
+ *        endpoint on that port, the only entry of the switch for it
+ * @param neighbors filled with the devices sharing the layer 2 domain of
+ *        the endpoint: the switches and the endpoints met on the way
+ */
+void
+WalkEndpoint (Ptr<NetDevice> endpoint, const PortMap &owners, const BondMap &bonds, bool install,
+              std::vector<Ptr<NetDevice> > &neighbors)
+{
+  Mac48Address address = Mac48Address::ConvertFrom (endpoint->GetAddress ());
+  std::set<Ptr<EthernetSwitchNetDevice> > visited;
+  std::deque<Ptr<EthernetSwitchNetDevice> > pending;
+
+  std::vector<Ptr<NetDevice> > sources;
+  Ptr<EthernetVirtualFunction> function = endpoint->GetObject<EthernetVirtualFunction> ();
+  BondMap::const_iterator bond = bonds.find (endpoint);
+  if (function != 0)
+    {
+      sources.push_back (function->GetPhysicalDevice ());
+    }
+  else if (bond != bonds.end ())
+    {
+      Ptr<EthernetBondNetDevice> device = bond->second->GetObject<EthernetBondNetDevice> ();
+      for (uint32_t k = 0; k < device->GetNMembers (); ++k)
+        {
+          sources.push_back (device->GetMember (k));
+        }
+    }
+  else
+    {
+      sources.push_back (endpoint);
+    }
+
+  Ptr<EthernetSwitchNetDevice> self = endpoint->GetObject<EthernetSwitchNetDevice> ();
+  if (self != 0)
+    {
+      visited.insert (self);
+      pending.push_back (self);
+    }
+  else
+    {
+      for (std::vector<Ptr<NetDevice> >::iterator source = sources.begin (); source != sources.end (); ++source)
+        {
+          AddNeighbor (*source, neighbors);
+          Ptr<NetDevice> peer = GetPeer (*source);
+          if (peer == 0)
+            {
+              continue;
+            }
+          PortMap::const_iterator owner = owners.find (peer);
+          if (owner == owners.end ())
+            {
+              AddNeighbor (peer, neighbors);
+            }
+          else if (visited.insert (owner->second).second)
+            {
+              if (install)
+                {
+                  owner->second->AddStaticEntry (address, peer);
+                }
+              pending.push_back (owner->second);
+            }
+        }
+    }
+
+  while (!pending.empty ())
+    {
+      Ptr<EthernetSwitchNetDevice> sw = pending.front ();
+      pending.pop_front ();
+      neighbors.push_back (sw);
+      for (uint32_t k = 0; k < sw->GetNSwitchPorts (); ++k)
+        {
+          Ptr<NetDevice> peer = GetPeer (sw->GetSwitchPort (k));
+          if (peer == 0 || std::find (sources.begin (), sources.end (), peer) != sources.end ())
+            {
+              continue;
+            }
+          PortMap::const_iterator owner = owners.find (peer);
+          if (owner == owners.end ())
+            {
+              AddNeighbor (peer, neighbors);
+            }
+          else if (visited.insert (owner->second).second)
+            {
+              if (install)
+                {
+                  owner->second->AddStaticEntry (address, peer);
+                }
+              pending.push_back (owner->second);
+            }
+        }
+    }
+}
+
+} // anonymous namespace
+
+void
+EthernetHelper::PopulateForwardingTables (bool enableLearning)
+{
+  NS_LOG_FUNCTION (enableLearning);
+
+  PortMap owners;
+  BondMap bonds;
+  std::vector<Ptr<EthernetSwitchNetDevice> > switches;
+  std::vector<Ptr<NetDevice> > endpoints;
+  FindEndpoints (owners, bonds, switches, endpoints);
+  for (std::vector<Ptr<EthernetSwitchNetDevice> >::iterator sw = switches.begin (); sw != switches.end (); ++sw)
+    {
+      (*sw)->SetAttribute ("EnableLearning", BooleanValue (enableLearning));
+    }
+  for (std::vector<Ptr<NetDevice> >::iterator e = endpoints.begin (); e != endpoints.end (); ++e)
+    {
+      std::vector<Ptr<NetDevice> > neighbors;
+      WalkEndpoint (*e, owners, bonds, true, neighbors);
+    }
+}
+
+std::vector<NetDeviceContainer>
+EthernetHelper::GetLayer2Domains (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  PortMap owners;
+  BondMap bonds;
+  std::vector<Ptr<EthernetSwitchNetDevice> > switches;
+  std::vector<Ptr<NetDevice> > endpoints;
+  FindEndpoints (owners, bonds, switches, endpoints);
+
+  std::vector<NetDeviceContainer> domains;
+  std::set<Ptr<NetDevice> > assigned;
+  for (std::vector<Ptr<NetDevice> >::iterator e = endpoints.begin (); e != endpoints.end (); ++e)
+    {
+      Ptr<NetDevice> device = GetL3Device (*e, bonds);
+      if (!assigned.insert (device).second)
+        {
+          continue;
+        }
+      std::vector<Ptr<NetDevice> > neighbors;
+      WalkEndpoint (*e, owners, bonds, false, neighbors);
+
+      NetDeviceContainer domain (device);
+      for (std::vector<Ptr<NetDevice> >::iterator n = neighbors.begin (); n != neighbors.end (); ++n)
+        {
+          Ptr<NetDevice> neighbor = GetL3Device (*n, bonds);
+          if (assigned.insert (neighbor).second)
+            {
+              domain.Add (neighbor);
+            }
+        }
+      domains.push_back (domain);
+    }
+  return domains;
+}
+
+void
+EthernetHelper::JoinMulticastGroup (Ptr<NetDevice> device, Ipv4Address group, Ipv4Address source)
+{
+  NS_LOG_FUNCTION (device << group << source);
+  NS_ASSERT (group.IsMulticast ());
+  ProgramMulticastFilter (device, Mac48Address::GetMulticast (group), true);
+  SendIgmp (device, group, source, true);
+}
+
+void
+EthernetHelper::JoinMulticastGroup (Ptr<NetDevice> device, Ipv6Address group)
+{
+  NS_LOG_FUNCTION (device << group);
+  NS_ASSERT (group.IsMulticast ());
+  ProgramMulticastFilter (device, Mac48Address::GetMulticast (group), true);
+  SendMld (device, group, true);
+}
+
+void
+EthernetHelper::LeaveMulticastGroup (Ptr<NetDevice> device, Ipv4Address group, Ipv4Address source)
+{
+  NS_LOG_FUNCTION (device << group << source);
+  ProgramMulticastFilter (device, Mac48Address::GetMulticast (group), false);
+  SendIgmp (device, group, source, false);
+}
+
+void
+EthernetHelper::LeaveMulticastGroup (Ptr<NetDevice> device, Ipv6Address group)
+{
+  NS_LOG_FUNCTION (device << group);
+  ProgramMulticastFilter (device, Mac48Address::GetMulticast (group), false);
+  SendMld (device, group, false);
+}
+
 } // namespace ns3
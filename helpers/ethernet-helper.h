@@ -22,11 +22,16 @@
 #define ETHERNET_HELPER_H
 
 #include <string>
+#include <ostream>
+#include <vector>
 
 #include "ns3/object-factory.h"
 #include "ns3/net-device-container.h"
 #include "ns3/node-container.h"
 #include "ns3/deprecated.h"
+#include "ns3/nstime.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ethernet-capture-filter.h"
 
 #include "ns3/trace-helper.h"
 
@@ -34,7 +39,12 @@ namespace ns3 {
 
 class Queue;
 class NetDevice;
+class EthernetFlowMonitor;
+class EthernetFailoverMonitor;
+class EthernetStatsBuffer;
+class EthernetChannel;
 class Node;
+class Ipv6Address;
 
 /**
  * \brief Build a set of EthernetNetDevice objects
@@ -43,6 +53,19 @@ class Node;
 class EthernetHelper : public PcapHelperForDevice, public AsciiTraceHelperForDevice
 {
 public:
+  /**
+   * The standard Ethernet speeds SetSpeedPreset knows about.
+   */
+  enum SpeedPreset
+    {
+      SPEED_1G,
+      SPEED_10G,
+      SPEED_25G,
+      SPEED_40G,
+      SPEED_100G,
+      SPEED_400G
+    };
+
   /**
    * Create a EthernetHelper to make life easier when creating ethernet networks.
    */
@@ -65,7 +88,9 @@ public:
    * @param v4 the value of the attribute to set on the queue
    *
    * Set the type of queue to create and associated to each
-   * EthernetNetDevice created through EthernetHelper::Install.
+   * EthernetNetDevice created through EthernetHelper::Install.  The
+   * default is ns3::DropTailQueue; ns3::EthernetRingQueue never allocates
+   * and limits the queue in bytes as well.
    */
   void SetQueue (std::string type,
                  std::string n1 = "", const AttributeValue &v1 = EmptyAttributeValue (),
@@ -97,6 +122,58 @@ public:
    */
   void SetChannelAttribute (std::string name, const AttributeValue &value);
 
+  /**
+   * Set an attribute value to be propagated to each virtual function
+   * created by the helper.
+   *
+   * @param name the name of the attribute to set
+   * @param value the value of the attribute to set
+   *
+   * Set these attributes on each ns3::EthernetVirtualFunction created
+   * by EthernetHelper::InstallVirtualFunctions
+   */
+  void SetVirtualFunctionAttribute (std::string name, const AttributeValue &value);
+
+  /**
+   * Configure the channels and devices created from now on for a standard
+   * Ethernet speed: the channel DataRate is the MAC data rate of the
+   * speed (line encoding is below it and does not show), the device
+   * InterframeGap is 96 bit times at that rate, AccurateFraming is on and
+   * the device Mtu is set as given.
+   *
+   * From 100G on a 64-byte frame lasts a few nanoseconds, so use
+   * Time::SetResolution (Time::PS) for the timings to stay exact.
+   *
+   * @param speed the speed of the links
+   * @param mtu the MTU of the devices, e.g. 9000 for jumbo frames
+   */
+  void SetSpeedPreset (SpeedPreset speed, uint16_t mtu = 1500);
+
+  /**
+   * @param n capture one frame out of n, among those the pcap filter
+   *        matches; 1 captures them all
+   *
+   * Applies to the pcap files enabled from now on.
+   */
+  void SetPcapSampling (uint32_t n);
+
+  /**
+   * @param snapLen the number of bytes of each frame written to the pcap
+   *        files, e.g. 128 for the headers only
+   *
+   * Applies to the pcap files enabled from now on.  Frames are truncated
+   * as they are written, only the bytes kept are ever copied.
+   */
+  void SetPcapSnapLen (uint32_t snapLen);
+
+  /**
+   * @param filter the frames to capture
+   *
+   * Applies to the pcap files enabled from now on.  The filter is
+   * evaluated on the headers of each frame before anything is written.
+   */
+  void SetPcapFilter (const EthernetCaptureFilter &filter);
+
   /**
    * @param c a set of nodes
    *
@@ -141,6 +218,184 @@ public:
    */
   NetDeviceContainer Install (std::string aNode, std::string bNode);
 
+  /**
+   * @param a the first node of each link
+   * @param b the second node of each link, as many as in a
+   * @return the devices created, those of a.Get (i) and b.Get (i) at
+   *         indices 2 * i and 2 * i + 1
+   *
+   * Link every node of a with the node of b at the same index, each pair
+   * over its own ns3::EthernetChannel, in a single call.
+   */
+  NetDeviceContainer Install (NodeContainer a, NodeContainer b);
+
+  /**
+   * @param device the ns3::EthernetNetDevice to multiplex the virtual
+   *        functions on
+   * @param c the nodes to give a virtual function, typically the virtual
+   *        machines of the node of the device
+   * @return the virtual functions created, in the order of the nodes
+   *
+   * Create an ns3::EthernetVirtualFunction with a new address on each
+   * node of the container, all of them sharing the channel of device.
+   */
+  NetDeviceContainer InstallVirtualFunctions (Ptr<NetDevice> device, NodeContainer c);
+
+  /**
+   * @param c the devices to record latencies on
+   *
+   * Enable the latency histograms of each ns3::EthernetNetDevice in the
+   * container.  Devices of other types are ignored.
+   */
+  void EnableLatencyHistograms (NetDeviceContainer c);
+
+  /**
+   * @param os the stream to print to
+   *
+   * Print the latency percentiles of every ns3::EthernetNetDevice in the
+   * simulation which has its histograms enabled, one line per device and
+   * interval.  Meant to be called once the simulation has run.
+   */
+  static void PrintLatencyHistograms (std::ostream &os);
+
+  /**
+   * @param prefix filename prefix of the sample files
+   * @param c the devices whose transmit queue is sampled
+   * @param interval the time between samples; zero samples on every
+   *        enqueue and dequeue
+   *
+   * Create an ns3::EthernetQueueSampler for the transmit queue of each
+   * ns3::EthernetNetDevice in the container, aggregate it to the device
+   * and start it.  Samples go to prefix-<node>-<device>.eqs; they are
+   * flushed when the simulator is destroyed, or on demand through the
+   * aggregated sampler.
+   */
+  void EnableQueueSampler (std::string prefix, NetDeviceContainer c, Time interval = Seconds (0));
+
+  /**
+   * @param c the devices to monitor
+   * @return the monitor
+   *
+   * Create an ns3::EthernetFlowMonitor and install it on each
+   * ns3::EthernetNetDevice in the container; the flows seen by all of
+   * them share its table.  Call EthernetFlowMonitor::WriteCsv or
+   * EthernetFlowMonitor::WriteBinary once the simulation has run.
+   */
+  Ptr<EthernetFlowMonitor> EnableFlowMonitor (NetDeviceContainer c);
+
+  /**
+   * @param channel the channel whose failures are measured
+   * @param c the devices receiving the traffic crossing the channel
+   * @return the monitor
+   *
+   * Create an ns3::EthernetFailoverMonitor measuring the outage and the
+   * reconvergence time of the traffic received by the devices each time
+   * the channel fails.  Fail the channel with
+   * EthernetChannel::ScheduleLinkFailure or EthernetChannel::StartFlapping,
+   * and call EthernetFailoverMonitor::Print once the simulation has run.
+   */
+  Ptr<EthernetFailoverMonitor> EnableFailoverMonitor (Ptr<EthernetChannel> channel, NetDeviceContainer c);
+
+  /**
+   * @param c the devices to collect the counters of
+   * @return the buffer, already filled
+   *
+   * Create an ns3::EthernetStatsBuffer holding the counters and the queue
+   * depths of all the devices in one contiguous buffer, which
+   * EthernetStatsBuffer::Update refreshes in a single call.
+   */
+  Ptr<EthernetStatsBuffer> CreateStatsBuffer (NetDeviceContainer c);
+
+  /**
+   * @param filename the file to write the snapshot to
+   *
+   * Save the state of every ns3::EthernetChannel, ns3::EthernetNetDevice,
+   * ns3::EthernetVirtualFunction and ns3::EthernetSwitchNetDevice in the
+   * simulation: the data rates, delays and flapping of the channels, the
+   * frames waiting in the queues of the devices, the shaper tokens, the
+   * link states, and the learned forwarding entries and snooped multicast
+   * memberships of the switches, and the frame counters of the devices.
+   * The frames on the wire, the fragments being reassembled and the
+   * measurements (latency histograms, flow statistics) are not saved.
+   *
+   * The frames in the transmit queue of a device are only known if its
+   * "Snapshots" attribute was set before it queued any; SaveSnapshot
+   * aborts if it finds frames queued otherwise.
+   */
+  static void SaveSnapshot (std::string filename);
+  /**
+   * @param filename the file to read the snapshot from
+   *
+   * Restore the state SaveSnapshot saved on the same topology, built
+   * again and configured the same way, as of now.  The restored frames
+   * are sent again from now on.  Aborts if the topology differs.
+   */
+  static void RestoreSnapshot (std::string filename);
+
+  /**
+   * @param enableLearning keep MAC learning on the switches, as a fallback
+   *        for anything not covered
+   *
+   * Compute static forwarding for every Ethernet topology in the
+   * simulation.  Each ns3::EthernetSwitchNetDevice gets a static entry for
+   * every reachable MAC address (ns3::EthernetNetDevice endpoints, the
+   * ns3::EthernetVirtualFunction devices they carry and the switches
+   * themselves), pointing at the port of the shortest path towards it; a
+   * virtual function gets the port of its physical device.  A bond is a
+   * single endpoint: each switch gets one entry for it, on the port
+   * nearest to any of its members; group the switch ports facing a bond
+   * with EthernetSwitchNetDevice::AddEcmpGroup to spread the traffic
+   * toward it.  No learning flood is then needed; EthernetArpHelper fills
+   * the ARP caches the same way.
+   *
+   * Call it once the switches are installed.  Without enableLearning the
+   * switches stop learning.
+   */
+  static void PopulateForwardingTables (bool enableLearning = false);
+  /**
+   * @return the devices the stacks are installed on, one container per
+   * layer 2 domain: the endpoints (bonds rather than their members),
+   * their virtual functions and the switches that reach each other
+   */
+  static std::vector<NetDeviceContainer> GetLayer2Domains (void);
+
+  /**
+   * @param device an ns3::EthernetNetDevice or ns3::EthernetBondNetDevice
+   * @param group the IPv4 multicast group to join
+   * @param source the IPv4 address of the host on the device, the
+   *        unspecified address if it has none
+   *
+   * Program the multicast filter of the device (and of the bond members)
+   * for the group, and send an IGMPv2 membership report through the device
+   * so snooping switches forward the group to it.  ns-3 has no IGMP of its
+   * own, so this stands for the join a host stack would make.
+   */
+  static void JoinMulticastGroup (Ptr<NetDevice> device, Ipv4Address group,
+                                  Ipv4Address source = Ipv4Address::GetAny ());
+  /**
+   * @param device an ns3::EthernetNetDevice or ns3::EthernetBondNetDevice
+   * @param group the IPv6 multicast group to join
+   *
+   * Same as above with an MLDv1 report.
+   */
+  static void JoinMulticastGroup (Ptr<NetDevice> device, Ipv6Address group);
+  /**
+   * @param device an ns3::EthernetNetDevice or ns3::EthernetBondNetDevice
+   * @param group the IPv4 multicast group to leave
+   * @param source the IPv4 address of the host on the device
+   *
+   * Undo JoinMulticastGroup, sending an IGMPv2 leave.
+   */
+  static void LeaveMulticastGroup (Ptr<NetDevice> device, Ipv4Address group,
+                                   Ipv4Address source = Ipv4Address::GetAny ());
+  /**
+   * @param device an ns3::EthernetNetDevice or ns3::EthernetBondNetDevice
+   * @param group the IPv6 multicast group to leave
+   *
+   * Undo JoinMulticastGroup, sending an MLDv1 done.
+   */
+  static void LeaveMulticastGroup (Ptr<NetDevice> device, Ipv6Address group);
+
 private:
   /**
    * @brief Enable pcap output the indicated net device.
@@ -150,7 +405,8 @@ private:
    *
    * @param prefix Filename prefix to use for pcap files.
    * @param nd Net device for which you want to enable tracing.
-   * @param promiscuous If true capture all possible packets available at the device.
+   * @param promiscuous If true capture all possible packets available at the device,
+   *        otherwise only those it sends and those addressed to it.
    * @param explicitFilename Treat the prefix as an explicit filename if true
    */
   virtual void EnablePcapInternal (std::string prefix, Ptr<NetDevice> nd, bool promiscuous, bool explicitFilename);
@@ -175,6 +431,10 @@ private:
   ObjectFactory m_queueFactory;
   ObjectFactory m_channelFactory;
   ObjectFactory m_deviceFactory;
+  ObjectFactory m_virtualFunctionFactory;
+  uint32_t m_pcapSampling;
+  uint32_t m_pcapSnapLen;
+  EthernetCaptureFilter m_pcapFilter;
 };
 
 } // namespace ns3
@@ -0,0 +1,74 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_PCAP_REPLAY_HELPER_H
+#define ETHERNET_PCAP_REPLAY_HELPER_H
+
+#include <string>
+
+#include "ns3/object-factory.h"
+#include "ns3/application-container.h"
+#include "ns3/net-device-container.h"
+
+namespace ns3 {
+
+/**
+ * \brief Create EthernetPcapReplay applications which inject the frames
+ * of a pcap file into a device.
+ */
+class EthernetPcapReplayHelper
+{
+public:
+  /**
+   * @param filename the pcap file to replay
+   */
+  EthernetPcapReplayHelper (std::string filename);
+
+  /**
+   * Set an attribute on each EthernetPcapReplay created by Install.
+   *
+   * @param name the name of the attribute to set
+   * @param value the value of the attribute to set
+   */
+  void SetAttribute (std::string name, const AttributeValue &value);
+
+  /**
+   * Install a replay application on the node of the device, sending
+   * through that device.
+   *
+   * @param device the device to inject the frames into
+   */
+  ApplicationContainer Install (Ptr<NetDevice> device) const;
+
+  /**
+   * Install a replay application for each device of the container.  All of
+   * them replay the same file.
+   *
+   * @param c the devices to inject the frames into
+   */
+  ApplicationContainer Install (NetDeviceContainer c) const;
+
+private:
+  ObjectFactory m_factory;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_PCAP_REPLAY_HELPER_H */
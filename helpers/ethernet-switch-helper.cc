@@ -0,0 +1,69 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/names.h"
+#include "ns3/ethernet-switch-net-device.h"
+#include "ethernet-switch-helper.h"
+
+NS_LOG_COMPONENT_DEFINE ("EthernetSwitchHelper");
+
+namespace ns3 {
+
+EthernetSwitchHelper::EthernetSwitchHelper ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_deviceFactory.SetTypeId ("ns3::EthernetSwitchNetDevice");
+}
+
+void
+EthernetSwitchHelper::SetDeviceAttribute (std::string name, const AttributeValue &value)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_deviceFactory.Set (name, value);
+}
+
+NetDeviceContainer
+EthernetSwitchHelper::Install (Ptr<Node> node, NetDeviceContainer c)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  NS_LOG_LOGIC ("**** Install switch device on node " << node->GetId ());
+
+  Ptr<EthernetSwitchNetDevice> dev = m_deviceFactory.Create<EthernetSwitchNetDevice> ();
+  node->AddDevice (dev);
+
+  for (NetDeviceContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      NS_LOG_LOGIC ("**** Add SwitchPort " << *i);
+      dev->AddSwitchPort (*i);
+    }
+  return NetDeviceContainer (dev);
+}
+
+NetDeviceContainer
+EthernetSwitchHelper::Install (std::string nodeName, NetDeviceContainer c)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  Ptr<Node> node = Names::Find<Node> (nodeName);
+  return Install (node, c);
+}
+
+} // namespace ns3
@@ -0,0 +1,72 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_SWITCH_HELPER_H
+#define ETHERNET_SWITCH_HELPER_H
+
+#include <string>
+
+#include "ns3/object-factory.h"
+#include "ns3/net-device-container.h"
+
+namespace ns3 {
+
+class Node;
+
+/**
+ * \brief Turn a node into an Ethernet switch.
+ *
+ * Creates an EthernetSwitchNetDevice on the node and adds the given devices
+ * as its ports, in the same way as BridgeHelper.
+ */
+class EthernetSwitchHelper
+{
+public:
+  EthernetSwitchHelper ();
+
+  /**
+   * Set an attribute on each EthernetSwitchNetDevice created by Install.
+   *
+   * @param name the name of the attribute to set
+   * @param value the value of the attribute to set
+   */
+  void SetDeviceAttribute (std::string name, const AttributeValue &value);
+
+  /**
+   * @param node the node to install the switch on
+   * @param c the devices of the node to use as switch ports
+   * @return a container holding the new switch device
+   */
+  NetDeviceContainer Install (Ptr<Node> node, NetDeviceContainer c);
+
+  /**
+   * @param nodeName the name of the node to install the switch on
+   * @param c the devices of the node to use as switch ports
+   * @return a container holding the new switch device
+   */
+  NetDeviceContainer Install (std::string nodeName, NetDeviceContainer c);
+
+private:
+  ObjectFactory m_deviceFactory;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_SWITCH_HELPER_H */
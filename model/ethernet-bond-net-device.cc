@@ -0,0 +1,488 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include <algorithm>
+
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/channel.h"
+#include "ns3/uinteger.h"
+#include "ns3/pointer.h"
+#include "ns3/string.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/bridge-channel.h"
+#include "ethernet-bond-net-device.h"
+#include "ethernet-ecmp-group.h"
+
+NS_LOG_COMPONENT_DEFINE ("EthernetBondNetDevice");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (EthernetBondNetDevice);
+
+TypeId
+EthernetBondNetDevice::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetBondNetDevice")
+    .SetParent<NetDevice> ()
+    .AddConstructor<EthernetBondNetDevice> ()
+    .AddAttribute ("Mtu", "The MAC-level Maximum Transmission Unit, applied to every member",
+                   UintegerValue (1500),
+                   MakeUintegerAccessor (&EthernetBondNetDevice::SetMtu,
+                                         &EthernetBondNetDevice::GetMtu),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("TxHash",
+                   "The flow hash spreading transmissions over the active members.  The bond "
+                   "copies the configuration of the group given, so several bonds can share it.",
+                   PointerValue (),
+                   MakePointerAccessor (&EthernetBondNetDevice::SetTxHash,
+                                        &EthernetBondNetDevice::GetTxHash),
+                   MakePointerChecker<EthernetEcmpGroup> ())
+    .AddTraceSource ("MacTx",
+                     "Trace source indicating a packet has arrived for transmission by this device",
+                     MakeTraceSourceAccessor (&EthernetBondNetDevice::m_macTxTrace))
+    .AddTraceSource ("MacTxDrop",
+                     "Trace source indicating a packet has been dropped by the device before transmission",
+                     MakeTraceSourceAccessor (&EthernetBondNetDevice::m_macTxDropTrace))
+    .AddTraceSource ("MacPromiscRx",
+                     "A packet has been received by this device, has been passed up from the physical layer "
+                     "and is being forwarded up the local protocol stack.  This is a promiscuous trace,",
+                     MakeTraceSourceAccessor (&EthernetBondNetDevice::m_macPromiscRxTrace))
+    .AddTraceSource ("MacRx",
+                     "A packet has been received by this device, has been passed up from the physical layer "
+                     "and is being forwarded up the local protocol stack.  This is a non-promiscuous trace,",
+                     MakeTraceSourceAccessor (&EthernetBondNetDevice::m_macRxTrace))
+    .AddTraceSource ("PhyTx",
+                     "A packet has been handed to a member for transmission, with the index of the member",
+                     MakeTraceSourceAccessor (&EthernetBondNetDevice::m_phyTxTrace))
+    .AddTraceSource ("PhyRx",
+                     "A packet has been received by a member, with the index of the member",
+                     MakeTraceSourceAccessor (&EthernetBondNetDevice::m_phyRxTrace))
+    ;
+  return tid;
+}
+
+EthernetBondNetDevice::EthernetBondNetDevice ()
+  : m_node (0),
+    m_ifIndex (0),
+    m_linkUp (false),
+    m_txPackets (0),
+    m_txBytes (0),
+    m_txDrops (0),
+    m_rxPackets (0),
+    m_rxBytes (0)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_channel = CreateObject<BridgeChannel> ();
+  m_active = CreateObject<EthernetEcmpGroup> ();
+}
+
+EthernetBondNetDevice::~EthernetBondNetDevice ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+EthernetBondNetDevice::DoDispose (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_members.clear ();
+  m_memberCounters.clear ();
+  m_active = 0;
+  m_channel = 0;
+  m_node = 0;
+  m_rxCallback = MakeNullCallback<bool, Ptr<NetDevice>, Ptr<const Packet>, uint16_t, const Address &> ();
+  m_promiscRxCallback = MakeNullCallback<bool, Ptr<NetDevice>, Ptr<const Packet>, uint16_t, const Address &, const Address &, PacketType> ();
+  NetDevice::DoDispose ();
+}
+
+void
+EthernetBondNetDevice::AddMember (Ptr<NetDevice> member)
+{
+  NS_LOG_FUNCTION (member);
+  NS_ASSERT (member != this);
+  NS_ASSERT (m_node != 0 && member->GetNode () == m_node);
+  if (!Mac48Address::IsMatchingType (member->GetAddress ()))
+    {
+      NS_FATAL_ERROR ("EthernetBondNetDevice::AddMember(): member does not have a MAC-48 address");
+    }
+  if (!member->SupportsSendFrom ())
+    {
+      NS_FATAL_ERROR ("EthernetBondNetDevice::AddMember(): member does not support SendFrom");
+    }
+  if (m_address == Mac48Address ())
+    {
+      m_address = Mac48Address::ConvertFrom (member->GetAddress ());
+    }
+  member->SetAddress (m_address);
+  member->SetMtu (m_mtu);
+
+  m_node->RegisterProtocolHandler (MakeCallback (&EthernetBondNetDevice::ReceiveFromMember, this),
+                                   0, member, true);
+  member->AddLinkChangeCallback (MakeCallback (&EthernetBondNetDevice::UpdateActiveMembers, this));
+  m_members.push_back (member);
+  m_memberCounters.push_back (MemberCounters ());
+  m_channel->AddChannel (member->GetChannel ());
+  UpdateActiveMembers ();
+}
+
+uint32_t
+EthernetBondNetDevice::GetNMembers (void) const
+{
+  return m_members.size ();
+}
+
+Ptr<NetDevice>
+EthernetBondNetDevice::GetMember (uint32_t i) const
+{
+  NS_ASSERT (i < m_members.size ());
+  return m_members[i];
+}
+
+uint32_t
+EthernetBondNetDevice::GetNActiveMembers (void) const
+{
+  return m_active->GetNMembers ();
+}
+
+void
+EthernetBondNetDevice::SetTxHash (Ptr<EthernetEcmpGroup> group)
+{
+  NS_LOG_FUNCTION (group);
+  if (group == 0)
+    {
+      return;
+    }
+  //
+  // Each bond has its own group, holding its active members: take the
+  // hash configuration alone.
+  //
+  static const char *attributes[] = { "Seed", "HashFields", "Buckets" };
+  for (uint32_t i = 0; i < sizeof (attributes) / sizeof (attributes[0]); ++i)
+    {
+      StringValue value;
+      group->GetAttribute (attributes[i], value);
+      m_active->SetAttribute (attributes[i], value);
+    }
+}
+
+Ptr<EthernetEcmpGroup>
+EthernetBondNetDevice::GetTxHash (void) const
+{
+  return m_active;
+}
+
+uint32_t
+EthernetBondNetDevice::GetMemberIndex (Ptr<NetDevice> member) const
+{
+  return std::find (m_members.begin (), m_members.end (), member) - m_members.begin ();
+}
+
+void
+EthernetBondNetDevice::UpdateActiveMembers (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  for (std::vector<Ptr<NetDevice> >::iterator i = m_members.begin (); i != m_members.end (); ++i)
+    {
+      if ((*i)->IsLinkUp ())
+        {
+          m_active->AddMember (*i);
+        }
+      else
+        {
+          m_active->RemoveMember (*i);
+        }
+    }
+
+  bool linkUp = m_active->GetNMembers () > 0;
+  if (linkUp != m_linkUp)
+    {
+      NS_LOG_LOGIC ("Bond link " << (linkUp ? "up" : "down"));
+      m_linkUp = linkUp;
+      m_linkChangeCallbacks ();
+    }
+}
+
+uint64_t
+EthernetBondNetDevice::GetTxPackets (void) const
+{
+  return m_txPackets;
+}
+
+uint64_t
+EthernetBondNetDevice::GetTxBytes (void) const
+{
+  return m_txBytes;
+}
+
+uint64_t
+EthernetBondNetDevice::GetTxDrops (void) const
+{
+  return m_txDrops;
+}
+
+uint64_t
+EthernetBondNetDevice::GetRxPackets (void) const
+{
+  return m_rxPackets;
+}
+
+uint64_t
+EthernetBondNetDevice::GetRxBytes (void) const
+{
+  return m_rxBytes;
+}
+
+uint64_t
+EthernetBondNetDevice::GetMemberTxPackets (uint32_t i) const
+{
+  NS_ASSERT (i < m_memberCounters.size ());
+  return m_memberCounters[i].txPackets;
+}
+
+uint64_t
+EthernetBondNetDevice::GetMemberTxBytes (uint32_t i) const
+{
+  NS_ASSERT (i < m_memberCounters.size ());
+  return m_memberCounters[i].txBytes;
+}
+
+uint64_t
+EthernetBondNetDevice::GetMemberRxPackets (uint32_t i) const
+{
+  NS_ASSERT (i < m_memberCounters.size ());
+  return m_memberCounters[i].rxPackets;
+}
+
+uint64_t
+EthernetBondNetDevice::GetMemberRxBytes (uint32_t i) const
+{
+  NS_ASSERT (i < m_memberCounters.size ());
+  return m_memberCounters[i].rxBytes;
+}
+
+bool
+EthernetBondNetDevice::ReceiveFromMember (Ptr<NetDevice> member, Ptr<const Packet> packet, uint16_t protocol,
+                                          const Address &source, const Address &destination, PacketType packetType)
+{
+  NS_LOG_FUNCTION (member << packet << protocol << source << destination << packetType);
+
+  uint32_t index = GetMemberIndex (member);
+  m_phyRxTrace (packet, index);
+  m_macPromiscRxTrace (packet);
+  if (!m_promiscRxCallback.IsNull ())
+    {
+      m_promiscRxCallback (this, packet, protocol, source, destination, packetType);
+    }
+
+  if (packetType != PACKET_OTHERHOST)
+    {
+      ++m_rxPackets;
+      m_rxBytes += packet->GetSize ();
+      ++m_memberCounters[index].rxPackets;
+      m_memberCounters[index].rxBytes += packet->GetSize ();
+      m_macRxTrace (packet);
+      m_rxCallback (this, packet, protocol, source);
+    }
+  return true;
+}
+
+void
+EthernetBondNetDevice::SetIfIndex (const uint32_t index)
+{
+  m_ifIndex = index;
+}
+
+uint32_t
+EthernetBondNetDevice::GetIfIndex (void) const
+{
+  return m_ifIndex;
+}
+
+Ptr<Channel>
+EthernetBondNetDevice::GetChannel (void) const
+{
+  return m_channel;
+}
+
+void
+EthernetBondNetDevice::SetAddress (Address address)
+{
+  m_address = Mac48Address::ConvertFrom (address);
+  for (std::vector<Ptr<NetDevice> >::iterator i = m_members.begin (); i != m_members.end (); ++i)
+    {
+      (*i)->SetAddress (address);
+    }
+}
+
+Address
+EthernetBondNetDevice::GetAddress (void) const
+{
+  return m_address;
+}
+
+bool
+EthernetBondNetDevice::SetMtu (const uint16_t mtu)
+{
+  m_mtu = mtu;
+  for (std::vector<Ptr<NetDevice> >::iterator i = m_members.begin (); i != m_members.end (); ++i)
+    {
+      (*i)->SetMtu (mtu);
+    }
+  return true;
+}
+
+uint16_t
+EthernetBondNetDevice::GetMtu (void) const
+{
+  return m_mtu;
+}
+
+bool
+EthernetBondNetDevice::IsLinkUp (void) const
+{
+  return m_linkUp;
+}
+
+void
+EthernetBondNetDevice::AddLinkChangeCallback (Callback<void> callback)
+{
+  m_linkChangeCallbacks.ConnectWithoutContext (callback);
+}
+
+bool
+EthernetBondNetDevice::IsBroadcast (void) const
+{
+  return true;
+}
+
+Address
+EthernetBondNetDevice::GetBroadcast (void) const
+{
+  return Mac48Address ("ff:ff:ff:ff:ff:ff");
+}
+
+bool
+EthernetBondNetDevice::IsMulticast (void) const
+{
+  return true;
+}
+
+Address
+EthernetBondNetDevice::GetMulticast (Ipv4Address multicastGroup) const
+{
+  return Mac48Address::GetMulticast (multicastGroup);
+}
+
+Address
+EthernetBondNetDevice::GetMulticast (Ipv6Address addr) const
+{
+  return Mac48Address::GetMulticast (addr);
+}
+
+bool
+EthernetBondNetDevice::IsPointToPoint (void) const
+{
+  return false;
+}
+
+bool
+EthernetBondNetDevice::IsBridge (void) const
+{
+  return false;
+}
+
+bool
+EthernetBondNetDevice::Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber)
+{
+  NS_LOG_FUNCTION (packet << dest << protocolNumber);
+  return SendFrom (packet, m_address, dest, protocolNumber);
+}
+
+bool
+EthernetBondNetDevice::SendFrom (Ptr<Packet> packet, const Address& src, const Address& dest, uint16_t protocolNumber)
+{
+  NS_LOG_FUNCTION (packet << src << dest << protocolNumber);
+
+  m_macTxTrace (packet);
+  Ptr<NetDevice> member = m_active->Select (packet, protocolNumber,
+                                            Mac48Address::ConvertFrom (src),
+                                            Mac48Address::ConvertFrom (dest));
+  if (member == 0)
+    {
+      ++m_txDrops;
+      m_macTxDropTrace (packet);
+      return false;
+    }
+  uint32_t index = GetMemberIndex (member);
+  uint32_t size = packet->GetSize ();
+  m_phyTxTrace (packet, index);
+  if (!member->SendFrom (packet, src, dest, protocolNumber))
+    {
+      ++m_txDrops;
+      m_macTxDropTrace (packet);
+      return false;
+    }
+  ++m_txPackets;
+  m_txBytes += size;
+  ++m_memberCounters[index].txPackets;
+  m_memberCounters[index].txBytes += size;
+  return true;
+}
+
+Ptr<Node>
+EthernetBondNetDevice::GetNode (void) const
+{
+  return m_node;
+}
+
+void
+EthernetBondNetDevice::SetNode (Ptr<Node> node)
+{
+  m_node = node;
+}
+
+bool
+EthernetBondNetDevice::NeedsArp (void) const
+{
+  return true;
+}
+
+void
+EthernetBondNetDevice::SetReceiveCallback (NetDevice::ReceiveCallback cb)
+{
+  m_rxCallback = cb;
+}
+
+void
+EthernetBondNetDevice::SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb)
+{
+  m_promiscRxCallback = cb;
+}
+
+bool
+EthernetBondNetDevice::SupportsSendFrom (void) const
+{
+  return true;
+}
+
+} // namespace ns3
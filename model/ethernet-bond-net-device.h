@@ -0,0 +1,176 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_BOND_NET_DEVICE_H
+#define ETHERNET_BOND_NET_DEVICE_H
+
+#include <vector>
+#include "ns3/net-device.h"
+#include "ns3/mac48-address.h"
+#include "ns3/traced-callback.h"
+
+namespace ns3 {
+
+class Node;
+class BridgeChannel;
+class EthernetEcmpGroup;
+
+/**
+ * \brief A link aggregation group of EthernetNetDevices presented as a
+ * single NetDevice.
+ *
+ * All the members take the MAC address of the bond.  Transmissions are
+ * spread over the members whose link is up by flow hash (an
+ * EthernetEcmpGroup of the bond, configured like the TxHash attribute),
+ * so the frames of one flow stay in order on one member, and
+ * a member going down only moves the flows it was carrying.  Frames
+ * received on any member are delivered as received by the bond.
+ *
+ * The aggregation is static: LACP is not modeled, membership is what
+ * AddMember set up, filtered by the link state of each member.
+ */
+class EthernetBondNetDevice : public NetDevice
+{
+public:
+  static TypeId GetTypeId (void);
+
+  EthernetBondNetDevice ();
+  virtual ~EthernetBondNetDevice ();
+
+  /**
+   * Add a member to the bond.  The member must belong to the same node,
+   * support SendFrom and have a MAC-48 address; it takes the address of
+   * the bond.
+   *
+   * @param member the device to aggregate
+   */
+  void AddMember (Ptr<NetDevice> member);
+  /**
+   * @return the number of members, whatever their link state
+   */
+  uint32_t GetNMembers (void) const;
+  /**
+   * @param i the index of the member
+   * @return the member
+   */
+  Ptr<NetDevice> GetMember (uint32_t i) const;
+  /**
+   * @return the number of members whose link is up
+   */
+  uint32_t GetNActiveMembers (void) const;
+
+  uint64_t GetTxPackets (void) const;
+  uint64_t GetTxBytes (void) const;
+  uint64_t GetTxDrops (void) const;
+  uint64_t GetRxPackets (void) const;
+  uint64_t GetRxBytes (void) const;
+
+  /**
+   * The counters of the traffic the bond sent and passed up through each
+   * member, by index of the member.
+   */
+  uint64_t GetMemberTxPackets (uint32_t i) const;
+  uint64_t GetMemberTxBytes (uint32_t i) const;
+  uint64_t GetMemberRxPackets (uint32_t i) const;
+  uint64_t GetMemberRxBytes (uint32_t i) const;
+
+  // The following methods are inherited from NetDevice base class.
+  virtual void SetIfIndex (const uint32_t index);
+  virtual uint32_t GetIfIndex (void) const;
+  virtual Ptr<Channel> GetChannel (void) const;
+  virtual void SetAddress (Address address);
+  virtual Address GetAddress (void) const;
+  virtual bool SetMtu (const uint16_t mtu);
+  virtual uint16_t GetMtu (void) const;
+  virtual bool IsLinkUp (void) const;
+  virtual void AddLinkChangeCallback (Callback<void> callback);
+  virtual bool IsBroadcast (void) const;
+  virtual Address GetBroadcast (void) const;
+  virtual bool IsMulticast (void) const;
+  virtual Address GetMulticast (Ipv4Address multicastGroup) const;
+  virtual Address GetMulticast (Ipv6Address addr) const;
+  virtual bool IsPointToPoint (void) const;
+  virtual bool IsBridge (void) const;
+  virtual bool Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber);
+  virtual bool SendFrom (Ptr<Packet> packet, const Address& source, const Address& dest, uint16_t protocolNumber);
+  virtual Ptr<Node> GetNode (void) const;
+  virtual void SetNode (Ptr<Node> node);
+  virtual bool NeedsArp (void) const;
+  virtual void SetReceiveCallback (NetDevice::ReceiveCallback cb);
+  virtual void SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb);
+  virtual bool SupportsSendFrom (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  EthernetBondNetDevice &operator = (const EthernetBondNetDevice &o);
+  EthernetBondNetDevice (const EthernetBondNetDevice &o);
+
+  bool ReceiveFromMember (Ptr<NetDevice> member, Ptr<const Packet> packet, uint16_t protocol,
+                          const Address &source, const Address &destination, PacketType packetType);
+  /**
+   * Make the transmit group match the link state of the members.
+   */
+  void UpdateActiveMembers (void);
+  void SetTxHash (Ptr<EthernetEcmpGroup> group);
+  Ptr<EthernetEcmpGroup> GetTxHash (void) const;
+  uint32_t GetMemberIndex (Ptr<NetDevice> member) const;
+
+  struct MemberCounters
+  {
+    MemberCounters () : txPackets (0), txBytes (0), rxPackets (0), rxBytes (0) {}
+    uint64_t txPackets;
+    uint64_t txBytes;
+    uint64_t rxPackets;
+    uint64_t rxBytes;
+  };
+
+  Ptr<Node> m_node;
+  Ptr<BridgeChannel> m_channel;
+  std::vector<Ptr<NetDevice> > m_members;
+  std::vector<MemberCounters> m_memberCounters;
+  Ptr<EthernetEcmpGroup> m_active;
+  uint32_t m_ifIndex;
+  uint16_t m_mtu;
+  Mac48Address m_address;
+  bool m_linkUp;
+
+  uint64_t m_txPackets;
+  uint64_t m_txBytes;
+  uint64_t m_txDrops;
+  uint64_t m_rxPackets;
+  uint64_t m_rxBytes;
+
+  TracedCallback<Ptr<const Packet> > m_macTxTrace;
+  TracedCallback<Ptr<const Packet> > m_macTxDropTrace;
+  TracedCallback<Ptr<const Packet> > m_macRxTrace;
+  TracedCallback<Ptr<const Packet> > m_macPromiscRxTrace;
+  TracedCallback<Ptr<const Packet>, uint32_t> m_phyTxTrace;
+  TracedCallback<Ptr<const Packet>, uint32_t> m_phyRxTrace;
+  TracedCallback<> m_linkChangeCallbacks;
+
+  NetDevice::ReceiveCallback m_rxCallback;
+  NetDevice::PromiscReceiveCallback m_promiscRxCallback;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_BOND_NET_DEVICE_H */
@@ -0,0 +1,214 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include <string.h>
+
+#include "ethernet-capture-filter.h"
+#include "ethernet-vlan-header.h"
+
+namespace ns3 {
+
+static const uint16_t IPV4_PROT_NUMBER = 0x0800;
+static const uint16_t IPV6_PROT_NUMBER = 0x86dd;
+static const uint8_t TCP_PROT_NUMBER = 6;
+static const uint8_t UDP_PROT_NUMBER = 17;
+
+EthernetCaptureFilter::EthernetCaptureFilter ()
+  : m_bidirectional (false),
+    m_etherType (-1),
+    m_ipProtocol (-1),
+    m_needsIpv4 (false),
+    m_needsTransport (false)
+{
+}
+
+void
+EthernetCaptureFilter::AddTest (Layer layer, uint8_t offset, uint8_t reverseOffset, const uint8_t *value, uint8_t size)
+{
+  Test test;
+  test.layer = layer;
+  test.size = size;
+  memcpy (test.value, value, size);
+  test.offset = offset;
+  m_tests.push_back (test);
+  test.offset = reverseOffset;
+  m_reverseTests.push_back (test);
+}
+
+void
+EthernetCaptureFilter::SetEtherType (uint16_t type)
+{
+  m_etherType = type;
+}
+
+void
+EthernetCaptureFilter::SetSource (Mac48Address address)
+{
+  uint8_t buffer[6];
+  address.CopyTo (buffer);
+  AddTest (LINK, 6, 0, buffer, 6);
+}
+
+void
+EthernetCaptureFilter::SetDestination (Mac48Address address)
+{
+  uint8_t buffer[6];
+  address.CopyTo (buffer);
+  AddTest (LINK, 0, 6, buffer, 6);
+}
+
+void
+EthernetCaptureFilter::SetIpv4Source (Ipv4Address address)
+{
+  uint8_t buffer[4];
+  address.Serialize (buffer);
+  AddTest (NETWORK, 12, 16, buffer, 4);
+  m_needsIpv4 = true;
+}
+
+void
+EthernetCaptureFilter::SetIpv4Destination (Ipv4Address address)
+{
+  uint8_t buffer[4];
+  address.Serialize (buffer);
+  AddTest (NETWORK, 16, 12, buffer, 4);
+  m_needsIpv4 = true;
+}
+
+void
+EthernetCaptureFilter::SetIpProtocol (uint8_t protocol)
+{
+  m_ipProtocol = protocol;
+}
+
+void
+EthernetCaptureFilter::SetSourcePort (uint16_t port)
+{
+  uint8_t buffer[2] = { static_cast<uint8_t> (port >> 8), static_cast<uint8_t> (port) };
+  AddTest (TRANSPORT, 0, 2, buffer, 2);
+  m_needsTransport = true;
+}
+
+void
+EthernetCaptureFilter::SetDestinationPort (uint16_t port)
+{
+  uint8_t buffer[2] = { static_cast<uint8_t> (port >> 8), static_cast<uint8_t> (port) };
+  AddTest (TRANSPORT, 2, 0, buffer, 2);
+  m_needsTransport = true;
+}
+
+void
+EthernetCaptureFilter::SetBidirectional (bool bidirectional)
+{
+  m_bidirectional = bidirectional;
+}
+
+bool
+EthernetCaptureFilter::IsEmpty (void) const
+{
+  return m_tests.empty () && m_etherType < 0 && m_ipProtocol < 0;
+}
+
+bool
+EthernetCaptureFilter::MatchTests (const TestList &tests, const uint8_t *buffer, uint32_t size,
+                                   const uint32_t *base) const
+{
+  for (TestList::const_iterator i = tests.begin (); i != tests.end (); ++i)
+    {
+      uint32_t offset = base[i->layer] + i->offset;
+      if (offset + i->size > size || memcmp (buffer + offset, i->value, i->size) != 0)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+bool
+EthernetCaptureFilter::Match (Ptr<const Packet> frame) const
+{
+  //
+  // Enough for the Ethernet, 802.1Q and LLC/SNAP headers, an IPv4 header
+  // with options or an IPv6 header, and the ports behind them.
+  //
+  uint8_t buffer[128];
+  uint32_t size = frame->CopyData (buffer, sizeof (buffer));
+  if (size < 14)
+    {
+      return false;
+    }
+
+  uint32_t base[3] = { 0, 14, 0 };
+  uint16_t type = (buffer[12] << 8) | buffer[13];
+  if (type == EthernetVlanHeader::TPID && size >= 18)
+    {
+      type = (buffer[16] << 8) | buffer[17];
+      base[NETWORK] += 4;
+    }
+  if (type <= 1500 && size >= base[NETWORK] + 8)
+    {
+      //
+      // A length: the type is in the SNAP header.
+      //
+      type = (buffer[base[NETWORK] + 6] << 8) | buffer[base[NETWORK] + 7];
+      base[NETWORK] += 8;
+    }
+
+  if (m_etherType >= 0 && type != m_etherType)
+    {
+      return false;
+    }
+
+  if (m_needsIpv4 || m_needsTransport || m_ipProtocol >= 0)
+    {
+      uint32_t l3 = base[NETWORK];
+      int32_t protocol = -1;
+      if (type == IPV4_PROT_NUMBER && size >= l3 + 20)
+        {
+          protocol = buffer[l3 + 9];
+          base[TRANSPORT] = l3 + (buffer[l3] & 0x0f) * 4;
+          //
+          // Only the first fragment of a datagram carries the ports.
+          //
+          if (((buffer[l3 + 6] & 0x1f) || buffer[l3 + 7]) && m_needsTransport)
+            {
+              return false;
+            }
+        }
+      else if (type == IPV6_PROT_NUMBER && size >= l3 + 40 && !m_needsIpv4)
+        {
+          protocol = buffer[l3 + 6];
+          base[TRANSPORT] = l3 + 40;
+        }
+      if (protocol < 0 || (m_ipProtocol >= 0 && protocol != m_ipProtocol))
+        {
+          return false;
+        }
+      if (m_needsTransport && protocol != TCP_PROT_NUMBER && protocol != UDP_PROT_NUMBER)
+        {
+          return false;
+        }
+    }
+
+  return MatchTests (m_tests, buffer, size, base)
+         || (m_bidirectional && MatchTests (m_reverseTests, buffer, size, base));
+}
+
+} // namespace ns3
@@ -0,0 +1,111 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_CAPTURE_FILTER_H
+#define ETHERNET_CAPTURE_FILTER_H
+
+#include <vector>
+#include "ns3/packet.h"
+#include "ns3/mac48-address.h"
+#include "ns3/ipv4-address.h"
+
+namespace ns3 {
+
+/**
+ * \brief A filter on the headers of Ethernet frames, for packet capture.
+ *
+ * The filter matches the frames whose fields equal all the values set:
+ * EtherType, MAC addresses, and the IPv4 addresses, IP protocol and
+ * TCP/UDP ports of the IP 5-tuple (protocol and ports also match IPv6
+ * frames, whose extension headers are not walked).  A filter with nothing
+ * set matches every frame.  With SetBidirectional, the frames of the
+ * reverse direction, with source and destination swapped, match too.
+ *
+ * The fields set are compiled into a list of byte comparisons at fixed
+ * offsets from the start of the frame, the network header or the
+ * transport header; matching a frame only copies its first bytes, never
+ * the whole packet.  Frames are expected as the sniffer traces of
+ * EthernetNetDevice give them: Ethernet header first, with an 802.1Q
+ * header and LLC/SNAP encapsulation skipped over.
+ */
+class EthernetCaptureFilter
+{
+public:
+  EthernetCaptureFilter ();
+
+  void SetEtherType (uint16_t type);
+  void SetSource (Mac48Address address);
+  void SetDestination (Mac48Address address);
+  void SetIpv4Source (Ipv4Address address);
+  void SetIpv4Destination (Ipv4Address address);
+  void SetIpProtocol (uint8_t protocol);
+  void SetSourcePort (uint16_t port);
+  void SetDestinationPort (uint16_t port);
+  /**
+   * @param bidirectional true to match the reverse direction too
+   */
+  void SetBidirectional (bool bidirectional);
+
+  /**
+   * @return true if nothing is set, so every frame matches
+   */
+  bool IsEmpty (void) const;
+  /**
+   * @param frame a frame starting with its Ethernet header
+   * @return true if the frame matches the filter
+   */
+  bool Match (Ptr<const Packet> frame) const;
+
+private:
+  enum Layer
+    {
+      LINK = 0,
+      NETWORK,
+      TRANSPORT
+    };
+
+  struct Test
+  {
+    uint8_t layer;
+    uint8_t offset;
+    uint8_t size;
+    uint8_t value[6];
+  };
+  typedef std::vector<Test> TestList;
+
+  /**
+   * Add the test of a field, and the test of its counterpart in the
+   * reverse direction.
+   */
+  void AddTest (Layer layer, uint8_t offset, uint8_t reverseOffset, const uint8_t *value, uint8_t size);
+  bool MatchTests (const TestList &tests, const uint8_t *buffer, uint32_t size, const uint32_t *base) const;
+
+  TestList m_tests;
+  TestList m_reverseTests;
+  bool m_bidirectional;
+  int32_t m_etherType;
+  int32_t m_ipProtocol;
+  bool m_needsIpv4;
+  bool m_needsTransport;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_CAPTURE_FILTER_H */
@@ -20,8 +20,11 @@
 
 
 #include "ethernet-channel.h"
+#include "ethernet-snapshot.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/trace-source-accessor.h"
 
 NS_LOG_COMPONENT_DEFINE ("EthernetChannel");
 
@@ -46,11 +49,48 @@ EthernetChannel::GetTypeId (void)
                    MakeTimeAccessor (&EthernetChannel::SetDelay,
                                      &EthernetChannel::GetDelay),
                    MakeTimeChecker ())
+    .AddAttribute ("DataRate0",
+                   "The data rate device 0 transmits at, zero to keep DataRate",
+                   DataRateValue (DataRate (0)),
+                   MakeDataRateAccessor (&EthernetChannel::SetDataRate0,
+                                         &EthernetChannel::GetDataRate0),
+                   MakeDataRateChecker ())
+    .AddAttribute ("DataRate1",
+                   "The data rate device 1 transmits at, zero to keep DataRate",
+                   DataRateValue (DataRate (0)),
+                   MakeDataRateAccessor (&EthernetChannel::SetDataRate1,
+                                         &EthernetChannel::GetDataRate1),
+                   MakeDataRateChecker ())
+    .AddAttribute ("Delay0", "Transmission delay from device 0 to device 1, negative to keep Delay",
+                   TimeValue (Seconds (-1)),
+                   MakeTimeAccessor (&EthernetChannel::SetDelay0,
+                                     &EthernetChannel::GetDelay0),
+                   MakeTimeChecker ())
+    .AddAttribute ("Delay1", "Transmission delay from device 1 to device 0, negative to keep Delay",
+                   TimeValue (Seconds (-1)),
+                   MakeTimeAccessor (&EthernetChannel::SetDelay1,
+                                     &EthernetChannel::GetDelay1),
+                   MakeTimeChecker ())
+    .AddAttribute ("TimeToFailure",
+                   "The time in seconds a flapping link stays up.",
+                   RandomVariableValue (ExponentialVariable (1)),
+                   MakeRandomVariableAccessor (&EthernetChannel::m_timeToFailure),
+                   MakeRandomVariableChecker ())
+    .AddAttribute ("TimeToRepair",
+                   "The time in seconds a flapping link stays down.",
+                   RandomVariableValue (ExponentialVariable (0.01)),
+                   MakeRandomVariableAccessor (&EthernetChannel::m_timeToRepair),
+                   MakeRandomVariableChecker ())
+    .AddTraceSource ("LinkChange",
+                     "Trace source indicating the link has gone down (false) or up (true)",
+                     MakeTraceSourceAccessor (&EthernetChannel::m_linkChangeTrace))
     ;
   return tid;
 }
 
 EthernetChannel::EthernetChannel ()
+  : m_nDevices (0),
+    m_linkUp (true)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
@@ -68,6 +108,7 @@ EthernetChannel::DoDispose ()
 {
   NS_LOG_FUNCTION_NOARGS ();
   
+  Simulator::Cancel (m_flapEvent);
   m_chan0 = 0;
   m_chan1 = 0;
 
@@ -90,6 +131,12 @@ EthernetChannel::Attach (const Ptr<EthernetNetDevice> &dev)
       m_devices[0]->GetRxDevice ()->Attach (m_chan1);
       m_devices[1]->GetTxDevice ()->Attach (m_chan1);
       m_devices[1]->GetRxDevice ()->Attach (m_chan0);
+
+      //
+      // Attaching a CSMA device resets its interframe gap.
+      //
+      m_devices[0]->UpdateInterframeGap ();
+      m_devices[1]->UpdateInterframeGap ();
     }
 }
 
@@ -112,39 +159,229 @@ EthernetChannel::GetEthernetDevice (uint32_t i) const
   return m_devices[i];
 }
 
+Ptr<CsmaChannel>
+EthernetChannel::GetCsmaChannel (uint32_t i) const
+{
+  NS_ASSERT (i < N_DEVICES);
+  return i == 0 ? m_chan0 : m_chan1;
+}
+
 DataRate
 EthernetChannel::GetDataRate (void) const
 {
-  return m_bps;
+  return m_bps[0];
 }
 
 bool
 EthernetChannel::SetDataRate (DataRate bps)
 {
   NS_LOG_FUNCTION (this << bps);
-  m_bps = bps;
-  DataRateValue bpsValue (bps);
-  m_chan0->SetAttribute ("DataRate", bpsValue);
-  m_chan1->SetAttribute ("DataRate", bpsValue);  
+  for (uint32_t i = 0; i < N_DEVICES; ++i)
+    {
+      SetDirectionDataRate (i, bps);
+    }
   return true;
 }
 
+DataRate
+EthernetChannel::GetDirectionDataRate (uint32_t i) const
+{
+  NS_ASSERT (i < N_DEVICES);
+  return m_bps[i];
+}
+
+void
+EthernetChannel::SetDirectionDataRate (uint32_t i, DataRate bps)
+{
+  NS_LOG_FUNCTION (this << i << bps);
+  NS_ASSERT (i < N_DEVICES);
+  m_bps[i] = bps;
+  GetCsmaChannel (i)->SetAttribute ("DataRate", DataRateValue (bps));
+  if (m_nDevices == N_DEVICES)
+    {
+      m_devices[i]->UpdateInterframeGap ();
+    }
+}
+
+void
+EthernetChannel::SetDataRate0 (DataRate bps)
+{
+  if (bps.GetBitRate () != 0)
+    {
+      SetDirectionDataRate (0, bps);
+    }
+}
+
+void
+EthernetChannel::SetDataRate1 (DataRate bps)
+{
+  if (bps.GetBitRate () != 0)
+    {
+      SetDirectionDataRate (1, bps);
+    }
+}
+
+DataRate
+EthernetChannel::GetDataRate0 (void) const
+{
+  return m_bps[0];
+}
+
+DataRate
+EthernetChannel::GetDataRate1 (void) const
+{
+  return m_bps[1];
+}
+
 Time
 EthernetChannel::GetDelay (void) const
 {
-  return m_delay;
+  return m_delay[0];
 }
 
 bool
 EthernetChannel::SetDelay (Time delay)
 {
   NS_LOG_FUNCTION (this << delay);
-  m_delay = delay;
-  TimeValue delayValue (delay);
-  m_chan0->SetAttribute ("Delay", delayValue);
-  m_chan1->SetAttribute ("Delay", delayValue);
+  for (uint32_t i = 0; i < N_DEVICES; ++i)
+    {
+      SetDirectionDelay (i, delay);
+    }
   return true;  
 }
 
+Time
+EthernetChannel::GetDirectionDelay (uint32_t i) const
+{
+  NS_ASSERT (i < N_DEVICES);
+  return m_delay[i];
+}
+
+void
+EthernetChannel::SetDirectionDelay (uint32_t i, Time delay)
+{
+  NS_LOG_FUNCTION (this << i << delay);
+  NS_ASSERT (i < N_DEVICES);
+  m_delay[i] = delay;
+  GetCsmaChannel (i)->SetAttribute ("Delay", TimeValue (delay));
+}
+
+void
+EthernetChannel::SetDelay0 (Time delay)
+{
+  if (!delay.IsNegative ())
+    {
+      SetDirectionDelay (0, delay);
+    }
+}
+
+void
+EthernetChannel::SetDelay1 (Time delay)
+{
+  if (!delay.IsNegative ())
+    {
+      SetDirectionDelay (1, delay);
+    }
+}
+
+Time
+EthernetChannel::GetDelay0 (void) const
+{
+  return m_delay[0];
+}
+
+Time
+EthernetChannel::GetDelay1 (void) const
+{
+  return m_delay[1];
+}
+
+bool
+EthernetChannel::IsLinkUp (void) const
+{
+  return m_linkUp;
+}
+
+void
+EthernetChannel::SetLinkUp (bool up)
+{
+  NS_LOG_FUNCTION (this << up);
+  if (up == m_linkUp)
+    {
+      return;
+    }
+  m_linkUp = up;
+  for (uint32_t i = 0; i < m_nDevices; ++i)
+    {
+      m_devices[i]->SetLinkState (up);
+    }
+  m_linkChangeTrace (up);
+}
+
+void
+EthernetChannel::ScheduleLinkFailure (Time start, Time duration)
+{
+  NS_LOG_FUNCTION (this << start << duration);
+  Simulator::Schedule (start, &EthernetChannel::SetLinkUp, this, false);
+  Simulator::Schedule (start + duration, &EthernetChannel::SetLinkUp, this, true);
+}
+
+void
+EthernetChannel::StartFlapping (void)
+{
+  NS_LOG_FUNCTION (this);
+  Simulator::Cancel (m_flapEvent);
+  RandomVariable &next = m_linkUp ? m_timeToFailure : m_timeToRepair;
+  m_flapEvent = Simulator::Schedule (Seconds (next.GetValue ()), &EthernetChannel::Flap, this);
+}
+
+void
+EthernetChannel::StopFlapping (void)
+{
+  NS_LOG_FUNCTION (this);
+  Simulator::Cancel (m_flapEvent);
+  SetLinkUp (true);
+}
+
+void
+EthernetChannel::SaveState (EthernetSnapshotWriter &writer) const
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i < N_DEVICES; ++i)
+    {
+      writer.WriteU64 (GetDirectionDataRate (i).GetBitRate ());
+      writer.WriteTime (GetDirectionDelay (i));
+    }
+  writer.WriteU8 (m_linkUp);
+  bool flapping = m_flapEvent.IsRunning ();
+  writer.WriteU8 (flapping);
+  writer.WriteTime (flapping ? Simulator::GetDelayLeft (m_flapEvent) : Seconds (0));
+}
+
+void
+EthernetChannel::RestoreState (EthernetSnapshotReader &reader)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i < N_DEVICES; ++i)
+    {
+      SetDirectionDataRate (i, DataRate (reader.ReadU64 ()));
+      SetDirectionDelay (i, reader.ReadTime ());
+    }
+  SetLinkUp (reader.ReadU8 ());
+  bool flapping = reader.ReadU8 ();
+  Time left = reader.ReadTime ();
+  Simulator::Cancel (m_flapEvent);
+  if (flapping)
+    {
+      m_flapEvent = Simulator::Schedule (left, &EthernetChannel::Flap, this);
+    }
+}
+
+void
+EthernetChannel::Flap (void)
+{
+  SetLinkUp (!m_linkUp);
+  StartFlapping ();
+}
 
 } // namespace ns3
@@ -25,6 +25,9 @@
 #include "ns3/ptr.h"
 #include "ns3/nstime.h"
 #include "ns3/data-rate.h"
+#include "ns3/event-id.h"
+#include "ns3/random-variable.h"
+#include "ns3/traced-callback.h"
 #include "ns3/csma-channel.h"
 #include "ethernet-net-device.h"
 
@@ -32,9 +35,22 @@ namespace ns3 {
 
 class EthernetNetDevice;
 class CsmaChannel;
+class EthernetSnapshotWriter;
+class EthernetSnapshotReader;
 
 /**
  * \brief Ethernet Channel.
+ *
+ * Each direction has its own data rate and delay, device 0 transmitting
+ * on direction 0 and device 1 on direction 1.  Both can be changed while
+ * the simulation runs: a new delay applies to the frames whose
+ * transmission ends from then on, a new data rate to the frames whose
+ * transmission starts from then on; the frame being transmitted keeps
+ * its rate.
+ *
+ * The link can be failed and repaired, at given times or at random: see
+ * SetLinkUp, ScheduleLinkFailure and StartFlapping.  Both ends see the
+ * link go down and up, as described by EthernetNetDevice::SetLinkState.
  */
 class EthernetChannel : public Channel
 {
@@ -70,25 +86,92 @@ public:
    */
   Ptr<EthernetNetDevice> GetEthernetDevice (uint32_t i) const;
   /**
-   * Assign data rate to the channel
+   * Assign data rate to both directions of the channel
    */
   bool SetDataRate (DataRate bps);
   /**
    * Get the assigned data rate of the channel
    *
-   * @return the DataRate to be used by device transmitters.
+   * @return the DataRate of direction 0, which is the data rate of the
+   * channel unless the directions were given different ones.
    */
   DataRate GetDataRate (void) const;
   /**
-   * Assign speed-of-light delay delay to the channel
+   * Assign data rate to a direction of the channel
+   *
+   * @param i the index of the device transmitting in that direction
+   * @param bps the data rate
+   */
+  void SetDirectionDataRate (uint32_t i, DataRate bps);
+  /**
+   * @param i the index of the device transmitting in a direction
+   * @return the data rate of the direction
+   */
+  DataRate GetDirectionDataRate (uint32_t i) const;
+  /**
+   * Assign speed-of-light delay delay to both directions of the channel
    */
   bool SetDelay (Time delay);    
   /**
    * Get the assigned speed-of-light delay of the channel
    *
-   * @return Returns the delay used by the channel.
+   * @return Returns the delay of direction 0, which is the delay of the
+   * channel unless the directions were given different ones.
    */
   Time GetDelay (void) const;
+  /**
+   * Assign speed-of-light delay to a direction of the channel
+   *
+   * @param i the index of the device transmitting in that direction
+   * @param delay the delay
+   */
+  void SetDirectionDelay (uint32_t i, Time delay);
+  /**
+   * @param i the index of the device transmitting in a direction
+   * @return the delay of the direction
+   */
+  Time GetDirectionDelay (uint32_t i) const;
+  /**
+   * Fail or repair the link now.
+   *
+   * @param up true to bring the link up
+   */
+  void SetLinkUp (bool up);
+  /**
+   * @return true if the link is up
+   */
+  bool IsLinkUp (void) const;
+  /**
+   * Fail the link for a while.
+   *
+   * @param start the time from now the link goes down
+   * @param duration how long the link stays down
+   */
+  void ScheduleLinkFailure (Time start, Time duration);
+  /**
+   * Fail and repair the link over and over, the link staying up for
+   * TimeToFailure seconds and down for TimeToRepair seconds each time.
+   */
+  void StartFlapping (void);
+  /**
+   * Stop failing the link.  The link is brought back up if it is down.
+   */
+  void StopFlapping (void);
+  /**
+   * Write the state of this channel to a snapshot: the data rate and the
+   * delay of both directions, the link state, and whether the link is
+   * flapping with the time left to its next change.  The link failures
+   * scheduled with ScheduleLinkFailure are not saved.
+   *
+   * @param writer the snapshot to write to
+   */
+  void SaveState (EthernetSnapshotWriter &writer) const;
+  /**
+   * Restore the state SaveState wrote, as of now.
+   *
+   * @param reader the snapshot to read from
+   */
+  void RestoreState (EthernetSnapshotReader &reader);
   
 protected:
   void DoDispose ();
@@ -102,8 +185,25 @@ private:
   Ptr<CsmaChannel> m_chan0;
   Ptr<CsmaChannel> m_chan1;
 
-  DataRate      m_bps;
-  Time          m_delay;
+  DataRate      m_bps[N_DEVICES];
+  Time          m_delay[N_DEVICES];
+
+  Ptr<CsmaChannel> GetCsmaChannel (uint32_t i) const;
+  void SetDataRate0 (DataRate bps);
+  void SetDataRate1 (DataRate bps);
+  DataRate GetDataRate0 (void) const;
+  DataRate GetDataRate1 (void) const;
+  void SetDelay0 (Time delay);
+  void SetDelay1 (Time delay);
+  Time GetDelay0 (void) const;
+  Time GetDelay1 (void) const;
+  void Flap (void);
+
+  bool m_linkUp;
+  RandomVariable m_timeToFailure;
+  RandomVariable m_timeToRepair;
+  EventId m_flapEvent;
+  TracedCallback<bool> m_linkChangeTrace;
 };
 
 } // namespace ns3
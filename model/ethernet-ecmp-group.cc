@@ -0,0 +1,305 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include <algorithm>
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/uinteger.h"
+#include "ns3/enum.h"
+#include "ns3/net-device.h"
+#include "ethernet-ecmp-group.h"
+
+NS_LOG_COMPONENT_DEFINE ("EthernetEcmpGroup");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (EthernetEcmpGroup);
+
+TypeId
+EthernetEcmpGroup::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetEcmpGroup")
+    .SetParent<Object> ()
+    .AddConstructor<EthernetEcmpGroup> ()
+    .AddAttribute ("Seed",
+                   "The seed of the flow hash.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&EthernetEcmpGroup::m_seed),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("HashFields",
+                   "The fields of the frames which are hashed.",
+                   EnumValue (L3L4),
+                   MakeEnumAccessor (&EthernetEcmpGroup::m_fields),
+                   MakeEnumChecker (L3L4, "L3L4",
+                                    L2, "L2"))
+    .AddAttribute ("Buckets",
+                   "The number of hash buckets shared among the members.",
+                   UintegerValue (256),
+                   MakeUintegerAccessor (&EthernetEcmpGroup::m_nBuckets),
+                   MakeUintegerChecker<uint32_t> (1))
+    ;
+  return tid;
+}
+
+EthernetEcmpGroup::EthernetEcmpGroup ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+EthernetEcmpGroup::~EthernetEcmpGroup ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+EthernetEcmpGroup::DoDispose (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_members.clear ();
+  m_buckets.clear ();
+  Object::DoDispose ();
+}
+
+void
+EthernetEcmpGroup::ResizeBuckets (void)
+{
+  m_buckets.resize (m_nBuckets);
+  for (uint32_t i = 0; i < m_nBuckets; ++i)
+    {
+      m_buckets[i] = m_members.empty () ? 0 : i % m_members.size ();
+    }
+}
+
+void
+EthernetEcmpGroup::AddMember (Ptr<NetDevice> device)
+{
+  NS_LOG_FUNCTION (device);
+  if (IsMember (device))
+    {
+      return;
+    }
+
+  m_members.push_back (device);
+  uint32_t n = m_members.size ();
+  if (n == 1 || m_buckets.size () != m_nBuckets)
+    {
+      ResizeBuckets ();
+      return;
+    }
+
+  //
+  // Hand the new member its fair share of buckets, taken from the members
+  // holding more than theirs.  No other bucket changes hands.
+  //
+  uint32_t share = m_nBuckets / n;
+  std::vector<uint32_t> load (n, 0);
+  for (uint32_t i = 0; i < m_nBuckets; ++i)
+    {
+      ++load[m_buckets[i]];
+    }
+  uint32_t moved = 0;
+  for (uint32_t i = 0; i < m_nBuckets && moved < share; ++i)
+    {
+      uint32_t owner = m_buckets[i];
+      if (load[owner] > share)
+        {
+          --load[owner];
+          m_buckets[i] = n - 1;
+          ++moved;
+        }
+    }
+}
+
+void
+EthernetEcmpGroup::RemoveMember (Ptr<NetDevice> device)
+{
+  NS_LOG_FUNCTION (device);
+  std::vector<Ptr<NetDevice> >::iterator it = std::find (m_members.begin (), m_members.end (), device);
+  if (it == m_members.end ())
+    {
+      return;
+    }
+  uint32_t removed = it - m_members.begin ();
+  m_members.erase (it);
+  if (m_members.empty () || m_buckets.size () != m_nBuckets)
+    {
+      ResizeBuckets ();
+      return;
+    }
+
+  //
+  // Renumber the buckets of the remaining members and give the orphaned
+  // ones, one at a time, to the least loaded member.
+  //
+  std::vector<uint32_t> load (m_members.size (), 0);
+  std::vector<uint32_t> orphans;
+  for (uint32_t i = 0; i < m_nBuckets; ++i)
+    {
+      if (m_buckets[i] == removed)
+        {
+          orphans.push_back (i);
+          continue;
+        }
+      if (m_buckets[i] > removed)
+        {
+          --m_buckets[i];
+        }
+      ++load[m_buckets[i]];
+    }
+  for (std::vector<uint32_t>::iterator i = orphans.begin (); i != orphans.end (); ++i)
+    {
+      uint32_t member = std::min_element (load.begin (), load.end ()) - load.begin ();
+      m_buckets[*i] = member;
+      ++load[member];
+    }
+}
+
+bool
+EthernetEcmpGroup::IsMember (Ptr<NetDevice> device) const
+{
+  return std::find (m_members.begin (), m_members.end (), device) != m_members.end ();
+}
+
+uint32_t
+EthernetEcmpGroup::GetNMembers (void) const
+{
+  return m_members.size ();
+}
+
+Ptr<NetDevice>
+EthernetEcmpGroup::GetMember (uint32_t i) const
+{
+  NS_ASSERT (i < m_members.size ());
+  return m_members[i];
+}
+
+Ptr<NetDevice>
+EthernetEcmpGroup::Select (Ptr<const Packet> packet, uint16_t protocol,
+                           Mac48Address src, Mac48Address dst) const
+{
+  if (m_members.empty ())
+    {
+      return 0;
+    }
+  if (m_members.size () == 1)
+    {
+      return m_members[0];
+    }
+  return m_members[m_buckets[Hash (packet, protocol, src, dst) % m_buckets.size ()]];
+}
+
+//
+// The MurmurHash3 block mix and finalizer: a few multiplies per word and a
+// good avalanche, which is all flow placement needs.
+//
+static inline uint32_t
+Mix (uint32_t h, uint32_t k)
+{
+  k *= 0xcc9e2d51;
+  k = (k << 15) | (k >> 17);
+  k *= 0x1b873593;
+  h ^= k;
+  h = (h << 13) | (h >> 19);
+  return h * 5 + 0xe6546b64;
+}
+
+static inline uint32_t
+Finalize (uint32_t h)
+{
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+static inline uint32_t
+Read32 (const uint8_t *p)
+{
+  return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+uint32_t
+EthernetEcmpGroup::Hash (Ptr<const Packet> packet, uint16_t protocol,
+                         Mac48Address src, Mac48Address dst) const
+{
+  static const uint16_t IPV4_PROT_NUMBER = 0x0800;
+  static const uint16_t IPV6_PROT_NUMBER = 0x86dd;
+  static const uint8_t TCP_PROT_NUMBER = 6;
+  static const uint8_t UDP_PROT_NUMBER = 17;
+
+  uint32_t h = m_seed;
+
+  if (m_fields == L3L4)
+    {
+      //
+      // Enough for an IPv4 header with options or an IPv6 header, and the
+      // TCP/UDP ports behind them.
+      //
+      uint8_t buf[64];
+      uint32_t size = packet->CopyData (buf, sizeof (buf));
+
+      if (protocol == IPV4_PROT_NUMBER && size >= 20 && (buf[0] >> 4) == 4)
+        {
+          uint32_t ihl = (buf[0] & 0x0f) * 4;
+          uint8_t proto = buf[9];
+          h = Mix (h, Read32 (buf + 12));
+          h = Mix (h, Read32 (buf + 16));
+          h = Mix (h, proto);
+          //
+          // Only unfragmented datagrams carry their ports in every frame;
+          // fragments of a datagram must all hash alike.
+          //
+          bool fragment = (buf[6] & 0x3f) || buf[7];
+          if ((proto == TCP_PROT_NUMBER || proto == UDP_PROT_NUMBER) && !fragment && size >= ihl + 4)
+            {
+              h = Mix (h, Read32 (buf + ihl));
+            }
+          return Finalize (h);
+        }
+      if (protocol == IPV6_PROT_NUMBER && size >= 40 && (buf[0] >> 4) == 6)
+        {
+          uint8_t proto = buf[6];
+          for (uint32_t i = 8; i < 40; i += 4)
+            {
+              h = Mix (h, Read32 (buf + i));
+            }
+          h = Mix (h, proto);
+          if ((proto == TCP_PROT_NUMBER || proto == UDP_PROT_NUMBER) && size >= 44)
+            {
+              h = Mix (h, Read32 (buf + 40));
+            }
+          return Finalize (h);
+        }
+    }
+
+  uint8_t mac[12];
+  src.CopyTo (mac);
+  dst.CopyTo (mac + 6);
+  h = Mix (h, Read32 (mac));
+  h = Mix (h, Read32 (mac + 4));
+  h = Mix (h, Read32 (mac + 8));
+  h = Mix (h, protocol);
+  return Finalize (h);
+}
+
+} // namespace ns3
@@ -0,0 +1,109 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_ECMP_GROUP_H
+#define ETHERNET_ECMP_GROUP_H
+
+#include <vector>
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include "ns3/packet.h"
+#include "ns3/mac48-address.h"
+
+namespace ns3 {
+
+class NetDevice;
+
+/**
+ * \brief A group of parallel egress devices selected by flow hash.
+ *
+ * Frames are hashed on their IPv4 or IPv6 5-tuple (addresses, protocol and
+ * TCP/UDP ports), or with HashFields L2 (and for non-IP frames) on their
+ * MAC addresses and protocol number.  The hash is seeded by the Seed
+ * attribute, so different tiers of a topology can use different seeds and
+ * avoid polarization.
+ *
+ * The hash indexes a table of Buckets entries, each naming a member.
+ * Adding a member moves just its fair share of buckets to it and removing
+ * one redistributes only its own buckets, so a membership change only
+ * moves the flows of the buckets involved (resilient hashing).
+ */
+class EthernetEcmpGroup : public Object
+{
+public:
+  enum HashFields
+    {
+      L3L4,
+      L2
+    };
+
+  static TypeId GetTypeId (void);
+
+  EthernetEcmpGroup ();
+  virtual ~EthernetEcmpGroup ();
+
+  /**
+   * @param device the device to add to the group
+   */
+  void AddMember (Ptr<NetDevice> device);
+  /**
+   * @param device the device to remove from the group
+   */
+  void RemoveMember (Ptr<NetDevice> device);
+  /**
+   * @param device a device
+   * @return true if the device is a member of the group
+   */
+  bool IsMember (Ptr<NetDevice> device) const;
+  uint32_t GetNMembers (void) const;
+  Ptr<NetDevice> GetMember (uint32_t i) const;
+
+  /**
+   * @param packet the frame payload, starting at the network header
+   * @param protocol the protocol number (EtherType) of the payload
+   * @param src the source MAC address
+   * @param dst the destination MAC address
+   * @return the member to send the frame through, or 0 if the group is empty
+   */
+  Ptr<NetDevice> Select (Ptr<const Packet> packet, uint16_t protocol,
+                         Mac48Address src, Mac48Address dst) const;
+  /**
+   * @return the flow hash of a frame, see Select
+   */
+  uint32_t Hash (Ptr<const Packet> packet, uint16_t protocol,
+                 Mac48Address src, Mac48Address dst) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  void ResizeBuckets (void);
+
+  uint32_t m_seed;
+  HashFields m_fields;
+  uint32_t m_nBuckets;
+
+  std::vector<Ptr<NetDevice> > m_members;
+  std::vector<uint32_t> m_buckets;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_ECMP_GROUP_H */
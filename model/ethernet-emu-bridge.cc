@@ -0,0 +1,571 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/enum.h"
+#include "ns3/string.h"
+#include "ns3/boolean.h"
+#include "ns3/mac48-address.h"
+#include "ethernet-emu-bridge.h"
+#include "ethernet-net-device.h"
+#include "ethernet-vlan-tag.h"
+#include "ethernet-vlan-header.h"
+
+//
+// After the ns-3 headers: the packet socket header defines PACKET_HOST and
+// friends as macros, which NetDevice::PacketType also names; use the NS3_
+// aliases of the latter.
+//
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+
+NS_LOG_COMPONENT_DEFINE ("EthernetEmuBridge");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (EthernetEmuBridge);
+
+static const uint32_t ETHERNET_HEADER_SIZE = 14;
+
+TypeId
+EthernetEmuBridge::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetEmuBridge")
+    .SetParent<Object> ()
+    .AddConstructor<EthernetEmuBridge> ()
+    .AddAttribute ("Mode",
+                   "How frames are exchanged with the real side.",
+                   EnumValue (PACKET_MMAP),
+                   MakeEnumAccessor (&EthernetEmuBridge::m_mode),
+                   MakeEnumChecker (PACKET_MMAP, "PacketMmap",
+                                    SOCKET, "Socket"))
+    .AddAttribute ("DeviceName",
+                   "The interface the packet socket is bound to, in PACKET_MMAP mode.",
+                   StringValue ("veth0"),
+                   MakeStringAccessor (&EthernetEmuBridge::m_deviceName),
+                   MakeStringChecker ())
+    .AddAttribute ("BlockSize",
+                   "The size of a block of the packet rings, a multiple of the page size and of FrameSize.",
+                   UintegerValue (1 << 20),
+                   MakeUintegerAccessor (&EthernetEmuBridge::m_blockSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("BlockCount",
+                   "The number of blocks of each packet ring.",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&EthernetEmuBridge::m_blockCount),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("FrameSize",
+                   "The room for a frame, with its ring header in PACKET_MMAP mode.",
+                   UintegerValue (2048),
+                   MakeUintegerAccessor (&EthernetEmuBridge::m_frameSize),
+                   MakeUintegerChecker<uint32_t> (128))
+    .AddAttribute ("BlockTimeout",
+                   "The time after which the kernel hands over a receive block which is not full.",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&EthernetEmuBridge::m_blockTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("BatchSize",
+                   "The number of frames handed to the descriptor at once.",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&EthernetEmuBridge::m_batchSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("PollInterval",
+                   "The time between two polls of the descriptor.",
+                   TimeValue (MicroSeconds (10)),
+                   MakeTimeAccessor (&EthernetEmuBridge::m_pollInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("ForwardOtherHost",
+                   "Whether the frames the device receives for other stations are written to the descriptor.",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&EthernetEmuBridge::m_forwardOtherHost),
+                   MakeBooleanChecker ())
+    ;
+  return tid;
+}
+
+EthernetEmuBridge::EthernetEmuBridge ()
+  : m_pvid (0),
+    m_fd (-1),
+    m_peerFd (-1),
+    m_ownsFd (false),
+    m_ring (0),
+    m_ringSize (0),
+    m_rxBlock (0),
+    m_txFrame (0),
+    m_txFrameCount (0),
+    m_nTxPending (0),
+    m_nReceived (0),
+    m_nSent (0),
+    m_nDropped (0)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+EthernetEmuBridge::~EthernetEmuBridge ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+EthernetEmuBridge::DoDispose (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  Stop ();
+  m_device = 0;
+  Object::DoDispose ();
+}
+
+void
+EthernetEmuBridge::SetDevice (Ptr<EthernetNetDevice> device)
+{
+  NS_LOG_FUNCTION (device);
+  m_device = device;
+}
+
+Ptr<EthernetNetDevice>
+EthernetEmuBridge::GetDevice (void) const
+{
+  return m_device;
+}
+
+void
+EthernetEmuBridge::SetFileDescriptor (int fd)
+{
+  NS_LOG_FUNCTION (fd);
+  NS_ABORT_MSG_IF (m_fd >= 0, "EthernetEmuBridge::SetFileDescriptor(): descriptor already set");
+  m_mode = SOCKET;
+  m_fd = fd;
+  m_ownsFd = false;
+}
+
+int
+EthernetEmuBridge::CreateSocketPair (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  NS_ABORT_MSG_IF (m_fd >= 0, "EthernetEmuBridge::CreateSocketPair(): descriptor already set");
+  int fds[2];
+  NS_ABORT_MSG_IF (socketpair (AF_UNIX, SOCK_SEQPACKET, 0, fds) < 0,
+                   "EthernetEmuBridge::CreateSocketPair(): " << std::strerror (errno));
+  m_mode = SOCKET;
+  m_fd = fds[0];
+  m_peerFd = fds[1];
+  m_ownsFd = true;
+  return m_peerFd;
+}
+
+void
+EthernetEmuBridge::Start (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  NS_ABORT_MSG_IF (m_device == 0, "EthernetEmuBridge::Start(): no device set");
+  if (m_pollEvent.IsRunning ())
+    {
+      return;
+    }
+
+  if (m_mode == PACKET_MMAP)
+    {
+      if (m_ring == 0)
+        {
+          OpenPacketSocket ();
+        }
+    }
+  else
+    {
+      NS_ABORT_MSG_IF (m_fd < 0, "EthernetEmuBridge::Start(): no descriptor set");
+      m_buffers.resize (2 * m_batchSize * m_frameSize);
+      m_txSizes.resize (m_batchSize);
+      m_messages.resize (2 * m_batchSize);
+      m_vectors.resize (2 * m_batchSize);
+      std::memset (&m_messages[0], 0, m_messages.size () * sizeof (struct mmsghdr));
+      for (uint32_t i = 0; i < 2 * m_batchSize; ++i)
+        {
+          m_vectors[i].iov_base = &m_buffers[i * m_frameSize];
+          m_vectors[i].iov_len = m_frameSize;
+          m_messages[i].msg_hdr.msg_iov = &m_vectors[i];
+          m_messages[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+  UintegerValue pvid;
+  m_device->GetAttribute ("Pvid", pvid);
+  m_pvid = pvid.Get ();
+  m_device->SetPromiscReceiveCallback (MakeCallback (&EthernetEmuBridge::Forward, this));
+  m_pollEvent = Simulator::ScheduleNow (&EthernetEmuBridge::Poll, this);
+}
+
+void
+EthernetEmuBridge::Stop (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  Simulator::Cancel (m_pollEvent);
+  if (m_device != 0)
+    {
+      m_device->SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback ());
+    }
+  if (m_fd >= 0)
+    {
+      Flush ();
+    }
+  m_nDropped += m_nTxPending;
+  if (m_ring != 0)
+    {
+      munmap (m_ring, m_ringSize);
+      m_ring = 0;
+    }
+  if (m_ownsFd && m_fd >= 0)
+    {
+      close (m_fd);
+    }
+  if (m_peerFd >= 0)
+    {
+      close (m_peerFd);
+    }
+  m_fd = -1;
+  m_peerFd = -1;
+  m_ownsFd = false;
+  m_nTxPending = 0;
+}
+
+void
+EthernetEmuBridge::OpenPacketSocket (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  NS_ABORT_MSG_IF (m_blockSize % getpagesize () || m_blockSize % m_frameSize,
+                   "EthernetEmuBridge::Start(): BlockSize must be a multiple of the page size and of FrameSize");
+
+  m_fd = socket (AF_PACKET, SOCK_RAW, htons (ETH_P_ALL));
+  NS_ABORT_MSG_IF (m_fd < 0, "EthernetEmuBridge::Start(): cannot open a packet socket: " << std::strerror (errno));
+  m_ownsFd = true;
+
+  int version = TPACKET_V3;
+  NS_ABORT_MSG_IF (setsockopt (m_fd, SOL_PACKET, PACKET_VERSION, &version, sizeof (version)) < 0,
+                   "EthernetEmuBridge::Start(): TPACKET_V3 unsupported: " << std::strerror (errno));
+#ifdef HAVE_PACKET_QDISC_BYPASS
+  //
+  // Frames sent from the ring skip the queueing discipline of the
+  // interface when the kernel allows it.
+  //
+  int bypass = 1;
+  setsockopt (m_fd, SOL_PACKET, PACKET_QDISC_BYPASS, &bypass, sizeof (bypass));
+#endif
+
+  struct tpacket_req3 req;
+  std::memset (&req, 0, sizeof (req));
+  req.tp_block_size = m_blockSize;
+  req.tp_block_nr = m_blockCount;
+  req.tp_frame_size = m_frameSize;
+  req.tp_frame_nr = m_blockSize / m_frameSize * m_blockCount;
+  req.tp_retire_blk_tov = std::max<int64_t> (m_blockTimeout.GetMilliSeconds (), 1);
+  NS_ABORT_MSG_IF (setsockopt (m_fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof (req)) < 0,
+                   "EthernetEmuBridge::Start(): cannot set up the receive ring: " << std::strerror (errno));
+  req.tp_retire_blk_tov = 0;
+  NS_ABORT_MSG_IF (setsockopt (m_fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof (req)) < 0,
+                   "EthernetEmuBridge::Start(): cannot set up the transmit ring: " << std::strerror (errno));
+  m_txFrameCount = req.tp_frame_nr;
+
+  //
+  // The receive ring comes first in the mapping, the transmit ring right
+  // after it.
+  //
+  m_ringSize = 2 * m_blockSize * m_blockCount;
+  void *ring = mmap (0, m_ringSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+  NS_ABORT_MSG_IF (ring == MAP_FAILED, "EthernetEmuBridge::Start(): cannot map the rings: " << std::strerror (errno));
+  m_ring = static_cast<uint8_t *> (ring);
+  m_rxBlock = 0;
+  m_txFrame = 0;
+
+  struct sockaddr_ll address;
+  std::memset (&address, 0, sizeof (address));
+  address.sll_family = AF_PACKET;
+  address.sll_protocol = htons (ETH_P_ALL);
+  address.sll_ifindex = if_nametoindex (m_deviceName.c_str ());
+  NS_ABORT_MSG_IF (address.sll_ifindex == 0, "EthernetEmuBridge::Start(): no interface " << m_deviceName);
+  NS_ABORT_MSG_IF (bind (m_fd, reinterpret_cast<struct sockaddr *> (&address), sizeof (address)) < 0,
+                   "EthernetEmuBridge::Start(): cannot bind to " << m_deviceName << ": " << std::strerror (errno));
+}
+
+void
+EthernetEmuBridge::Poll (void)
+{
+  if (m_mode == PACKET_MMAP)
+    {
+      ReceivePacketRing ();
+    }
+  else
+    {
+      ReceiveSocket ();
+    }
+  Flush ();
+  m_pollEvent = Simulator::Schedule (m_pollInterval, &EthernetEmuBridge::Poll, this);
+}
+
+void
+EthernetEmuBridge::ReceivePacketRing (void)
+{
+  //
+  // The kernel hands over whole blocks; their frames are read in place and
+  // the block is given back.
+  //
+  for (uint32_t n = 0; n < m_blockCount; ++n)
+    {
+      struct tpacket_block_desc *block =
+        reinterpret_cast<struct tpacket_block_desc *> (m_ring + m_rxBlock * m_blockSize);
+      if ((block->hdr.bh1.block_status & TP_STATUS_USER) == 0)
+        {
+          return;
+        }
+      __sync_synchronize ();
+
+      uint8_t *p = reinterpret_cast<uint8_t *> (block) + block->hdr.bh1.offset_to_first_pkt;
+      for (uint32_t i = 0; i < block->hdr.bh1.num_pkts; ++i)
+        {
+          struct tpacket3_hdr *header = reinterpret_cast<struct tpacket3_hdr *> (p);
+          struct sockaddr_ll *address =
+            reinterpret_cast<struct sockaddr_ll *> (p + TPACKET_ALIGN (sizeof (struct tpacket3_hdr)));
+          //
+          // The socket also sees the frames the bridge sends.
+          //
+          if (address->sll_pkttype != PACKET_OUTGOING)
+            {
+              if (header->tp_snaplen != header->tp_len)
+                {
+                  ++m_nDropped;
+                }
+              else
+                {
+                  Inject (p + header->tp_mac, header->tp_snaplen);
+                }
+            }
+          p += header->tp_next_offset;
+        }
+
+      __sync_synchronize ();
+      block->hdr.bh1.block_status = TP_STATUS_KERNEL;
+      m_rxBlock = (m_rxBlock + 1) % m_blockCount;
+    }
+}
+
+void
+EthernetEmuBridge::ReceiveSocket (void)
+{
+  int received;
+  do
+    {
+      received = recvmmsg (m_fd, &m_messages[0], m_batchSize, MSG_DONTWAIT, 0);
+      for (int i = 0; i < received; ++i)
+        {
+          if (m_messages[i].msg_hdr.msg_flags & MSG_TRUNC)
+            {
+              ++m_nDropped;
+              continue;
+            }
+          Inject (&m_buffers[i * m_frameSize], m_messages[i].msg_len);
+        }
+    }
+  while (received == static_cast<int> (m_batchSize));
+}
+
+void
+EthernetEmuBridge::Inject (const uint8_t *frame, uint32_t size)
+{
+  if (size < ETHERNET_HEADER_SIZE)
+    {
+      ++m_nDropped;
+      return;
+    }
+  ++m_nReceived;
+  Mac48Address destination;
+  Mac48Address source;
+  destination.CopyFrom (frame);
+  source.CopyFrom (frame + 6);
+  uint16_t protocol = (frame[12] << 8) | frame[13];
+  Ptr<Packet> packet = Create<Packet> (frame + ETHERNET_HEADER_SIZE, size - ETHERNET_HEADER_SIZE);
+  m_device->SendFrom (packet, source, destination, protocol);
+}
+
+bool
+EthernetEmuBridge::Forward (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                            const Address &from, const Address &to, NetDevice::PacketType packetType)
+{
+  if (packetType == NetDevice::NS3_PACKET_OTHERHOST && !m_forwardOtherHost)
+    {
+      return true;
+    }
+
+  //
+  // A VLAN-aware device hands over its frames with the 802.1Q header
+  // popped into a tag; put it back as the device would on transmit.
+  //
+  EthernetVlanTag tag;
+  bool tagged = m_device->GetVlanMode () != EthernetNetDevice::VLAN_NONE && packet->PeekPacketTag (tag)
+    && (tag.GetVid () != m_pvid || tag.GetPcp () != 0);
+  uint32_t headerSize = ETHERNET_HEADER_SIZE + (tagged ? EthernetVlanHeader::SIZE : 0);
+  uint32_t size = headerSize + packet->GetSize ();
+  uint8_t *frame;
+  struct tpacket3_hdr *slot = 0;
+  if (m_mode == PACKET_MMAP)
+    {
+      //
+      // Without PACKET_TX_HAS_OFF the kernel takes the frame right after
+      // the slot header.
+      //
+      static const uint32_t DATA_OFFSET = TPACKET3_HDRLEN - sizeof (struct sockaddr_ll);
+      slot = reinterpret_cast<struct tpacket3_hdr *> (m_ring + m_blockSize * m_blockCount + m_txFrame * m_frameSize);
+      if (slot->tp_status & (TP_STATUS_SEND_REQUEST | TP_STATUS_SENDING))
+        {
+          Flush ();
+        }
+      if (size > m_frameSize - DATA_OFFSET || (slot->tp_status & (TP_STATUS_SEND_REQUEST | TP_STATUS_SENDING)))
+        {
+          NS_LOG_LOGIC ("No room for a frame of " << size << " bytes, dropping");
+          ++m_nDropped;
+          return true;
+        }
+      frame = reinterpret_cast<uint8_t *> (slot) + DATA_OFFSET;
+      slot->tp_len = size;
+      slot->tp_snaplen = size;
+    }
+  else
+    {
+      if (size > m_frameSize)
+        {
+          ++m_nDropped;
+          return true;
+        }
+      frame = &m_buffers[(m_batchSize + m_nTxPending) * m_frameSize];
+      m_txSizes[m_nTxPending] = size;
+    }
+
+  Mac48Address::ConvertFrom (to).CopyTo (frame);
+  Mac48Address::ConvertFrom (from).CopyTo (frame + 6);
+  if (tagged)
+    {
+      uint16_t tci = (tag.GetPcp () << 13) | tag.GetVid ();
+      frame[12] = EthernetVlanHeader::TPID >> 8;
+      frame[13] = EthernetVlanHeader::TPID & 0xff;
+      frame[14] = tci >> 8;
+      frame[15] = tci & 0xff;
+    }
+  frame[headerSize - 2] = protocol >> 8;
+  frame[headerSize - 1] = protocol & 0xff;
+  packet->CopyData (frame + headerSize, packet->GetSize ());
+
+  if (slot != 0)
+    {
+      __sync_synchronize ();
+      slot->tp_status = TP_STATUS_SEND_REQUEST;
+      m_txFrame = (m_txFrame + 1) % m_txFrameCount;
+    }
+  if (++m_nTxPending >= m_batchSize)
+    {
+      Flush ();
+    }
+  return true;
+}
+
+void
+EthernetEmuBridge::Flush (void)
+{
+  if (m_nTxPending == 0)
+    {
+      return;
+    }
+
+  if (m_mode == PACKET_MMAP)
+    {
+      //
+      // One call sends every frame of the ring marked for sending; frames
+      // the kernel cannot take now stay marked and go with the next call.
+      // On any other error the frames still marked are taken back and
+      // dropped.
+      //
+      if (send (m_fd, 0, 0, MSG_DONTWAIT) >= 0)
+        {
+          m_nSent += m_nTxPending;
+          m_nTxPending = 0;
+        }
+      else if (errno != EAGAIN && errno != ENOBUFS)
+        {
+          NS_LOG_WARN ("EthernetEmuBridge::Flush(): " << std::strerror (errno));
+          for (uint32_t i = 1; i <= m_nTxPending; ++i)
+            {
+              uint32_t index = (m_txFrame + m_txFrameCount - i) % m_txFrameCount;
+              struct tpacket3_hdr *slot =
+                reinterpret_cast<struct tpacket3_hdr *> (m_ring + m_blockSize * m_blockCount + index * m_frameSize);
+              if (slot->tp_status & TP_STATUS_SEND_REQUEST)
+                {
+                  slot->tp_status = TP_STATUS_AVAILABLE;
+                  ++m_nDropped;
+                }
+              else
+                {
+                  ++m_nSent;
+                }
+            }
+          m_nTxPending = 0;
+        }
+      return;
+    }
+
+  for (uint32_t i = 0; i < m_nTxPending; ++i)
+    {
+      m_vectors[m_batchSize + i].iov_len = m_txSizes[i];
+    }
+  int sent = sendmmsg (m_fd, &m_messages[m_batchSize], m_nTxPending, MSG_DONTWAIT);
+  if (sent < 0)
+    {
+      sent = 0;
+    }
+  m_nSent += sent;
+  m_nDropped += m_nTxPending - sent;
+  m_nTxPending = 0;
+}
+
+uint64_t
+EthernetEmuBridge::GetNReceived (void) const
+{
+  return m_nReceived;
+}
+
+uint64_t
+EthernetEmuBridge::GetNSent (void) const
+{
+  return m_nSent;
+}
+
+uint64_t
+EthernetEmuBridge::GetNDropped (void) const
+{
+  return m_nDropped;
+}
+
+} // namespace ns3
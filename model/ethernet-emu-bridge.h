@@ -0,0 +1,196 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_EMU_BRIDGE_H
+#define ETHERNET_EMU_BRIDGE_H
+
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include "ns3/packet.h"
+#include "ns3/address.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/net-device.h"
+
+namespace ns3 {
+
+class EthernetNetDevice;
+
+/**
+ * \brief Connect a simulated Ethernet link to a real one.
+ *
+ * The bridge takes over an EthernetNetDevice, which then stands for the
+ * real side of its channel: the frames the device receives from the
+ * channel are written to a file descriptor, and the frames read from the
+ * descriptor are sent by the device into the channel.  The device should
+ * sit on a node without a protocol stack.
+ *
+ * In PACKET_MMAP mode the descriptor is an AF_PACKET socket bound to the
+ * DeviceName interface (a veth or a tap, say) with TPACKET_V3 receive and
+ * transmit rings mapped into the simulator.  Received frames are read in
+ * place from the blocks the kernel has filled, and frames to send are
+ * written into the transmit ring, which is handed to the kernel with a
+ * single call per batch: there is no system call, nor intermediate
+ * buffer, per frame.  In SOCKET mode the descriptor is a datagram or
+ * seqpacket socket carrying a frame per message, given by
+ * SetFileDescriptor or made by CreateSocketPair for tests; frames are
+ * moved BatchSize at a time with recvmmsg and sendmmsg.
+ *
+ * The descriptor is polled from the simulator thread every PollInterval,
+ * so frames need no hand-over between threads.  To keep pace with the
+ * real side, run the simulation with ns3::RealtimeSimulatorImpl; the poll
+ * interval and the batch size then bound the latency and the throughput.
+ *
+ * The frames of a VLAN-aware device are written with their 802.1Q header
+ * back in, unless they belong to the port VLAN with no priority, so the
+ * real side sees them as they were on the simulated wire.  With
+ * ForwardOtherHost off, only the frames addressed to the device, broadcast
+ * or multicast cross over.
+ */
+class EthernetEmuBridge : public Object
+{
+public:
+  enum Mode
+    {
+      PACKET_MMAP,
+      SOCKET
+    };
+
+  static TypeId GetTypeId (void);
+
+  EthernetEmuBridge ();
+  virtual ~EthernetEmuBridge ();
+
+  /**
+   * @param device the device standing for the real side of its channel
+   */
+  void SetDevice (Ptr<EthernetNetDevice> device);
+  /**
+   * @return the device standing for the real side of its channel
+   */
+  Ptr<EthernetNetDevice> GetDevice (void) const;
+  /**
+   * Use a socket opened elsewhere, switching to SOCKET mode.  The bridge
+   * does not close it.
+   *
+   * @param fd the socket
+   */
+  void SetFileDescriptor (int fd);
+  /**
+   * Create a pair of connected seqpacket sockets and use one of them,
+   * switching to SOCKET mode.  The bridge closes both when it stops.
+   *
+   * @return the other socket, which plays the real side
+   */
+  int CreateSocketPair (void);
+  /**
+   * Open the descriptor if needed and start moving frames.
+   */
+  void Start (void);
+  /**
+   * Stop moving frames and release the descriptor.
+   */
+  void Stop (void);
+
+  /**
+   * @return the number of frames read from the descriptor
+   */
+  uint64_t GetNReceived (void) const;
+  /**
+   * @return the number of frames written to the descriptor
+   */
+  uint64_t GetNSent (void) const;
+  /**
+   * @return the number of frames dropped: truncated by the receive ring,
+   * not fitting in a transmit slot, or refused by the descriptor
+   */
+  uint64_t GetNDropped (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  void OpenPacketSocket (void);
+  void Poll (void);
+  void ReceivePacketRing (void);
+  void ReceiveSocket (void);
+  /**
+   * Send a frame read from the descriptor into the channel.
+   */
+  void Inject (const uint8_t *frame, uint32_t size);
+  /**
+   * Queue a frame received from the channel for the descriptor.
+   */
+  bool Forward (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                const Address &from, const Address &to, NetDevice::PacketType packetType);
+  /**
+   * Hand the queued frames to the descriptor.
+   */
+  void Flush (void);
+
+  Ptr<EthernetNetDevice> m_device;
+  Mode m_mode;
+  std::string m_deviceName;
+  uint32_t m_blockSize;
+  uint32_t m_blockCount;
+  uint32_t m_frameSize;
+  Time m_blockTimeout;
+  uint32_t m_batchSize;
+  Time m_pollInterval;
+  bool m_forwardOtherHost;
+  uint16_t m_pvid;
+
+  int m_fd;
+  int m_peerFd;
+  bool m_ownsFd;
+  EventId m_pollEvent;
+
+  uint8_t *m_ring;
+  uint32_t m_ringSize;
+  uint32_t m_rxBlock;
+  uint32_t m_txFrame;
+  uint32_t m_txFrameCount;
+
+  /**
+   * SOCKET mode: BatchSize receive buffers of FrameSize bytes, then as
+   * many transmit buffers.
+   */
+  std::vector<uint8_t> m_buffers;
+  std::vector<uint32_t> m_txSizes;
+  /**
+   * SOCKET mode: the headers of recvmmsg and sendmmsg, one per buffer,
+   * set up once in Start.
+   */
+  std::vector<struct mmsghdr> m_messages;
+  std::vector<struct iovec> m_vectors;
+  uint32_t m_nTxPending;
+
+  uint64_t m_nReceived;
+  uint64_t m_nSent;
+  uint64_t m_nDropped;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_EMU_BRIDGE_H */
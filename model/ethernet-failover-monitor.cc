@@ -0,0 +1,205 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include <cmath>
+#include <algorithm>
+
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/net-device.h"
+#include "ethernet-failover-monitor.h"
+#include "ethernet-channel.h"
+
+NS_LOG_COMPONENT_DEFINE ("EthernetFailoverMonitor");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (EthernetFailoverMonitor);
+
+TypeId
+EthernetFailoverMonitor::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetFailoverMonitor")
+    .SetParent<Object> ()
+    .AddConstructor<EthernetFailoverMonitor> ()
+    .AddAttribute ("Interval",
+                   "The interval the receive rate is measured over.",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&EthernetFailoverMonitor::m_interval),
+                   MakeTimeChecker ())
+    .AddAttribute ("Threshold",
+                   "The fraction of the receive rate before a failure the traffic has reconverged at.",
+                   DoubleValue (0.9),
+                   MakeDoubleAccessor (&EthernetFailoverMonitor::m_threshold),
+                   MakeDoubleChecker<double> (0, 1))
+    ;
+  return tid;
+}
+
+EthernetFailoverMonitor::EthernetFailoverMonitor ()
+  : m_received (false),
+    m_converging (false)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+EthernetFailoverMonitor::~EthernetFailoverMonitor ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+EthernetFailoverMonitor::DoDispose (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_window.clear ();
+  Object::DoDispose ();
+}
+
+void
+EthernetFailoverMonitor::WatchChannel (Ptr<EthernetChannel> channel)
+{
+  NS_LOG_FUNCTION (channel);
+  channel->TraceConnectWithoutContext ("LinkChange", MakeCallback (&EthernetFailoverMonitor::LinkChange, this));
+}
+
+void
+EthernetFailoverMonitor::WatchDevice (Ptr<NetDevice> device)
+{
+  NS_LOG_FUNCTION (device);
+  bool connected = device->TraceConnectWithoutContext ("MacRx", MakeCallback (&EthernetFailoverMonitor::Receive, this));
+  NS_ABORT_MSG_UNLESS (connected, "EthernetFailoverMonitor::WatchDevice(): device has no MacRx trace");
+}
+
+uint32_t
+EthernetFailoverMonitor::GetNFailovers (void) const
+{
+  return m_failovers.size ();
+}
+
+const EthernetFailoverMonitor::Failover &
+EthernetFailoverMonitor::GetFailover (uint32_t i) const
+{
+  NS_ASSERT (i < m_failovers.size ());
+  return m_failovers[i];
+}
+
+void
+EthernetFailoverMonitor::Trim (void)
+{
+  Time start = Simulator::Now () - m_interval;
+  while (!m_window.empty () && m_window.front () < start)
+    {
+      m_window.pop_front ();
+    }
+}
+
+void
+EthernetFailoverMonitor::LinkChange (bool up)
+{
+  NS_LOG_FUNCTION (up);
+
+  Time never = Simulator::GetMaximumSimulationTime ();
+  if (up)
+    {
+      if (!m_failovers.empty () && m_failovers.back ().repair == never)
+        {
+          m_failovers.back ().repair = Simulator::Now ();
+        }
+      return;
+    }
+
+  Trim ();
+  Failover failover;
+  failover.failure = Simulator::Now ();
+  failover.repair = never;
+  failover.outage = Seconds (0);
+  failover.reconvergence = never;
+  failover.baseline = m_window.size ();
+  m_failovers.push_back (failover);
+  m_converging = true;
+  if (!m_received)
+    {
+      m_gapStart = failover.failure;
+    }
+}
+
+void
+EthernetFailoverMonitor::Receive (Ptr<const Packet> packet)
+{
+  Time now = Simulator::Now ();
+  m_window.push_back (now);
+  Trim ();
+
+  if (m_converging)
+    {
+      Failover &failover = m_failovers.back ();
+      failover.outage = std::max (failover.outage, now - m_gapStart);
+      //
+      // Reconverged once a whole interval after the failure carries the
+      // rate of the interval before it.
+      //
+      if (failover.baseline == 0)
+        {
+          failover.reconvergence = now - failover.failure;
+          m_converging = false;
+        }
+      else if (now - m_interval >= failover.failure
+               && m_window.size () >= std::ceil (m_threshold * failover.baseline))
+        {
+          failover.reconvergence = m_window.front () - failover.failure;
+          m_converging = false;
+        }
+      if (!m_converging)
+        {
+          NS_LOG_LOGIC ("Reconverged after " << failover.reconvergence << ", outage " << failover.outage);
+        }
+    }
+  m_gapStart = now;
+  m_received = true;
+}
+
+void
+EthernetFailoverMonitor::Print (std::ostream &os) const
+{
+  Time never = Simulator::GetMaximumSimulationTime ();
+  for (std::vector<Failover>::const_iterator i = m_failovers.begin (); i != m_failovers.end (); ++i)
+    {
+      os << "failure " << i->failure.GetSeconds () << "s";
+      if (i->repair != never)
+        {
+          os << " repair " << i->repair.GetSeconds () << "s";
+        }
+      if (i->reconvergence != never)
+        {
+          os << " outage " << i->outage.GetMicroSeconds () << "us"
+             << " reconvergence " << i->reconvergence.GetMicroSeconds () << "us";
+        }
+      else
+        {
+          os << " not reconverged";
+        }
+      os << std::endl;
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,128 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_FAILOVER_MONITOR_H
+#define ETHERNET_FAILOVER_MONITOR_H
+
+#include <deque>
+#include <vector>
+#include <ostream>
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include "ns3/packet.h"
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+class NetDevice;
+class EthernetChannel;
+
+/**
+ * \brief Measure how long traffic suffers from link failures.
+ *
+ * The monitor watches the link changes of one or more channels and the
+ * frames received by a set of devices, normally the receivers of steady
+ * traffic crossing the failing links.  For each failure it measures:
+ *
+ * - the outage: the longest time without any frame received from the
+ *   last frame before the failure until the traffic reconverges;
+ * - the reconvergence time: from the failure to the first frame of the
+ *   first Interval, entirely after the failure, which carries at least
+ *   Threshold times the frames of the Interval before the failure.
+ *
+ * A failure happening before the previous one reconverged ends the
+ * measurement of the previous one, which then never reconverges.
+ */
+class EthernetFailoverMonitor : public Object
+{
+public:
+  /**
+   * The measurements of a failure.  Times not known yet are the maximum
+   * simulation time.
+   */
+  struct Failover
+  {
+    Time failure;
+    Time repair;
+    Time outage;
+    Time reconvergence;
+    uint32_t baseline;
+  };
+
+  static TypeId GetTypeId (void);
+
+  EthernetFailoverMonitor ();
+  virtual ~EthernetFailoverMonitor ();
+
+  /**
+   * Measure the failures of a channel.
+   *
+   * @param channel the channel whose link goes down
+   */
+  void WatchChannel (Ptr<EthernetChannel> channel);
+  /**
+   * Count the frames a device receives, through its MacRx trace.
+   *
+   * @param device a receiver of the traffic
+   */
+  void WatchDevice (Ptr<NetDevice> device);
+  /**
+   * @return the number of failures seen
+   */
+  uint32_t GetNFailovers (void) const;
+  /**
+   * @param i the index of the failure, in time order
+   * @return its measurements
+   */
+  const Failover &GetFailover (uint32_t i) const;
+  /**
+   * Print the measurements, one line per failure.
+   *
+   * @param os the stream to print to
+   */
+  void Print (std::ostream &os) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  void LinkChange (bool up);
+  void Receive (Ptr<const Packet> packet);
+  /**
+   * Forget the frames received before the last Interval.
+   */
+  void Trim (void);
+
+  Time m_interval;
+  double m_threshold;
+
+  std::deque<Time> m_window;
+  /**
+   * The last frame received, or the failure if none was before it.
+   */
+  Time m_gapStart;
+  bool m_received;
+  bool m_converging;
+  std::vector<Failover> m_failovers;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_FAILOVER_MONITOR_H */
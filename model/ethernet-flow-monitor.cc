@@ -0,0 +1,516 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ns3/queue.h"
+#include "ns3/uinteger.h"
+#include "ethernet-flow-monitor.h"
+#include "ethernet-net-device.h"
+#include "ethernet-timestamp-tag.h"
+#include "ethernet-vlan-header.h"
+
+NS_LOG_COMPONENT_DEFINE ("EthernetFlowMonitor");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (EthernetFlowMonitor);
+
+static const uint32_t KEY_SIZE = 16;
+
+TypeId
+EthernetFlowMonitor::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetFlowMonitor")
+    .SetParent<Object> ()
+    .AddConstructor<EthernetFlowMonitor> ()
+    .AddAttribute ("MaxFlows",
+                   "The number of flows kept, the least recently seen are evicted beyond.",
+                   UintegerValue (65536),
+                   MakeUintegerAccessor (&EthernetFlowMonitor::m_maxFlows),
+                   MakeUintegerChecker<uint32_t> (1, 1 << 24))
+    ;
+  return tid;
+}
+
+EthernetFlowMonitor::EthernetFlowMonitor ()
+  : m_nFlows (0),
+    m_head (-1),
+    m_tail (-1),
+    m_evictions (0),
+    m_lastRxValid (false),
+    m_lastRxUid (0)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+EthernetFlowMonitor::~EthernetFlowMonitor ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+EthernetFlowMonitor::DoDispose (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_entries.clear ();
+  m_slots.clear ();
+  m_nFlows = 0;
+  m_head = -1;
+  m_tail = -1;
+  for (std::vector<Device>::iterator i = m_devices.begin (); i != m_devices.end (); ++i)
+    {
+      if (i->queue != 0)
+        {
+          i->queue->TraceDisconnectWithoutContext ("Drop", MakeCallback (&EthernetFlowMonitor::QueueDropFrame, this));
+        }
+    }
+  m_devices.clear ();
+  m_lastQueueDrop = 0;
+  Object::DoDispose ();
+}
+
+void
+EthernetFlowMonitor::Install (Ptr<EthernetNetDevice> device)
+{
+  NS_LOG_FUNCTION (device);
+  device->TraceConnectWithoutContext ("PhyTxEnd", MakeCallback (&EthernetFlowMonitor::TxFrame, this));
+  device->TraceConnectWithoutContext ("PhyRxEnd", MakeCallback (&EthernetFlowMonitor::RxFrame, this));
+  device->TraceConnectWithoutContext ("PhyRxDrop", MakeCallback (&EthernetFlowMonitor::DropFrame, this));
+  device->TraceConnectWithoutContext ("RxQueueDrop", MakeCallback (&EthernetFlowMonitor::RxQueueDropFrame, this));
+
+  std::ostringstream context;
+  context << m_devices.size ();
+  device->TraceConnect ("MacTxDrop", context.str (), MakeCallback (&EthernetFlowMonitor::TxDropFrame, this));
+
+  Device entry;
+  entry.device = device;
+  m_devices.push_back (entry);
+  HookQueue (m_devices.back ());
+}
+
+void
+EthernetFlowMonitor::HookQueue (Device &device)
+{
+  Ptr<Queue> queue = device.device->GetQueue ();
+  if (queue == device.queue)
+    {
+      return;
+    }
+  if (device.queue != 0)
+    {
+      device.queue->TraceDisconnectWithoutContext ("Drop", MakeCallback (&EthernetFlowMonitor::QueueDropFrame, this));
+    }
+  device.queue = queue;
+  if (queue != 0)
+    {
+      queue->TraceConnectWithoutContext ("Drop", MakeCallback (&EthernetFlowMonitor::QueueDropFrame, this));
+    }
+}
+
+uint32_t
+EthernetFlowMonitor::GetNFlows (void) const
+{
+  return m_nFlows;
+}
+
+uint64_t
+EthernetFlowMonitor::GetNEvictions (void) const
+{
+  return m_evictions;
+}
+
+void
+EthernetFlowMonitor::TxFrame (Ptr<const Packet> frame)
+{
+  Account (frame, TX);
+}
+
+void
+EthernetFlowMonitor::RxFrame (Ptr<const Packet> frame)
+{
+  Account (frame, RX);
+}
+
+void
+EthernetFlowMonitor::DropFrame (Ptr<const Packet> frame)
+{
+  Account (frame, DROP);
+}
+
+void
+EthernetFlowMonitor::QueueDropFrame (Ptr<const Packet> frame)
+{
+  Account (frame, DROP);
+  m_lastQueueDrop = frame;
+}
+
+void
+EthernetFlowMonitor::TxDropFrame (std::string context, Ptr<const Packet> frame)
+{
+  //
+  // The device may have been given a new transmit queue since the last
+  // look.  A frame the queue refused is traced here right after the queue
+  // traced it, and was counted then.
+  //
+  uint32_t index = atoi (context.c_str ());
+  NS_ASSERT (index < m_devices.size ());
+  HookQueue (m_devices[index]);
+  if (frame == m_lastQueueDrop)
+    {
+      m_lastQueueDrop = 0;
+      return;
+    }
+  Account (frame, DROP);
+}
+
+void
+EthernetFlowMonitor::RxQueueDropFrame (Ptr<const Packet> packet, uint32_t queue)
+{
+  if (!m_lastRxValid || packet->GetUid () != m_lastRxUid)
+    {
+      NS_LOG_LOGIC ("No received frame for the drop of packet " << packet->GetUid ());
+      return;
+    }
+  Count (m_lastRxKey, packet, DROP);
+}
+
+void
+EthernetFlowMonitor::Account (Ptr<const Packet> frame, Event event)
+{
+  uint8_t key[KEY_SIZE];
+  if (!ReadKey (frame, key))
+    {
+      return;
+    }
+  if (event == RX)
+    {
+      m_lastRxValid = true;
+      m_lastRxUid = frame->GetUid ();
+      memcpy (m_lastRxKey, key, KEY_SIZE);
+    }
+  Count (key, frame, event);
+}
+
+bool
+EthernetFlowMonitor::ReadKey (Ptr<const Packet> frame, uint8_t *key)
+{
+  //
+  // Enough for the addresses, an 802.1Q header and a LLC/SNAP header.
+  //
+  uint8_t header[26];
+  uint32_t size = frame->CopyData (header, sizeof (header));
+  if (size < 14)
+    {
+      return false;
+    }
+
+  memcpy (key, header + 6, 6);
+  memcpy (key + 6, header, 6);
+  uint32_t offset = 12;
+  uint16_t vid = 0;
+  uint16_t type = (header[12] << 8) | header[13];
+  if (type == EthernetVlanHeader::TPID && size >= 18)
+    {
+      vid = ((header[14] << 8) | header[15]) & 0x0fff;
+      offset = 16;
+      type = (header[16] << 8) | header[17];
+    }
+  if (type <= 1500 && size >= offset + 10)
+    {
+      type = (header[offset + 8] << 8) | header[offset + 9];
+    }
+  key[12] = type >> 8;
+  key[13] = type;
+  key[14] = vid >> 8;
+  key[15] = vid;
+  return true;
+}
+
+void
+EthernetFlowMonitor::Count (const uint8_t *key, Ptr<const Packet> frame, Event event)
+{
+  FlowStats &stats = Lookup (key).stats;
+  int64_t now = Simulator::Now ().GetNanoSeconds ();
+  stats.lastSeen = now;
+  switch (event)
+    {
+    case TX:
+      ++stats.txFrames;
+      stats.txBytes += frame->GetSize ();
+      break;
+    case RX:
+      {
+        ++stats.rxFrames;
+        stats.rxBytes += frame->GetSize ();
+        EthernetTimestampTag tag;
+        if (frame->PeekPacketTag (tag))
+          {
+            stats.latencySum += now - tag.GetOrigin ().GetNanoSeconds ();
+          }
+      }
+      break;
+    case DROP:
+      ++stats.drops;
+      break;
+    }
+}
+
+uint32_t
+EthernetFlowMonitor::Hash (const uint8_t *key)
+{
+  //
+  // FNV-1a: the key is short and the table only needs the low bits well
+  // spread.
+  //
+  uint32_t h = 2166136261u;
+  for (uint32_t i = 0; i < KEY_SIZE; ++i)
+    {
+      h = (h ^ key[i]) * 16777619u;
+    }
+  return h;
+}
+
+void
+EthernetFlowMonitor::Allocate (void)
+{
+  uint32_t nSlots = 2;
+  while (nSlots < 2 * m_maxFlows)
+    {
+      nSlots *= 2;
+    }
+  m_entries.resize (m_maxFlows);
+  m_slots.assign (nSlots, -1);
+}
+
+EthernetFlowMonitor::Entry &
+EthernetFlowMonitor::Lookup (const uint8_t *key)
+{
+  if (m_slots.empty ())
+    {
+      Allocate ();
+    }
+
+  uint32_t mask = m_slots.size () - 1;
+  uint32_t hash = Hash (key);
+  uint32_t slot = hash & mask;
+  while (m_slots[slot] >= 0)
+    {
+      int32_t index = m_slots[slot];
+      Entry &entry = m_entries[index];
+      if (entry.hash == hash && memcmp (entry.key, key, KEY_SIZE) == 0)
+        {
+          if (index != m_head)
+            {
+              Unlink (index);
+              PushFront (index);
+            }
+          return entry;
+        }
+      slot = (slot + 1) & mask;
+    }
+
+  int32_t index;
+  if (m_nFlows < m_maxFlows)
+    {
+      index = m_nFlows++;
+    }
+  else
+    {
+      index = m_tail;
+      NS_LOG_LOGIC ("Evicting flow " << m_entries[index].stats.source << " > " << m_entries[index].stats.destination);
+      Unlink (index);
+      RemoveSlot (m_entries[index].slot);
+      ++m_evictions;
+      //
+      // The removal may have shifted the entries in front of the free slot
+      // found above.
+      //
+      slot = hash & mask;
+      while (m_slots[slot] >= 0)
+        {
+          slot = (slot + 1) & mask;
+        }
+    }
+
+  Entry &entry = m_entries[index];
+  memcpy (entry.key, key, KEY_SIZE);
+  entry.hash = hash;
+  entry.slot = slot;
+  m_slots[slot] = index;
+  PushFront (index);
+
+  FlowStats &stats = entry.stats;
+  stats.source.CopyFrom (key);
+  stats.destination.CopyFrom (key + 6);
+  stats.etherType = (key[12] << 8) | key[13];
+  stats.vid = (key[14] << 8) | key[15];
+  stats.txFrames = 0;
+  stats.txBytes = 0;
+  stats.rxFrames = 0;
+  stats.rxBytes = 0;
+  stats.drops = 0;
+  stats.firstSeen = Simulator::Now ().GetNanoSeconds ();
+  stats.lastSeen = stats.firstSeen;
+  stats.latencySum = 0;
+  return entry;
+}
+
+void
+EthernetFlowMonitor::RemoveSlot (uint32_t slot)
+{
+  uint32_t mask = m_slots.size () - 1;
+  uint32_t hole = slot;
+  m_slots[hole] = -1;
+  for (uint32_t i = (hole + 1) & mask; m_slots[i] >= 0; i = (i + 1) & mask)
+    {
+      //
+      // An entry can fill the hole unless its home slot lies cyclically
+      // between the hole (excluded) and where it sits.
+      //
+      uint32_t home = m_entries[m_slots[i]].hash & mask;
+      bool stays = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+      if (!stays)
+        {
+          m_slots[hole] = m_slots[i];
+          m_entries[m_slots[hole]].slot = hole;
+          m_slots[i] = -1;
+          hole = i;
+        }
+    }
+}
+
+void
+EthernetFlowMonitor::Unlink (int32_t index)
+{
+  Entry &entry = m_entries[index];
+  if (entry.prev >= 0)
+    {
+      m_entries[entry.prev].next = entry.next;
+    }
+  else
+    {
+      m_head = entry.next;
+    }
+  if (entry.next >= 0)
+    {
+      m_entries[entry.next].prev = entry.prev;
+    }
+  else
+    {
+      m_tail = entry.prev;
+    }
+}
+
+void
+EthernetFlowMonitor::PushFront (int32_t index)
+{
+  Entry &entry = m_entries[index];
+  entry.prev = -1;
+  entry.next = m_head;
+  if (m_head >= 0)
+    {
+      m_entries[m_head].prev = index;
+    }
+  m_head = index;
+  if (m_tail < 0)
+    {
+      m_tail = index;
+    }
+}
+
+std::vector<EthernetFlowMonitor::FlowStats>
+EthernetFlowMonitor::GetFlowStats (void) const
+{
+  std::vector<FlowStats> flows;
+  flows.reserve (m_nFlows);
+  for (int32_t i = m_head; i >= 0; i = m_entries[i].next)
+    {
+      flows.push_back (m_entries[i].stats);
+    }
+  return flows;
+}
+
+void
+EthernetFlowMonitor::WriteCsv (std::string filename) const
+{
+  NS_LOG_FUNCTION (filename);
+  std::ofstream os (filename.c_str ());
+  NS_ABORT_MSG_UNLESS (os, "EthernetFlowMonitor::WriteCsv(): cannot open " << filename);
+  os << "source,destination,ethertype,vid,tx_frames,tx_bytes,rx_frames,rx_bytes,drops,"
+     << "first_seen_ns,last_seen_ns,latency_sum_ns" << std::endl;
+  for (int32_t i = m_head; i >= 0; i = m_entries[i].next)
+    {
+      const FlowStats &stats = m_entries[i].stats;
+      os << stats.source << ',' << stats.destination << ','
+         << "0x" << std::hex << std::setw (4) << std::setfill ('0') << stats.etherType
+         << std::dec << std::setfill (' ') << ','
+         << stats.vid << ','
+         << stats.txFrames << ',' << stats.txBytes << ','
+         << stats.rxFrames << ',' << stats.rxBytes << ','
+         << stats.drops << ','
+         << stats.firstSeen << ',' << stats.lastSeen << ','
+         << stats.latencySum << '\n';
+    }
+}
+
+static void
+WriteLittleEndian (std::ofstream &os, uint64_t value, uint32_t size)
+{
+  char buffer[8];
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      buffer[i] = (value >> (8 * i)) & 0xff;
+    }
+  os.write (buffer, size);
+}
+
+void
+EthernetFlowMonitor::WriteBinary (std::string filename) const
+{
+  NS_LOG_FUNCTION (filename);
+  std::ofstream os (filename.c_str (), std::ios::binary);
+  NS_ABORT_MSG_UNLESS (os, "EthernetFlowMonitor::WriteBinary(): cannot open " << filename);
+  os.write ("EFM1", 4);
+  for (int32_t i = m_head; i >= 0; i = m_entries[i].next)
+    {
+      const FlowStats &stats = m_entries[i].stats;
+      os.write (reinterpret_cast<const char *> (m_entries[i].key), 12);
+      WriteLittleEndian (os, stats.etherType, 2);
+      WriteLittleEndian (os, stats.vid, 2);
+      WriteLittleEndian (os, stats.txFrames, 8);
+      WriteLittleEndian (os, stats.txBytes, 8);
+      WriteLittleEndian (os, stats.rxFrames, 8);
+      WriteLittleEndian (os, stats.rxBytes, 8);
+      WriteLittleEndian (os, stats.drops, 8);
+      WriteLittleEndian (os, stats.firstSeen, 8);
+      WriteLittleEndian (os, stats.lastSeen, 8);
+      WriteLittleEndian (os, stats.latencySum, 8);
+    }
+}
+
+} // namespace ns3
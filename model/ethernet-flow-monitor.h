@@ -0,0 +1,216 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_FLOW_MONITOR_H
+#define ETHERNET_FLOW_MONITOR_H
+
+#include <string>
+#include <vector>
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include "ns3/packet.h"
+#include "ns3/mac48-address.h"
+
+namespace ns3 {
+
+class EthernetNetDevice;
+class Queue;
+
+/**
+ * \brief Per-flow accounting of Ethernet frames.
+ *
+ * A flow is a (source MAC, destination MAC, EtherType, VLAN) tuple read
+ * from the headers of the frames, so any traffic is accounted for, IP or
+ * not.  The monitor hooks the trace points of the devices it is installed
+ * on: frames are counted as sent when their transmission ends, as
+ * received when their reception ends, and as dropped when the device
+ * drops them before transmission (MacTxDrop, the transmit queue
+ * included), when the receive error model drops them, or when a receive
+ * queue is full.  The transmit queue is hooked too, and hooked again
+ * when the device is given a new one; its drops, which the device also
+ * traces as MacTxDrop, are counted once.  When the sender records
+ * latency histograms (see EthernetNetDevice::SetLatencyHistograms), the
+ * end-to-end latency of the frames received is added up too.
+ *
+ * The flows live in a flat open-addressed table of MaxFlows entries
+ * allocated up front.  Once it is full, the least recently seen flow is
+ * evicted to make room for a new one and its statistics are lost;
+ * GetNEvictions tells how many were.
+ */
+class EthernetFlowMonitor : public Object
+{
+public:
+  /**
+   * The statistics of a flow.  Times are in nanoseconds.
+   */
+  struct FlowStats
+  {
+    Mac48Address source;
+    Mac48Address destination;
+    uint16_t etherType;
+    uint16_t vid;
+    uint64_t txFrames;
+    uint64_t txBytes;
+    uint64_t rxFrames;
+    uint64_t rxBytes;
+    uint64_t drops;
+    int64_t firstSeen;
+    int64_t lastSeen;
+    int64_t latencySum;
+  };
+
+  static TypeId GetTypeId (void);
+
+  EthernetFlowMonitor ();
+  virtual ~EthernetFlowMonitor ();
+
+  /**
+   * Account for the frames sent, received and dropped by a device.
+   *
+   * @param device the device to monitor
+   */
+  void Install (Ptr<EthernetNetDevice> device);
+  /**
+   * @return the number of flows in the table
+   */
+  uint32_t GetNFlows (void) const;
+  /**
+   * @return the number of flows evicted from the table so far
+   */
+  uint64_t GetNEvictions (void) const;
+  /**
+   * @return the statistics of every flow in the table, the most recently
+   * seen first
+   */
+  std::vector<FlowStats> GetFlowStats (void) const;
+  /**
+   * Write the statistics of every flow to a CSV file, one line per flow
+   * after a line of column names.
+   *
+   * @param filename the file to write
+   */
+  void WriteCsv (std::string filename) const;
+  /**
+   * Write the statistics of every flow to a binary file: the four bytes
+   * "EFM1" followed by fixed 80-byte records, the source and destination
+   * MAC addresses, EtherType and VLAN (16 bits each), then the frame,
+   * byte and drop counters, first and last seen times and latency sum
+   * (64 bits each, in FlowStats order), all little-endian.
+   *
+   * @param filename the file to write
+   */
+  void WriteBinary (std::string filename) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  enum Event
+    {
+      TX,
+      RX,
+      DROP
+    };
+
+  struct Entry
+  {
+    FlowStats stats;
+    uint8_t key[16];
+    uint32_t hash;
+    int32_t slot;
+    int32_t prev;
+    int32_t next;
+  };
+
+  struct Device
+  {
+    Ptr<EthernetNetDevice> device;
+    Ptr<Queue> queue;
+  };
+
+  void TxFrame (Ptr<const Packet> frame);
+  void RxFrame (Ptr<const Packet> frame);
+  void DropFrame (Ptr<const Packet> frame);
+  void QueueDropFrame (Ptr<const Packet> frame);
+  /**
+   * @param context the index of the device in m_devices
+   */
+  void TxDropFrame (std::string context, Ptr<const Packet> frame);
+  /**
+   * A receive queue drops the frame without its header: count it against
+   * the flow of the frame whose reception just ended.
+   */
+  void RxQueueDropFrame (Ptr<const Packet> packet, uint32_t queue);
+  /**
+   * Connect to the Drop trace of the current transmit queue of a device,
+   * if it is not the one connected already.
+   */
+  void HookQueue (Device &device);
+  void Account (Ptr<const Packet> frame, Event event);
+  /**
+   * Read the flow key of a frame from its headers.
+   *
+   * @return false if the frame is too short to hold an Ethernet header
+   */
+  static bool ReadKey (Ptr<const Packet> frame, uint8_t *key);
+  void Count (const uint8_t *key, Ptr<const Packet> frame, Event event);
+  /**
+   * @return the entry of the flow, created if needed
+   */
+  Entry &Lookup (const uint8_t *key);
+  static uint32_t Hash (const uint8_t *key);
+  /**
+   * Remove an entry from the hash slots, shifting the entries probed past
+   * it back so that lookups still find them.
+   */
+  void RemoveSlot (uint32_t slot);
+  void Unlink (int32_t index);
+  void PushFront (int32_t index);
+  void Allocate (void);
+
+  uint32_t m_maxFlows;
+
+  std::vector<Entry> m_entries;
+  /**
+   * The index of the entry in each hash slot, -1 if empty.  A power of
+   * two at least twice MaxFlows.
+   */
+  std::vector<int32_t> m_slots;
+  uint32_t m_nFlows;
+  int32_t m_head;
+  int32_t m_tail;
+  uint64_t m_evictions;
+
+  std::vector<Device> m_devices;
+  /**
+   * The last frame the transmit queues dropped, traced again as MacTxDrop.
+   */
+  Ptr<const Packet> m_lastQueueDrop;
+  /**
+   * The uid and flow key of the last frame received, if any.
+   */
+  bool m_lastRxValid;
+  uint32_t m_lastRxUid;
+  uint8_t m_lastRxKey[16];
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_FLOW_MONITOR_H */
@@ -0,0 +1,146 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include "ns3/assert.h"
+#include "ethernet-fragment-header.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (EthernetFragmentHeader);
+
+TypeId
+EthernetFragmentHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetFragmentHeader")
+    .SetParent<Header> ()
+    .AddConstructor<EthernetFragmentHeader> ()
+    ;
+  return tid;
+}
+
+TypeId
+EthernetFragmentHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+EthernetFragmentHeader::EthernetFragmentHeader ()
+  : m_sequence (0),
+    m_index (0),
+    m_lengthType (0),
+    m_fragmentSize (0)
+{
+}
+
+void
+EthernetFragmentHeader::SetSequence (uint8_t sequence)
+{
+  m_sequence = sequence;
+}
+
+uint8_t
+EthernetFragmentHeader::GetSequence (void) const
+{
+  return m_sequence;
+}
+
+void
+EthernetFragmentHeader::SetIndex (uint8_t index)
+{
+  NS_ASSERT (index < 0x80);
+  m_index = (m_index & 0x80) | index;
+}
+
+uint8_t
+EthernetFragmentHeader::GetIndex (void) const
+{
+  return m_index & 0x7f;
+}
+
+void
+EthernetFragmentHeader::SetLast (bool last)
+{
+  m_index = (m_index & 0x7f) | (last ? 0x80 : 0);
+}
+
+bool
+EthernetFragmentHeader::IsLast (void) const
+{
+  return m_index & 0x80;
+}
+
+void
+EthernetFragmentHeader::SetLengthType (uint16_t lengthType)
+{
+  m_lengthType = lengthType;
+}
+
+uint16_t
+EthernetFragmentHeader::GetLengthType (void) const
+{
+  return m_lengthType;
+}
+
+void
+EthernetFragmentHeader::SetFragmentSize (uint16_t size)
+{
+  m_fragmentSize = size;
+}
+
+uint16_t
+EthernetFragmentHeader::GetFragmentSize (void) const
+{
+  return m_fragmentSize;
+}
+
+uint32_t
+EthernetFragmentHeader::GetSerializedSize (void) const
+{
+  return SIZE;
+}
+
+void
+EthernetFragmentHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteU8 (m_sequence);
+  start.WriteU8 (m_index);
+  start.WriteHtonU16 (m_lengthType);
+  start.WriteHtonU16 (m_fragmentSize);
+}
+
+uint32_t
+EthernetFragmentHeader::Deserialize (Buffer::Iterator start)
+{
+  m_sequence = start.ReadU8 ();
+  m_index = start.ReadU8 ();
+  m_lengthType = start.ReadNtohU16 ();
+  m_fragmentSize = start.ReadNtohU16 ();
+  return SIZE;
+}
+
+void
+EthernetFragmentHeader::Print (std::ostream &os) const
+{
+  os << "seq=" << (uint32_t) m_sequence << " index=" << (uint32_t) GetIndex ()
+     << (IsLast () ? " last" : "") << " length/type=0x" << std::hex << m_lengthType << std::dec
+     << " size=" << m_fragmentSize;
+}
+
+} // namespace ns3
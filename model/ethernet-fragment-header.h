@@ -0,0 +1,81 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_FRAGMENT_HEADER_H
+#define ETHERNET_FRAGMENT_HEADER_H
+
+#include "ns3/header.h"
+
+namespace ns3 {
+
+/**
+ * \brief The header of a fragment of a preempted Ethernet frame.
+ *
+ * EthernetNetDevice sends preemptible frames in fragments when frame
+ * preemption is enabled, so express frames can go out between them.
+ * Every fragment is a frame of its own with the local experimental
+ * EtherType 0x88b5, starting with this header: the sequence number of the
+ * original frame, the index of the fragment with a last-fragment flag, the
+ * length/type of the original frame and the number of payload bytes in
+ * the fragment (the rest is padding).
+ */
+class EthernetFragmentHeader : public Header
+{
+public:
+  /**
+   * The length/type of the frames carrying fragments.
+   */
+  static const uint16_t ETHERTYPE = 0x88b5;
+  static const uint32_t SIZE = 6;
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  EthernetFragmentHeader ();
+
+  void SetSequence (uint8_t sequence);
+  uint8_t GetSequence (void) const;
+  /**
+   * @param index the index of the fragment in the frame, below 128
+   */
+  void SetIndex (uint8_t index);
+  uint8_t GetIndex (void) const;
+  void SetLast (bool last);
+  bool IsLast (void) const;
+  void SetLengthType (uint16_t lengthType);
+  uint16_t GetLengthType (void) const;
+  void SetFragmentSize (uint16_t size);
+  uint16_t GetFragmentSize (void) const;
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+private:
+  uint8_t m_sequence;
+  uint8_t m_index;
+  uint16_t m_lengthType;
+  uint16_t m_fragmentSize;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_FRAGMENT_HEADER_H */
@@ -0,0 +1,201 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include <algorithm>
+
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ns3/queue.h"
+#include "ns3/uinteger.h"
+#include "ns3/trace-source-accessor.h"
+#include "ethernet-frame-generator.h"
+#include "ethernet-net-device.h"
+
+NS_LOG_COMPONENT_DEFINE ("EthernetFrameGenerator");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (EthernetFrameGenerator);
+
+TypeId
+EthernetFrameGenerator::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetFrameGenerator")
+    .SetParent<Application> ()
+    .AddConstructor<EthernetFrameGenerator> ()
+    .AddAttribute ("Destination",
+                   "The destination MAC address of the frames.",
+                   Mac48AddressValue (Mac48Address ("ff:ff:ff:ff:ff:ff")),
+                   MakeMac48AddressAccessor (&EthernetFrameGenerator::m_destination),
+                   MakeMac48AddressChecker ())
+    .AddAttribute ("Protocol",
+                   "The protocol number (EtherType) of the frames.",
+                   UintegerValue (0x88b5),
+                   MakeUintegerAccessor (&EthernetFrameGenerator::m_protocol),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("FrameSize",
+                   "The payload size of each frame, in bytes.  Values are clamped to the device MTU.",
+                   RandomVariableValue (ConstantVariable (1500)),
+                   MakeRandomVariableAccessor (&EthernetFrameGenerator::m_frameSize),
+                   MakeRandomVariableChecker ())
+    .AddAttribute ("InterArrival",
+                   "The time between bursts, in seconds.  Zero keeps the link saturated.",
+                   RandomVariableValue (ConstantVariable (0)),
+                   MakeRandomVariableAccessor (&EthernetFrameGenerator::m_interArrival),
+                   MakeRandomVariableChecker ())
+    .AddAttribute ("BurstSize",
+                   "The number of frames in a burst when InterArrival is not zero.",
+                   RandomVariableValue (ConstantVariable (1)),
+                   MakeRandomVariableAccessor (&EthernetFrameGenerator::m_burstSize),
+                   MakeRandomVariableChecker ())
+    .AddAttribute ("Backlog",
+                   "The number of frames kept in the transmit queue when saturating the link.",
+                   UintegerValue (32),
+                   MakeUintegerAccessor (&EthernetFrameGenerator::m_backlog),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("MaxFrames",
+                   "The total number of frames to send.  Zero means no limit.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&EthernetFrameGenerator::m_maxFrames),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddTraceSource ("Tx",
+                     "A frame payload is being handed to the device",
+                     MakeTraceSourceAccessor (&EthernetFrameGenerator::m_txTrace))
+    ;
+  return tid;
+}
+
+EthernetFrameGenerator::EthernetFrameGenerator ()
+  : m_nFrames (0)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+EthernetFrameGenerator::~EthernetFrameGenerator ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+EthernetFrameGenerator::DoDispose (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_device = 0;
+  m_template = 0;
+  Application::DoDispose ();
+}
+
+void
+EthernetFrameGenerator::SetDevice (Ptr<EthernetNetDevice> device)
+{
+  NS_LOG_FUNCTION (device);
+  m_device = device;
+}
+
+Ptr<EthernetNetDevice>
+EthernetFrameGenerator::GetDevice (void) const
+{
+  return m_device;
+}
+
+uint64_t
+EthernetFrameGenerator::GetNFrames (void) const
+{
+  return m_nFrames;
+}
+
+void
+EthernetFrameGenerator::StartApplication (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  NS_ABORT_MSG_IF (m_device == 0, "EthernetFrameGenerator::StartApplication(): no device set");
+
+  //
+  // Every frame is a fragment of this packet, so they all share its buffer
+  // until somebody writes to them.
+  //
+  m_template = Create<Packet> (m_device->GetMtu ());
+  SendBurst ();
+}
+
+void
+EthernetFrameGenerator::StopApplication (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  Simulator::Cancel (m_burstEvent);
+  NS_LOG_INFO ("Generated " << m_nFrames << " frames");
+}
+
+bool
+EthernetFrameGenerator::SendFrame (void)
+{
+  if (m_maxFrames != 0 && m_nFrames >= m_maxFrames)
+    {
+      return false;
+    }
+
+  uint32_t size = std::min<uint32_t> (m_frameSize.GetInteger (), m_template->GetSize ());
+  Ptr<Packet> packet = m_template->CreateFragment (0, size);
+  m_txTrace (packet);
+  if (!m_device->Send (packet, m_destination, m_protocol))
+    {
+      return false;
+    }
+  ++m_nFrames;
+  return true;
+}
+
+void
+EthernetFrameGenerator::SendBurst (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  Time gap = Seconds (m_interArrival.GetValue ());
+  if (gap.IsZero ())
+    {
+      //
+      // Saturating: fill the queue up to the backlog, and come back when
+      // half of it is gone.  The first frame of a burst may start an idle
+      // transmitter, the others are queued behind it.
+      //
+      Ptr<Queue> queue = m_device->GetQueue ();
+      while (queue->GetNPackets () < m_backlog && SendFrame ())
+        {
+        }
+
+      uint32_t bytes = std::max<uint32_t> (queue->GetNBytes () / 2, m_template->GetSize ());
+      gap = m_device->GetDataRate ().CalculateTxTime (bytes);
+    }
+  else
+    {
+      uint32_t burst = m_burstSize.GetInteger ();
+      for (uint32_t i = 0; i < burst && SendFrame (); ++i)
+        {
+        }
+    }
+
+  if (m_maxFrames == 0 || m_nFrames < m_maxFrames)
+    {
+      m_burstEvent = Simulator::Schedule (gap, &EthernetFrameGenerator::SendBurst, this);
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,101 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_FRAME_GENERATOR_H
+#define ETHERNET_FRAME_GENERATOR_H
+
+#include "ns3/application.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+#include "ns3/packet.h"
+#include "ns3/mac48-address.h"
+#include "ns3/random-variable.h"
+#include "ns3/traced-callback.h"
+
+namespace ns3 {
+
+class EthernetNetDevice;
+
+/**
+ * \brief Generate Ethernet frames directly into an EthernetNetDevice.
+ *
+ * The generator works in bursts: one event hands a whole batch of frames
+ * to the device.  All frames share the payload of a single template packet
+ * (copy-on-write), and while the device queue is backlogged they are framed
+ * from the device header cache, so a frame costs neither a packet
+ * construction nor an application event.
+ *
+ * When InterArrival is zero (the default) the generator keeps the link
+ * saturated: each burst tops the transmit queue up to Backlog frames and
+ * the next burst is scheduled when half of the queued bytes have drained
+ * at the channel data rate.  Otherwise bursts of BurstSize frames are sent
+ * InterArrival apart.
+ */
+class EthernetFrameGenerator : public Application
+{
+public:
+  static TypeId GetTypeId (void);
+
+  EthernetFrameGenerator ();
+  virtual ~EthernetFrameGenerator ();
+
+  /**
+   * @param device the device to send the frames through
+   */
+  void SetDevice (Ptr<EthernetNetDevice> device);
+  /**
+   * @return the device frames are sent through
+   */
+  Ptr<EthernetNetDevice> GetDevice (void) const;
+  /**
+   * @return the number of frames handed to the device so far
+   */
+  uint64_t GetNFrames (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+  void SendBurst (void);
+  bool SendFrame (void);
+
+  Ptr<EthernetNetDevice> m_device;
+  Mac48Address m_destination;
+  uint16_t m_protocol;
+  RandomVariable m_frameSize;
+  RandomVariable m_interArrival;
+  RandomVariable m_burstSize;
+  uint32_t m_backlog;
+  uint64_t m_maxFrames;
+
+  Ptr<Packet> m_template;
+  EventId m_burstEvent;
+  uint64_t m_nFrames;
+
+  TracedCallback<Ptr<const Packet> > m_txTrace;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_FRAME_GENERATOR_H */
@@ -0,0 +1,206 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/header.h"
+#include "ns3/ethernet-header.h"
+#include "ns3/ethernet-trailer.h"
+#include "ns3/llc-snap-header.h"
+#include "ethernet-header-cache.h"
+
+NS_LOG_COMPONENT_DEFINE ("EthernetHeaderCache");
+
+namespace ns3 {
+
+/**
+ * A header made of bytes serialized in advance.  It reports the TypeId of
+ * the header it stands for, so the packet metadata stays consistent with
+ * what the receiver removes.
+ */
+class PreSerializedHeader : public Header
+{
+public:
+  PreSerializedHeader (TypeId tid, const uint8_t *data, uint32_t size)
+    : m_tid (tid),
+      m_data (data),
+      m_size (size)
+  {
+  }
+  virtual TypeId GetInstanceTypeId (void) const
+  {
+    return m_tid;
+  }
+  virtual uint32_t GetSerializedSize (void) const
+  {
+    return m_size;
+  }
+  virtual void Serialize (Buffer::Iterator start) const
+  {
+    start.Write (m_data, m_size);
+  }
+  virtual uint32_t Deserialize (Buffer::Iterator start)
+  {
+    NS_FATAL_ERROR ("PreSerializedHeader::Deserialize(): not supported");
+    return 0;
+  }
+  virtual void Print (std::ostream &os) const
+  {
+    os << "pre-serialized " << m_size << " bytes";
+  }
+
+private:
+  TypeId m_tid;
+  const uint8_t *m_data;
+  uint32_t m_size;
+};
+
+EthernetHeaderCache::EthernetHeaderCache ()
+  : m_next (0)
+{
+  Flush ();
+}
+
+void
+EthernetHeaderCache::SetSource (Mac48Address source)
+{
+  NS_LOG_FUNCTION (source);
+  m_source = source;
+  Flush ();
+}
+
+void
+EthernetHeaderCache::Flush (void)
+{
+  for (uint32_t i = 0; i < N_ENTRIES; ++i)
+    {
+      m_entries[i].valid = false;
+    }
+  m_next = 0;
+}
+
+EthernetHeaderCache::Entry &
+EthernetHeaderCache::Lookup (Mac48Address dest, uint16_t protocolNumber, CsmaNetDevice::EncapsulationMode mode)
+{
+  for (uint32_t i = 0; i < N_ENTRIES; ++i)
+    {
+      Entry &entry = m_entries[i];
+      if (entry.valid && entry.protocol == protocolNumber && entry.mode == mode && entry.dest == dest)
+        {
+          return entry;
+        }
+    }
+
+  NS_LOG_LOGIC ("Caching header for " << dest << " protocol " << protocolNumber);
+
+  //
+  // Replace entries round-robin.  The cache is meant for a few neighbors,
+  // anything smarter costs more than it saves.
+  //
+  Entry &entry = m_entries[m_next];
+  m_next = (m_next + 1) % N_ENTRIES;
+
+  entry.dest = dest;
+  entry.protocol = protocolNumber;
+  entry.mode = mode;
+  entry.valid = true;
+
+  //
+  // Same layout as EthernetHeader (without preamble) and LlcSnapHeader
+  // serialize to.  In LLC mode the length field depends on the packet and
+  // is patched in for every frame.
+  //
+  dest.CopyTo (entry.ethernet);
+  m_source.CopyTo (entry.ethernet + 6);
+  entry.ethernet[12] = (protocolNumber >> 8) & 0xff;
+  entry.ethernet[13] = protocolNumber & 0xff;
+
+  entry.llc[0] = 0xaa;
+  entry.llc[1] = 0xaa;
+  entry.llc[2] = 0x03;
+  entry.llc[3] = 0;
+  entry.llc[4] = 0;
+  entry.llc[5] = 0;
+  entry.llc[6] = (protocolNumber >> 8) & 0xff;
+  entry.llc[7] = protocolNumber & 0xff;
+
+  return entry;
+}
+
+void
+EthernetHeaderCache::AddHeader (Ptr<Packet> p, Mac48Address dest, uint16_t protocolNumber,
+                                CsmaNetDevice::EncapsulationMode mode)
+{
+  switch (mode)
+    {
+    case CsmaNetDevice::DIX:
+      AddHeader<CsmaNetDevice::DIX> (p, dest, protocolNumber);
+      break;
+    case CsmaNetDevice::LLC:
+      AddHeader<CsmaNetDevice::LLC> (p, dest, protocolNumber);
+      break;
+    case CsmaNetDevice::ILLEGAL:
+    default:
+      NS_FATAL_ERROR ("EthernetHeaderCache::AddHeader(): Unknown packet encapsulation mode");
+      break;
+    }
+}
+
+template <CsmaNetDevice::EncapsulationMode Mode>
+void
+EthernetHeaderCache::AddHeader (Ptr<Packet> p, Mac48Address dest, uint16_t protocolNumber)
+{
+  NS_LOG_FUNCTION (p << dest << protocolNumber << Mode);
+
+  Entry &entry = Lookup (dest, protocolNumber, Mode);
+
+  if (Mode == CsmaNetDevice::LLC)
+    {
+      p->AddHeader (PreSerializedHeader (LlcSnapHeader::GetTypeId (), entry.llc, LLC_SNAP_HEADER_SIZE));
+      uint16_t lengthType = p->GetSize ();
+      entry.ethernet[12] = (lengthType >> 8) & 0xff;
+      entry.ethernet[13] = lengthType & 0xff;
+    }
+
+  //
+  // All Ethernet frames must carry a minimum payload of 46 bytes.  As in
+  // CsmaNetDevice these must be real bytes, they end up in pcap files.
+  //
+  if (p->GetSize () < MIN_PAYLOAD_SIZE)
+    {
+      static const uint8_t zeroes[MIN_PAYLOAD_SIZE] = { 0 };
+      p->AddAtEnd (Create<Packet> (zeroes, MIN_PAYLOAD_SIZE - p->GetSize ()));
+    }
+
+  p->AddHeader (PreSerializedHeader (EthernetHeader::GetTypeId (), entry.ethernet, ETHERNET_HEADER_SIZE));
+
+  EthernetTrailer trailer;
+  if (Node::ChecksumEnabled ())
+    {
+      trailer.EnableFcs (true);
+    }
+  trailer.CalcFcs (p);
+  p->AddTrailer (trailer);
+}
+
+template void EthernetHeaderCache::AddHeader<CsmaNetDevice::DIX> (Ptr<Packet>, Mac48Address, uint16_t);
+template void EthernetHeaderCache::AddHeader<CsmaNetDevice::LLC> (Ptr<Packet>, Mac48Address, uint16_t);
+
+} // namespace ns3
@@ -0,0 +1,101 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_HEADER_CACHE_H
+#define ETHERNET_HEADER_CACHE_H
+
+#include "ns3/ptr.h"
+#include "ns3/packet.h"
+#include "ns3/mac48-address.h"
+#include "ns3/csma-net-device.h"
+
+namespace ns3 {
+
+/**
+ * \brief A small cache of pre-serialized Ethernet headers.
+ *
+ * A device usually talks to a handful of neighbors, so the 14 (DIX) or
+ * 22 (LLC/SNAP) header bytes of its frames are nearly constant.  The cache
+ * keeps them serialized, keyed by (destination, protocol, encapsulation
+ * mode), and stamps them into a packet with a single copy.
+ *
+ * The resulting frame is byte-for-byte the one CsmaNetDevice builds
+ * (including the minimum payload padding and the trailer), and the packet
+ * metadata records the usual EthernetHeader and LlcSnapHeader chunks, so
+ * receivers, pcap and ascii traces see no difference.
+ */
+class EthernetHeaderCache
+{
+public:
+  EthernetHeaderCache ();
+  /**
+   * Set the source address stamped into every header.  This flushes the
+   * cache.
+   *
+   * @param source the MAC address of the owning device
+   */
+  void SetSource (Mac48Address source);
+  /**
+   * Drop all the cached headers.
+   */
+  void Flush (void);
+  /**
+   * Frame a packet the way CsmaNetDevice::AddHeader does.
+   *
+   * @param p the packet to frame
+   * @param dest the destination MAC address
+   * @param protocolNumber the protocol (EtherType) of the payload
+   * @param mode the encapsulation mode to use
+   */
+  void AddHeader (Ptr<Packet> p, Mac48Address dest, uint16_t protocolNumber,
+                  CsmaNetDevice::EncapsulationMode mode);
+  /**
+   * Same as above with the encapsulation mode fixed at compile time.
+   * Instantiated for CsmaNetDevice::DIX and CsmaNetDevice::LLC.
+   */
+  template <CsmaNetDevice::EncapsulationMode Mode>
+  void AddHeader (Ptr<Packet> p, Mac48Address dest, uint16_t protocolNumber);
+
+private:
+  static const uint32_t N_ENTRIES = 8;
+  static const uint32_t ETHERNET_HEADER_SIZE = 14;
+  static const uint32_t LLC_SNAP_HEADER_SIZE = 8;
+  static const uint32_t MIN_PAYLOAD_SIZE = 46;
+
+  struct Entry
+  {
+    Mac48Address dest;
+    uint16_t protocol;
+    CsmaNetDevice::EncapsulationMode mode;
+    bool valid;
+    uint8_t ethernet[ETHERNET_HEADER_SIZE];
+    uint8_t llc[LLC_SNAP_HEADER_SIZE];
+  };
+
+  Entry &Lookup (Mac48Address dest, uint16_t protocolNumber, CsmaNetDevice::EncapsulationMode mode);
+
+  Mac48Address m_source;
+  Entry m_entries[N_ENTRIES];
+  uint32_t m_next;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_HEADER_CACHE_H */
@@ -0,0 +1,176 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include <algorithm>
+
+#include "ns3/assert.h"
+#include "ethernet-latency-histogram.h"
+
+namespace ns3 {
+
+EthernetLatencyHistogram::EthernetLatencyHistogram (uint32_t subBucketBits, uint32_t maxValueBits)
+  : m_subBucketBits (subBucketBits),
+    m_maxValueBits (maxValueBits),
+    m_count (0),
+    m_min (0),
+    m_max (0),
+    m_sum (0)
+{
+  NS_ASSERT (subBucketBits >= 2 && subBucketBits < maxValueBits && maxValueBits <= 63);
+}
+
+uint32_t
+EthernetLatencyHistogram::GetIndex (uint64_t value) const
+{
+  uint64_t exact = 1ULL << m_subBucketBits;
+  if (value < exact)
+    {
+      return value;
+    }
+  if (value >= (1ULL << m_maxValueBits))
+    {
+      value = (1ULL << m_maxValueBits) - 1;
+    }
+
+  uint32_t msb = 63;
+  while ((value & (1ULL << msb)) == 0)
+    {
+      --msb;
+    }
+  uint32_t shift = msb - m_subBucketBits + 1;
+  uint64_t half = exact >> 1;
+  uint64_t sub = value >> shift;
+  return exact + (shift - 1) * half + (sub - half);
+}
+
+uint64_t
+EthernetLatencyHistogram::GetHighestEquivalentValue (uint32_t index) const
+{
+  uint64_t exact = 1ULL << m_subBucketBits;
+  if (index < exact)
+    {
+      return index;
+    }
+  uint64_t half = exact >> 1;
+  uint32_t shift = (index - exact) / half + 1;
+  uint64_t sub = (index - exact) % half + half;
+  return ((sub + 1) << shift) - 1;
+}
+
+void
+EthernetLatencyHistogram::Record (Time latency)
+{
+  int64_t ns = latency.GetNanoSeconds ();
+  uint64_t value = ns < 0 ? 0 : ns;
+
+  if (m_counts.empty ())
+    {
+      uint64_t half = (1ULL << m_subBucketBits) >> 1;
+      m_counts.resize ((1ULL << m_subBucketBits) + (m_maxValueBits - m_subBucketBits) * half, 0);
+    }
+
+  ++m_counts[GetIndex (value)];
+  if (m_count == 0 || value < m_min)
+    {
+      m_min = value;
+    }
+  if (value > m_max)
+    {
+      m_max = value;
+    }
+  ++m_count;
+  m_sum += value;
+}
+
+void
+EthernetLatencyHistogram::Reset (void)
+{
+  std::fill (m_counts.begin (), m_counts.end (), 0);
+  m_count = 0;
+  m_min = 0;
+  m_max = 0;
+  m_sum = 0;
+}
+
+uint64_t
+EthernetLatencyHistogram::GetCount (void) const
+{
+  return m_count;
+}
+
+Time
+EthernetLatencyHistogram::GetMin (void) const
+{
+  return NanoSeconds (m_min);
+}
+
+Time
+EthernetLatencyHistogram::GetMax (void) const
+{
+  return NanoSeconds (m_max);
+}
+
+Time
+EthernetLatencyHistogram::GetMean (void) const
+{
+  if (m_count == 0)
+    {
+      return Seconds (0);
+    }
+  return NanoSeconds (static_cast<uint64_t> (m_sum / m_count));
+}
+
+Time
+EthernetLatencyHistogram::GetPercentile (double percentile) const
+{
+  if (m_count == 0)
+    {
+      return Seconds (0);
+    }
+
+  uint64_t rank = static_cast<uint64_t> (percentile / 100.0 * m_count + 0.5);
+  rank = std::max<uint64_t> (rank, 1);
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < m_counts.size (); ++i)
+    {
+      seen += m_counts[i];
+      if (seen >= rank)
+        {
+          return NanoSeconds (std::min (GetHighestEquivalentValue (i), m_max));
+        }
+    }
+  return NanoSeconds (m_max);
+}
+
+void
+EthernetLatencyHistogram::Print (std::ostream &os) const
+{
+  os << "count=" << m_count
+     << " min=" << GetMin ().GetNanoSeconds ()
+     << " mean=" << GetMean ().GetNanoSeconds ()
+     << " p50=" << GetPercentile (50).GetNanoSeconds ()
+     << " p90=" << GetPercentile (90).GetNanoSeconds ()
+     << " p99=" << GetPercentile (99).GetNanoSeconds ()
+     << " p99.9=" << GetPercentile (99.9).GetNanoSeconds ()
+     << " max=" << GetMax ().GetNanoSeconds ()
+     << " (ns)";
+}
+
+} // namespace ns3
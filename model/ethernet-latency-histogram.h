@@ -0,0 +1,93 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_LATENCY_HISTOGRAM_H
+#define ETHERNET_LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+#include <vector>
+#include <ostream>
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * \brief A log-linear latency histogram with bounded memory.
+ *
+ * Values (in nanoseconds) below 2^SubBucketBits are counted exactly.
+ * Above that, every power-of-two range is split into 2^(SubBucketBits-1)
+ * linear sub-buckets, so the relative error of any reported value is at
+ * most 2^-(SubBucketBits-1) whatever its magnitude, in the same way as
+ * HdrHistogram.  Values of 2^MaxValueBits ns and above are clamped to the
+ * last bucket.
+ *
+ * The bucket array is only allocated on the first recorded value.
+ */
+class EthernetLatencyHistogram
+{
+public:
+  /**
+   * @param subBucketBits log2 of the number of exact buckets; sets the precision
+   * @param maxValueBits log2 of the largest value tracked, in nanoseconds
+   */
+  EthernetLatencyHistogram (uint32_t subBucketBits = 7, uint32_t maxValueBits = 40);
+
+  /**
+   * Record one latency sample.
+   */
+  void Record (Time latency);
+  /**
+   * Forget all the samples, keeping the memory.
+   */
+  void Reset (void);
+
+  uint64_t GetCount (void) const;
+  Time GetMin (void) const;
+  Time GetMax (void) const;
+  Time GetMean (void) const;
+  /**
+   * @param percentile a value in [0, 100]
+   * @return the highest latency equivalent, within the histogram precision,
+   * to the given percentile of the samples
+   */
+  Time GetPercentile (double percentile) const;
+
+  /**
+   * Print the sample count, min, mean, a set of percentiles and max on a
+   * single line.
+   */
+  void Print (std::ostream &os) const;
+
+private:
+  uint32_t GetIndex (uint64_t value) const;
+  uint64_t GetHighestEquivalentValue (uint32_t index) const;
+
+  uint32_t m_subBucketBits;
+  uint32_t m_maxValueBits;
+  std::vector<uint64_t> m_counts;
+  uint64_t m_count;
+  uint64_t m_min;
+  uint64_t m_max;
+  double m_sum;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_LATENCY_HISTOGRAM_H */
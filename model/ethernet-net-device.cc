@@ -18,6 +18,9 @@
  * Author: Andrey Churin <aachurin@gmail.com>
  */
 
+#include <algorithm>
+#include <cmath>
+
 #include "ns3/log.h"
 #include "ns3/queue.h"
 #include "ns3/simulator.h"
@@ -28,10 +31,20 @@
 #include "ns3/enum.h"
 #include "ns3/boolean.h"
 #include "ns3/uinteger.h"
+#include "ns3/double.h"
 #include "ns3/pointer.h"
+#include "ns3/data-rate.h"
 #include "ns3/trace-source-accessor.h"
 #include "ethernet-net-device.h"
 #include "ethernet-channel.h"
+#include "ethernet-timestamp-tag.h"
+#include "ethernet-vlan-header.h"
+#include "ethernet-vlan-tag.h"
+#include "ethernet-fragment-header.h"
+#include "ethernet-ecmp-group.h"
+#include "ethernet-virtual-function.h"
+#include "ethernet-snapshot.h"
+#include "ethernet-profiler.h"
 
 NS_LOG_COMPONENT_DEFINE ("EthernetNetDevice");
 
@@ -62,6 +75,31 @@ EthernetNetDevice::GetTypeId (void)
                    MakeEnumAccessor (&EthernetNetDevice::SetEncapsulationMode),
                    MakeEnumChecker (CsmaNetDevice::DIX, "Dix",
                                     CsmaNetDevice::LLC, "Llc"))
+    .AddAttribute ("VlanMode",
+                   "The 802.1Q port mode.",
+                   EnumValue (VLAN_NONE),
+                   MakeEnumAccessor (&EthernetNetDevice::SetVlanMode,
+                                     &EthernetNetDevice::GetVlanMode),
+                   MakeEnumChecker (VLAN_NONE, "None",
+                                    VLAN_ACCESS, "Access",
+                                    VLAN_TRUNK, "Trunk"))
+    .AddAttribute ("Pvid",
+                   "The port VLAN, untagged frames belong to it.  Zero for none, on trunks.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&EthernetNetDevice::m_pvid),
+                   MakeUintegerChecker<uint16_t> (0, 4094))
+    .AddAttribute ("InterframeGap",
+                   "The minimum gap between two frames sent by the device, negative for 96 bit times at the data rate of the link.",
+                   TimeValue (Seconds (-1)),
+                   MakeTimeAccessor (&EthernetNetDevice::SetInterframeGap,
+                                     &EthernetNetDevice::GetInterframeGap),
+                   MakeTimeChecker ())
+    .AddAttribute ("AccurateFraming",
+                   "Account for the preamble and SFD of every frame on the wire.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&EthernetNetDevice::SetAccurateFraming,
+                                        &EthernetNetDevice::GetAccurateFraming),
+                   MakeBooleanChecker ())
     .AddAttribute ("ReceiveErrorModel", 
                    "The receiver error model used to simulate packet loss",
                    PointerValue (),
@@ -73,11 +111,94 @@ EthernetNetDevice::GetTypeId (void)
                    MakePointerAccessor (&EthernetNetDevice::SetQueue,
                                         &EthernetNetDevice::GetQueue),
                    MakePointerChecker<Queue> ())
+    .AddAttribute ("Snapshots",
+                   "Keep a list of the frames in the transmit queue, so snapshots can save them.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&EthernetNetDevice::SetSnapshotsEnabled,
+                                        &EthernetNetDevice::GetSnapshotsEnabled),
+                   MakeBooleanChecker ())
+    .AddAttribute ("ShaperBurst",
+                   "The depth of the token bucket of the egress shaper, in bytes.",
+                   UintegerValue (16384),
+                   MakeUintegerAccessor (&EthernetNetDevice::m_shaperBurst),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("ShaperRate",
+                   "The rate of the egress shaper.  Zero disables it.",
+                   DataRateValue (DataRate (0)),
+                   MakeDataRateAccessor (&EthernetNetDevice::SetShaperRate,
+                                         &EthernetNetDevice::GetShaperRate),
+                   MakeDataRateChecker ())
+    .AddAttribute ("ShaperQueueLimit",
+                   "The number of frames waiting for tokens in the egress shaper.",
+                   UintegerValue (100),
+                   MakeUintegerAccessor (&EthernetNetDevice::m_shaperQueueLimit),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("GateControlBaseTime",
+                   "The time the gate control list starts cycling.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&EthernetNetDevice::m_gateBaseTime),
+                   MakeTimeChecker ())
+    .AddAttribute ("TrafficClassQueueLimit",
+                   "The number of frames queued per traffic class by the time-aware shaper.",
+                   UintegerValue (100),
+                   MakeUintegerAccessor (&EthernetNetDevice::m_trafficClassQueueLimit),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("ExpressClasses",
+                   "The traffic classes that preempt the others, bit n for class n.  Zero disables preemption.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&EthernetNetDevice::SetExpressClasses,
+                                         &EthernetNetDevice::GetExpressClasses),
+                   MakeUintegerChecker<uint8_t> ())
+    .AddAttribute ("PreemptionFragmentSize",
+                   "The payload bytes of the fragments of preemptible frames.",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&EthernetNetDevice::m_fragmentSize),
+                   MakeUintegerChecker<uint32_t> (8, 1500))
+    .AddAttribute ("LatencyHistograms",
+                   "Record queueing, transmission, link and end-to-end latency histograms.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&EthernetNetDevice::SetLatencyHistograms,
+                                        &EthernetNetDevice::GetLatencyHistograms),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MulticastFilter",
+                   "Pass up only the multicast frames of joined groups.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&EthernetNetDevice::SetMulticastFilter,
+                                        &EthernetNetDevice::GetMulticastFilter),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MulticastFilterBits",
+                   "log2 of the number of buckets of the multicast filter.",
+                   UintegerValue (6),
+                   MakeUintegerAccessor (&EthernetNetDevice::m_multicastFilterBits),
+                   MakeUintegerChecker<uint32_t> (1, 16))
+    .AddAttribute ("ReceiveQueues",
+                   "The number of receive queues frames are spread over by flow hash.  Zero passes frames up at once.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&EthernetNetDevice::SetReceiveQueues,
+                                         &EthernetNetDevice::GetReceiveQueues),
+                   MakeUintegerChecker<uint32_t> (0, 1024))
+    .AddAttribute ("ReceiveServiceRate",
+                   "The frames per second each receive queue passes up.  Zero for no limit.",
+                   DoubleValue (0),
+                   MakeDoubleAccessor (&EthernetNetDevice::SetReceiveServiceRate,
+                                       &EthernetNetDevice::GetReceiveServiceRate),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("ReceiveQueueLimit",
+                   "The number of frames waiting in each receive queue.",
+                   UintegerValue (1000),
+                   MakeUintegerAccessor (&EthernetNetDevice::m_receiveQueueLimit),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("RssHash",
+                   "The flow hash spreading frames over the receive queues.",
+                   PointerValue (),
+                   MakePointerAccessor (&EthernetNetDevice::m_rssHash),
+                   MakePointerChecker<EthernetEcmpGroup> ())
     .AddTraceSource ("MacTx", 
                      "Trace source indicating a packet has arrived for transmission by this device",
                      MakeTraceSourceAccessor (&EthernetNetDevice::m_macTxTrace))
     .AddTraceSource ("MacTxDrop", 
-                     "Trace source indicating a packet has been dropped by the device before transmission",
+                     "Trace source indicating a packet has been dropped by the device before transmission, "
+                     "framed as it would have been sent",
                      MakeTraceSourceAccessor (&EthernetNetDevice::m_macTxDropTrace))
     .AddTraceSource ("MacPromiscRx", 
                      "A packet has been received by this device, has been passed up from the physical layer "
@@ -102,9 +223,15 @@ EthernetNetDevice::GetTypeId (void)
     .AddTraceSource ("PhyRxDrop", 
                      "Trace source indicating a packet has been dropped by the device during reception",
                      MakeTraceSourceAccessor (&EthernetNetDevice::m_phyRxDropTrace))
+    .AddTraceSource ("Sniffer",
+                     "Trace source simulating a non-promiscuous packet sniffer attached to the device",
+                     MakeTraceSourceAccessor (&EthernetNetDevice::m_snifferTrace))
     .AddTraceSource ("PromiscSniffer", 
                      "Trace source simulating a promiscuous packet sniffer attached to the device",
                      MakeTraceSourceAccessor (&EthernetNetDevice::m_promiscSnifferTrace))
+    .AddTraceSource ("RxQueueDrop",
+                     "Trace source indicating a frame has been dropped by a full receive queue, with the index of the queue",
+                     MakeTraceSourceAccessor (&EthernetNetDevice::m_rxQueueDropTrace))
     ;
   return tid;
 }
@@ -121,46 +248,152 @@ ProxyTracedCallback::~ProxyTracedCallback ()
 {
   m_obj1 = 0;
   m_obj2 = 0;
+  m_sinksChanged = MakeNullCallback<void> ();
+  m_sinks.clear ();
+  m_profiledSinks.clear ();
 }
   
 void
 ProxyTracedCallback::ConnectWithoutContext (const CallbackBase &callback)
 {
-  m_obj1->TraceConnectWithoutContext (m_name, callback);
+  m_local.ConnectWithoutContext (callback);
+  Sink entry;
+  entry.hasContext = false;
+  entry.sink.Assign (callback);
+  m_sinks.push_back (entry);
+  CallbackBase sink = AddProxiedSink (callback, false, std::string ());
+  m_obj1->TraceConnectWithoutContext (m_name, sink);
   if (m_obj2 != 0)
     {
-      m_obj2->TraceConnectWithoutContext (m_name, callback);
+      m_obj2->TraceConnectWithoutContext (m_name, sink);
     }
+  NotifySinksChanged ();
 }
 
 void
 ProxyTracedCallback::Connect (const CallbackBase &callback, std::string context)
 {
-  m_obj1->TraceConnect (m_name, context, callback);
+  m_local.Connect (callback, context);
+  Sink entry;
+  entry.hasContext = true;
+  entry.context = context;
+  entry.contextSink.Assign (callback);
+  m_sinks.push_back (entry);
+  CallbackBase sink = AddProxiedSink (callback, true, context);
+  m_obj1->TraceConnect (m_name, context, sink);
   if (m_obj2 != 0)
     {
-      m_obj2->TraceConnect (m_name, context, callback);
-    }  
+      m_obj2->TraceConnect (m_name, context, sink);
+    }
+  NotifySinksChanged ();
 }
 
 void
 ProxyTracedCallback::DisconnectWithoutContext (const CallbackBase &callback)
 {
-  m_obj1->TraceDisconnectWithoutContext (m_name, callback);
+  if (!RemoveSink (callback, false, std::string ()))
+    {
+      return;
+    }
+  m_local.DisconnectWithoutContext (callback);
+  CallbackBase sink = RemoveProxiedSink (callback, false, std::string ());
+  m_obj1->TraceDisconnectWithoutContext (m_name, sink);
   if (m_obj2 != 0)
     {
-      m_obj2->TraceDisconnectWithoutContext (m_name, callback);
+      m_obj2->TraceDisconnectWithoutContext (m_name, sink);
     }
+  NotifySinksChanged ();
 }
 
 void
 ProxyTracedCallback::Disconnect (const CallbackBase &callback, std::string context)
 {
-  m_obj1->TraceDisconnect (m_name, context, callback);
+  if (!RemoveSink (callback, true, context))
+    {
+      return;
+    }
+  m_local.Disconnect (callback, context);
+  CallbackBase sink = RemoveProxiedSink (callback, true, context);
+  m_obj1->TraceDisconnect (m_name, context, sink);
   if (m_obj2 != 0)
     {
-      m_obj2->TraceDisconnect (m_name, context, callback);
-    }  
+      m_obj2->TraceDisconnect (m_name, context, sink);
+    }
+  NotifySinksChanged ();
+}
+
+void
+ProxyTracedCallback::operator() (Ptr<const Packet> packet) const
+{
+  ETHERNET_PROFILE (TRACE_DISPATCH);
+  m_local (packet);
+}
+
+bool
+ProxyTracedCallback::IsEmpty (void) const
+{
+  return m_sinks.empty ();
+}
+
+void
+ProxyTracedCallback::SetSinksChangedCallback (Callback<void> callback)
+{
+  m_sinksChanged = callback;
+}
+
+void
+ProxyTracedCallback::NotifySinksChanged (void)
+{
+  if (!m_sinksChanged.IsNull ())
+    {
+      m_sinksChanged ();
+    }
+}
+
+CallbackBase
+ProxyTracedCallback::AddProxiedSink (const CallbackBase &callback, bool hasContext, std::string context)
+{
+  if (!EthernetProfiler::IsEnabled ())
+    {
+      return callback;
+    }
+  Ptr<EthernetProfiledSink> sink = hasContext ? Create<EthernetProfiledSink> (callback, context)
+                                              : Create<EthernetProfiledSink> (callback);
+  m_profiledSinks.push_back (sink);
+  return sink->GetSink ();
+}
+
+CallbackBase
+ProxyTracedCallback::RemoveProxiedSink (const CallbackBase &callback, bool hasContext, std::string context)
+{
+  for (std::list<Ptr<EthernetProfiledSink> >::iterator i = m_profiledSinks.begin (); i != m_profiledSinks.end (); ++i)
+    {
+      if ((*i)->IsProfiling (callback, hasContext, context))
+        {
+          CallbackBase sink = (*i)->GetSink ();
+          m_profiledSinks.erase (i);
+          return sink;
+        }
+    }
+  return callback;
+}
+
+bool
+ProxyTracedCallback::RemoveSink (const CallbackBase &callback, bool hasContext, std::string context)
+{
+  for (std::list<Sink>::iterator i = m_sinks.begin (); i != m_sinks.end (); ++i)
+    {
+      if (i->hasContext != hasContext)
+        {
+          continue;
+        }
+      if (hasContext ? (i->context == context && i->contextSink.IsEqual (callback)) : i->sink.IsEqual (callback))
+        {
+          m_sinks.erase (i);
+          return true;
+        }
+    }
+  return false;
 }
 
 EthernetNetDevice::EthernetNetDevice ()
@@ -169,6 +402,32 @@ EthernetNetDevice::EthernetNetDevice ()
     m_node (0),
     m_txDev (CreateObject<CsmaNetDevice> ()),
     m_rxDev (CreateObject<CsmaNetDevice> ()),
+    m_latencyEnabled (false),
+    m_multicastFilter (false),
+    m_vlanMode (VLAN_NONE),
+    m_pvid (1),
+    m_shaperRate (0),
+    m_shaperBurst (16384),
+    m_shaperTokens (0),
+    m_snapshotsEnabled (false),
+    m_queuedFramesBase (0),
+    m_queuedBytesBase (0),
+    m_queueDropsBase (0),
+    m_gatesAlwaysOpen (0xff),
+    m_scheduling (false),
+    m_transmitting (false),
+    m_interframeGap (Seconds (-1)),
+    m_txInterframeGap (Seconds (0)),
+    m_accurateFraming (false),
+    m_framingOverhead (0),
+    m_expressClasses (0),
+    m_fragmentSequence (0),
+    m_fragmentIndex (0),
+    m_fragmentClass (0),
+    m_receiveServiceRate (0),
+    m_nReceivedFrames (0),
+    m_nReceivedBytes (0),
+    m_nextVirtualFunction (0),
     m_macTxTrace ("MacTx", m_txDev),
     m_macTxDropTrace ("MacTxDrop", m_txDev),
     m_macPromiscRxTrace ("MacPromiscRx", m_rxDev),
@@ -178,9 +437,14 @@ EthernetNetDevice::EthernetNetDevice ()
     m_phyTxDropTrace ("PhyTxDrop", m_txDev),
     m_phyRxEndTrace ("PhyRxEnd", m_rxDev),
     m_phyRxDropTrace ("PhyRxDrop", m_rxDev),
+    m_snifferTrace ("Sniffer", m_txDev, m_rxDev),
     m_promiscSnifferTrace ("PromiscSniffer", m_txDev, m_rxDev)
 {
   NS_LOG_FUNCTION (this);
+  EthernetProfiler::Initialize ();
+  m_macTxTrace.SetSinksChangedCallback (MakeCallback (&EthernetNetDevice::SelectSendPath, this));
+  m_macTxDropTrace.SetSinksChangedCallback (MakeCallback (&EthernetNetDevice::SelectSendPath, this));
+  SelectSendPath ();
 }
 
 EthernetNetDevice::~EthernetNetDevice()
@@ -192,8 +456,29 @@ void
 EthernetNetDevice::DoDispose ()
 {
   NS_LOG_FUNCTION_NOARGS ();
+  Simulator::Cancel (m_receiveEnableEvent);
+  Simulator::Cancel (m_shaperEvent);
+  m_shaperBacklog.clear ();
+  m_queuedFrames.clear ();
+  Simulator::Cancel (m_gateEvent);
+  for (uint32_t i = 0; i < N_TRAFFIC_CLASSES; ++i)
+    {
+      m_trafficClassQueues[i].clear ();
+    }
+  m_reassembly[0].clear ();
+  m_reassembly[1].clear ();
+  for (uint32_t i = 0; i < m_receiveQueues.size (); ++i)
+    {
+      Simulator::Cancel (m_receiveQueues[i].event);
+    }
+  m_receiveQueues.clear ();
+  m_rssHash = 0;
+  m_virtualFunctions.clear ();
+  m_virtualFunctionTable.clear ();
   m_txDev->Dispose ();
   m_rxDev->Dispose ();
+  m_macTxTrace.SetSinksChangedCallback (MakeNullCallback<void> ());
+  m_macTxDropTrace.SetSinksChangedCallback (MakeNullCallback<void> ());
   m_txDev = 0;
   m_rxDev = 0;
   m_node = 0;
@@ -222,6 +507,7 @@ EthernetNetDevice::SetMac48Address (Mac48Address address)
 {
   NS_LOG_FUNCTION (address);
   m_address = address;
+  m_headerCache.SetSource (address);
   m_txDev->SetAddress (address);
   m_rxDev->SetAddress (address);
   return true;
@@ -240,7 +526,8 @@ EthernetNetDevice::SetEncapsulationMode (enum CsmaNetDevice::EncapsulationMode m
   NS_LOG_FUNCTION (mode);
 
   m_encapMode = mode;
-  m_txDev->SetEncapsulationMode (mode);
+  m_txDev->SetEncapsulationMode (GetFramingMode ());
+  SelectSendPath ();
 }
 
 CsmaNetDevice::EncapsulationMode
@@ -256,7 +543,7 @@ EthernetNetDevice::SetMtu (uint16_t mtu)
   NS_LOG_FUNCTION (mtu);
 
   m_mtu = mtu;
-  m_txDev->SetMtu (mtu);
+  m_txDev->SetMtu (m_vlanMode == VLAN_NONE ? mtu : mtu + EthernetVlanHeader::SIZE);
 
   return true;
 }
@@ -279,12 +566,77 @@ EthernetNetDevice::GetRxDevice (void) const
 {
   return m_rxDev;
 }
+
+DataRate
+EthernetNetDevice::GetDataRate (void) const
+{
+  NS_ASSERT_MSG (m_channel != 0, "EthernetNetDevice::GetDataRate(): device not attached");
+  return m_channel->GetDirectionDataRate (m_deviceId);
+}
   
 void
 EthernetNetDevice::SetInterframeGap (Time t)
 {
   NS_LOG_FUNCTION (t);
-  m_txDev->SetInterframeGap (t);
+  m_interframeGap = t;
+  UpdateInterframeGap ();
+}
+
+Time
+EthernetNetDevice::GetInterframeGap (void) const
+{
+  if (m_interframeGap.IsStrictlyNegative () && m_channel != 0)
+    {
+      return GetDataRate ().CalculateTxTime (DEFAULT_INTERFRAME_GAP_BITS / 8);
+    }
+  return m_interframeGap;
+}
+
+void
+EthernetNetDevice::SetAccurateFraming (bool enable)
+{
+  NS_LOG_FUNCTION (enable);
+  m_accurateFraming = enable;
+  UpdateInterframeGap ();
+}
+
+bool
+EthernetNetDevice::GetAccurateFraming (void) const
+{
+  return m_accurateFraming;
+}
+
+void
+EthernetNetDevice::UpdateInterframeGap (void)
+{
+  static const uint32_t PREAMBLE_AND_SFD_SIZE = 8;
+
+  //
+  // Without a channel the default gap is not known yet; the channel calls
+  // this again once it has attached the transmit device, which resets the
+  // gap of the device.
+  //
+  if (m_channel == 0)
+    {
+      return;
+    }
+
+  Time gap = GetInterframeGap ();
+  m_txInterframeGap = gap;
+  m_framingOverhead = 0;
+  if (m_accurateFraming)
+    {
+      //
+      // The preamble and SFD are sent right before the frame, they stand in
+      // for the end of the gap.
+      //
+      DataRate rate = GetDataRate ();
+      m_txInterframeGap += rate.CalculateTxTime (PREAMBLE_AND_SFD_SIZE);
+      m_framingOverhead = PREAMBLE_AND_SFD_SIZE
+        + static_cast<uint32_t> (gap.GetSeconds () * rate.GetBitRate () / 8 + 0.5);
+    }
+  NS_LOG_LOGIC ("Transmit gap " << m_txInterframeGap << ", " << m_framingOverhead << " bytes of overhead");
+  m_txDev->SetInterframeGap (m_txInterframeGap);
 }
 
 bool
@@ -297,8 +649,16 @@ EthernetNetDevice::Attach (const Ptr<EthernetChannel> &channel)
   m_channel = channel;
   
   m_channel->Attach (this);
+  m_deviceId = m_channel->GetNDevices () - 1;
     
-  NotifyLinkUp ();
+  if (m_channel->IsLinkUp ())
+    {
+      NotifyLinkUp ();
+    }
+  else
+    {
+      SetLinkState (false);
+    }
   return true;
 }
 
@@ -306,7 +666,108 @@ void
 EthernetNetDevice::SetQueue (const Ptr<Queue> &queue)
 {
   NS_LOG_FUNCTION (queue);
+  if (m_latencyEnabled)
+    {
+      ConnectLatencySinks (false);
+    }
+  if (m_snapshotsEnabled)
+    {
+      ConnectQueueSinks (false);
+    }
   m_txDev->SetQueue (queue);
+  m_queuedFramesBase = 0;
+  m_queuedBytesBase = 0;
+  m_queueDropsBase = 0;
+  if (m_snapshotsEnabled)
+    {
+      ConnectQueueSinks (true);
+    }
+  if (m_latencyEnabled)
+    {
+      ConnectLatencySinks (true);
+    }
+}
+
+void
+EthernetNetDevice::SetSnapshotsEnabled (bool enable)
+{
+  NS_LOG_FUNCTION (enable);
+  if (enable == m_snapshotsEnabled)
+    {
+      return;
+    }
+  NS_ABORT_MSG_IF (enable && GetQueue () != 0 && GetQueue ()->GetNPackets () != 0,
+                   "EthernetNetDevice::SetSnapshotsEnabled(): the transmit queue is not empty");
+  ConnectQueueSinks (enable);
+  m_snapshotsEnabled = enable;
+}
+
+bool
+EthernetNetDevice::GetSnapshotsEnabled (void) const
+{
+  return m_snapshotsEnabled;
+}
+
+void
+EthernetNetDevice::ConnectQueueSinks (bool connect)
+{
+  m_queuedFrames.clear ();
+  Ptr<Queue> queue = GetQueue ();
+  if (queue == 0)
+    {
+      return;
+    }
+  if (connect)
+    {
+      queue->TraceConnectWithoutContext ("Enqueue", MakeCallback (&EthernetNetDevice::QueueEnqueue, this));
+      queue->TraceConnectWithoutContext ("Dequeue", MakeCallback (&EthernetNetDevice::QueueDequeue, this));
+      queue->TraceConnectWithoutContext ("Drop", MakeCallback (&EthernetNetDevice::QueueDrop, this));
+    }
+  else
+    {
+      queue->TraceDisconnectWithoutContext ("Enqueue", MakeCallback (&EthernetNetDevice::QueueEnqueue, this));
+      queue->TraceDisconnectWithoutContext ("Dequeue", MakeCallback (&EthernetNetDevice::QueueDequeue, this));
+      queue->TraceDisconnectWithoutContext ("Drop", MakeCallback (&EthernetNetDevice::QueueDrop, this));
+    }
+}
+
+void
+EthernetNetDevice::QueueEnqueue (Ptr<const Packet> packet)
+{
+  m_queuedFrames.push_back (packet);
+}
+
+void
+EthernetNetDevice::QueueDequeue (Ptr<const Packet> packet)
+{
+  if (!m_queuedFrames.empty () && m_queuedFrames.front () == packet)
+    {
+      m_queuedFrames.pop_front ();
+      return;
+    }
+  //
+  // Only a queue which does not serve in arrival order gets here.
+  //
+  std::deque<Ptr<const Packet> >::iterator i = std::find (m_queuedFrames.begin (), m_queuedFrames.end (), packet);
+  if (i != m_queuedFrames.end ())
+    {
+      m_queuedFrames.erase (i);
+    }
+}
+
+void
+EthernetNetDevice::QueueDrop (Ptr<const Packet> packet)
+{
+  //
+  // The queue traces Enqueue before it decides to drop: a tail drop is the
+  // frame just added.
+  //
+  if (!m_queuedFrames.empty () && m_queuedFrames.back () == packet)
+    {
+      m_queuedFrames.pop_back ();
+      return;
+    }
+  QueueDequeue (packet);
 }
 
 Ptr<Queue>
@@ -320,6 +781,13 @@ void
 EthernetNetDevice::SetReceiveErrorModel (const Ptr<ErrorModel> &em)
 {
   NS_LOG_FUNCTION (em);
+  if (em != 0 && EthernetProfiler::IsEnabled ())
+    {
+      Ptr<EthernetProfiledErrorModel> profiled = CreateObject<EthernetProfiledErrorModel> ();
+      profiled->SetErrorModel (em);
+      m_rxDev->SetReceiveErrorModel (profiled);
+      return;
+    }
   m_rxDev->SetReceiveErrorModel (em); 
 }
 
@@ -411,89 +879,1865 @@ bool
 EthernetNetDevice::Send (Ptr<Packet> packet,const Address& dest, uint16_t protocolNumber)
 {
   NS_LOG_FUNCTION (packet << dest << protocolNumber);
-  return m_txDev->Send (packet, dest, protocolNumber);
+  Mac48Address to = Mac48Address::ConvertFrom (dest);
+  if (!m_virtualFunctions.empty () && SwitchToVirtualFunctions (packet, m_address, to, protocolNumber))
+    {
+      return true;
+    }
+  return DoSendFrom (packet, m_address, to, protocolNumber);
 }
 
 bool
 EthernetNetDevice::SendFrom (Ptr<Packet> packet, const Address& src, const Address& dest, uint16_t protocolNumber)
 {
   NS_LOG_FUNCTION (packet << src << dest << protocolNumber);
-  return m_txDev->SendFrom (packet, src, dest, protocolNumber);
+  Mac48Address from = Mac48Address::ConvertFrom (src);
+  Mac48Address to = Mac48Address::ConvertFrom (dest);
+  if (!m_virtualFunctions.empty () && SwitchToVirtualFunctions (packet, from, to, protocolNumber))
+    {
+      return true;
+    }
+  return DoSendFrom (packet, from, to, protocolNumber);
 }
 
-bool 
-EthernetNetDevice::NeedsArp (void) const
+bool
+EthernetNetDevice::SendFromVirtualFunction (Ptr<Packet> packet, Mac48Address src, Mac48Address dest,
+                                            uint16_t protocolNumber)
 {
-  NS_LOG_FUNCTION_NOARGS ();
-  return true;
+  NS_LOG_FUNCTION (packet << src << dest << protocolNumber);
+  return DoSendFrom (packet, src, dest, protocolNumber);
 }
 
-Address
-EthernetNetDevice::GetMulticast (Ipv6Address addr) const
+bool
+EthernetNetDevice::DoSendFrom (Ptr<Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocolNumber)
 {
-  return Mac48Address::GetMulticast (addr);
+  ETHERNET_PROFILE (SEND);
+  if (m_latencyEnabled)
+    {
+      StampTimestamp (packet);
+    }
+  if (m_vlanMode != VLAN_NONE && !PushVlanTag (packet, protocolNumber))
+    {
+      NotifyTxDrop (packet, src, dest, protocolNumber);
+      return false;
+    }
+  if (m_shaperRate.GetBitRate () != 0)
+    {
+      return ShapeFrame (packet, src, dest, protocolNumber);
+    }
+  return DispatchFrame (packet, src, dest, protocolNumber);
 }
 
-bool 
-EthernetNetDevice::SupportsSendFrom () const
+bool
+EthernetNetDevice::TransmitFrame (Ptr<Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocolNumber)
 {
-  return true;
+  ETHERNET_PROFILE (TRANSMIT_START);
+  //
+  // While the transmit queue is backlogged the transmit device is busy and
+  // keeps pulling frames from it, so there is no need to go through its
+  // framing code.
+  //
+  if (!GetQueue ()->IsEmpty () && src == m_address)
+    {
+      return (this->*m_sendFramed)(packet, dest, protocolNumber);
+    }
+  if (!m_txDev->IsSendEnabled ())
+    {
+      NotifyTxDrop (packet, src, dest, protocolNumber);
+      return false;
+    }
+  return m_txDev->SendFrom (packet, src, dest, protocolNumber);
 }
 
 void
-EthernetNetDevice::NotifyLinkUp (void)
+EthernetNetDevice::NotifyTxDrop (Ptr<const Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocolNumber)
 {
-  NS_LOG_FUNCTION_NOARGS ();
-  m_linkUp = true;
-  m_linkChangeCallbacks ();
+  if (m_macTxDropTrace.IsEmpty ())
+    {
+      return;
+    }
+  Ptr<Packet> frame = packet->Copy ();
+  if (GetFramingMode () == CsmaNetDevice::LLC)
+    {
+      LlcSnapHeader llc;
+      llc.SetType (protocolNumber);
+      frame->AddHeader (llc);
+      protocolNumber = frame->GetSize ();
+    }
+  EthernetHeader header (false);
+  header.SetSource (src);
+  header.SetDestination (dest);
+  header.SetLengthType (protocolNumber);
+  frame->AddHeader (header);
+  m_macTxDropTrace (frame);
 }
 
 void
-EthernetNetDevice::AddLinkChangeCallback (Callback<void> callback)
+EthernetNetDevice::SetShaperRate (DataRate rate)
 {
-  m_linkChangeCallbacks.ConnectWithoutContext (callback);
-}
+  NS_LOG_FUNCTION (rate);
+  if (m_shaperRate.GetBitRate () == 0)
+    {
+      //
+      // The bucket starts full.
+      //
+      m_shaperTokens = m_shaperBurst;
+      m_shaperLastUpdate = Simulator::Now ();
+    }
+  else
+    {
+      RefillTokens ();
+    }
+  m_shaperRate = rate;
 
-void 
-EthernetNetDevice::SetReceiveCallback (NetDevice::ReceiveCallback cb)
-{
-  m_rxCallback = cb;
-  if (cb.IsNull ()) 
+  Simulator::Cancel (m_shaperEvent);
+  if (m_shaperRate.GetBitRate () == 0)
     {
-      m_rxDev->SetReceiveCallback (cb);
+      while (!m_shaperBacklog.empty ())
+        {
+          PendingFrame frame = m_shaperBacklog.front ();
+          m_shaperBacklog.pop_front ();
+          DispatchFrame (frame.packet, frame.src, frame.dest, frame.protocol);
+        }
     }
   else
     {
-      m_rxDev->SetReceiveCallback (MakeCallback (&EthernetNetDevice::NonPromiscReceiveFromDevice, this));
+      ReleaseShapedFrames ();
     }
 }
 
-void 
-EthernetNetDevice::SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb)
+DataRate
+EthernetNetDevice::GetShaperRate (void) const
 {
-  m_promiscRxCallback = cb;
-    if (cb.IsNull ()) 
+  return m_shaperRate;
+}
+
+uint32_t
+EthernetNetDevice::GetWireSize (uint32_t size) const
+{
+  //
+  // The frame as the transmit device will send it: padded payload, header
+  // and FCS.
+  //
+  static const uint32_t MIN_PAYLOAD_SIZE = 46;
+  static const uint32_t HEADER_AND_FCS_SIZE = 18;
+  return std::max (size, MIN_PAYLOAD_SIZE) + HEADER_AND_FCS_SIZE;
+}
+
+void
+EthernetNetDevice::RefillTokens (void)
+{
+  Time now = Simulator::Now ();
+  m_shaperTokens += (now - m_shaperLastUpdate).GetSeconds () * m_shaperRate.GetBitRate () / 8;
+  m_shaperLastUpdate = now;
+  if (m_shaperTokens > m_shaperBurst)
     {
-      m_rxDev->SetPromiscReceiveCallback (cb);
+      m_shaperTokens = m_shaperBurst;
     }
-  else
+}
+
+bool
+EthernetNetDevice::ShapeFrame (Ptr<Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocolNumber)
+{
+  NS_LOG_FUNCTION (packet << src << dest << protocolNumber);
+
+  if (m_shaperBacklog.empty ())
     {
-      m_rxDev->SetPromiscReceiveCallback (MakeCallback (&EthernetNetDevice::PromiscReceiveFromDevice, this));
+      RefillTokens ();
+      uint32_t cost = GetWireSize (packet->GetSize ()) + m_framingOverhead;
+      if (m_shaperTokens >= std::min (cost, m_shaperBurst))
+        {
+          m_shaperTokens -= cost;
+          return DispatchFrame (packet, src, dest, protocolNumber);
+        }
+    }
+  else if (m_shaperBacklog.size () >= m_shaperQueueLimit)
+    {
+      NS_LOG_LOGIC ("Shaper backlog full, dropping");
+      NotifyTxDrop (packet, src, dest, protocolNumber);
+      return false;
+    }
+
+  PendingFrame frame;
+  frame.packet = packet;
+  frame.src = src;
+  frame.dest = dest;
+  frame.protocol = protocolNumber;
+  m_shaperBacklog.push_back (frame);
+  if (!m_shaperEvent.IsRunning ())
+    {
+      ReleaseShapedFrames ();
+    }
+  return true;
+}
+
+void
+EthernetNetDevice::ReleaseShapedFrames (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  RefillTokens ();
+  while (!m_shaperBacklog.empty ())
+    {
+      PendingFrame &frame = m_shaperBacklog.front ();
+      uint32_t cost = GetWireSize (frame.packet->GetSize ()) + m_framingOverhead;
+      double needed = std::min (cost, m_shaperBurst);
+      if (m_shaperTokens < needed)
+        {
+          //
+          // Wake up exactly when the bucket has filled enough, rounding up
+          // so the tokens are there by then.
+          //
+          uint64_t wait = std::ceil ((needed - m_shaperTokens) * 8e9 / m_shaperRate.GetBitRate ());
+          m_shaperEvent = Simulator::Schedule (NanoSeconds (wait + 1), &EthernetNetDevice::ReleaseShapedFrames, this);
+          return;
+        }
+      m_shaperTokens -= cost;
+      PendingFrame released = frame;
+      m_shaperBacklog.pop_front ();
+      DispatchFrame (released.packet, released.src, released.dest, released.protocol);
     }
 }
 
+template <CsmaNetDevice::EncapsulationMode Mode, bool Tracing>
 bool
-EthernetNetDevice::NonPromiscReceiveFromDevice (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
-                                   const Address &from)
+EthernetNetDevice::SendFramed (Ptr<Packet> packet, Mac48Address dest, uint16_t protocolNumber)
 {
-  return m_rxCallback (this, packet, protocol, from);
+  NS_LOG_FUNCTION (packet << dest << protocolNumber);
+
+  if (!m_txDev->IsSendEnabled ())
+    {
+      if (Tracing)
+        {
+          NotifyTxDrop (packet, m_address, dest, protocolNumber);
+        }
+      return false;
+    }
+
+  m_headerCache.AddHeader<Mode> (packet, dest, protocolNumber);
+  if (Tracing)
+    {
+      m_macTxTrace (packet);
+    }
+
+  if (!GetQueue ()->Enqueue (packet))
+    {
+      if (Tracing)
+        {
+          m_macTxDropTrace (packet);
+        }
+      return false;
+    }
+  return true;
+}
+
+void
+EthernetNetDevice::SelectSendPath (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  bool tracing = !m_macTxTrace.IsEmpty () || !m_macTxDropTrace.IsEmpty ();
+  switch (GetFramingMode ())
+    {
+    case CsmaNetDevice::DIX:
+      m_sendFramed = tracing ? &EthernetNetDevice::SendFramed<CsmaNetDevice::DIX, true>
+                             : &EthernetNetDevice::SendFramed<CsmaNetDevice::DIX, false>;
+      break;
+    case CsmaNetDevice::LLC:
+      m_sendFramed = tracing ? &EthernetNetDevice::SendFramed<CsmaNetDevice::LLC, true>
+                             : &EthernetNetDevice::SendFramed<CsmaNetDevice::LLC, false>;
+      break;
+    case CsmaNetDevice::ILLEGAL:
+    default:
+      NS_FATAL_ERROR ("EthernetNetDevice::SelectSendPath(): Unknown packet encapsulation mode");
+      break;
+    }
 }
 
 bool
-EthernetNetDevice::PromiscReceiveFromDevice (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
-                                const Address &from, const Address &to, NetDevice::PacketType packetType)
+EthernetNetDevice::DispatchFrame (Ptr<Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocolNumber)
+{
+  if (!m_scheduling)
+    {
+      return TransmitFrame (packet, src, dest, protocolNumber);
+    }
+
+  EthernetVlanTag tag;
+  uint32_t trafficClass = packet->PeekPacketTag (tag) ? tag.GetPcp () : 0;
+  std::deque<PendingFrame> &queue = m_trafficClassQueues[trafficClass];
+  if (queue.size () >= m_trafficClassQueueLimit)
+    {
+      NS_LOG_LOGIC ("Queue of traffic class " << trafficClass << " full, dropping");
+      NotifyTxDrop (packet, src, dest, protocolNumber);
+      return false;
+    }
+  PendingFrame frame;
+  frame.packet = packet;
+  frame.src = src;
+  frame.dest = dest;
+  frame.protocol = protocolNumber;
+  queue.push_back (frame);
+  TransmitNextFrame ();
+  return true;
+}
+
+void
+EthernetNetDevice::AddGateControlEntry (uint8_t gateStates, Time interval)
+{
+  NS_LOG_FUNCTION ((uint32_t) gateStates << interval);
+  NS_ASSERT (interval.IsStrictlyPositive ());
+  GateControlEntry entry;
+  entry.gateStates = gateStates;
+  entry.interval = interval;
+  m_gateControlList.push_back (entry);
+  m_gateCycleTime += interval;
+  m_gatesAlwaysOpen &= gateStates;
+  UpdateScheduling ();
+  TransmitNextFrame ();
+}
+
+void
+EthernetNetDevice::ClearGateControlList (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_gateControlList.clear ();
+  m_gateCycleTime = Seconds (0);
+  m_gatesAlwaysOpen = 0xff;
+  UpdateScheduling ();
+  TransmitNextFrame ();
+}
+
+Time
+EthernetNetDevice::GetGuardBand (void) const
+{
+  NS_ASSERT_MSG (m_channel != 0, "EthernetNetDevice::GetGuardBand(): device not attached");
+  uint32_t size = m_vlanMode == VLAN_NONE ? m_mtu : m_mtu + EthernetVlanHeader::SIZE;
+  return GetDataRate ().CalculateTxTime (GetWireSize (size));
+}
+
+void
+EthernetNetDevice::SetExpressClasses (uint8_t classes)
 {
-  return m_promiscRxCallback (this, packet, protocol, from, to, packetType);
+  NS_LOG_FUNCTION ((uint32_t) classes);
+  m_expressClasses = classes;
+  UpdateScheduling ();
+}
+
+uint8_t
+EthernetNetDevice::GetExpressClasses (void) const
+{
+  return m_expressClasses;
+}
+
+void
+EthernetNetDevice::UpdateScheduling (void)
+{
+  bool scheduling = !m_gateControlList.empty () || m_expressClasses != 0;
+  if (scheduling == m_scheduling)
+    {
+      return;
+    }
+  m_scheduling = scheduling;
+
+  if (scheduling)
+    {
+      m_txDev->TraceConnectWithoutContext ("PhyTxEnd", MakeCallback (&EthernetNetDevice::SchedulingTxEnd, this));
+      return;
+    }
+
+  //
+  // Whatever is still queued goes straight to the transmit device, but the
+  // rest of a partly sent frame cannot.
+  //
+  m_txDev->TraceDisconnectWithoutContext ("PhyTxEnd", MakeCallback (&EthernetNetDevice::SchedulingTxEnd, this));
+  Simulator::Cancel (m_gateEvent);
+  m_transmitting = false;
+  if (m_fragmentIndex != 0)
+    {
+      const PendingFrame &frame = m_trafficClassQueues[m_fragmentClass].front ();
+      NotifyTxDrop (frame.packet, frame.src, frame.dest, frame.protocol);
+      m_trafficClassQueues[m_fragmentClass].pop_front ();
+      m_fragmentIndex = 0;
+      ++m_fragmentSequence;
+    }
+  for (int32_t i = N_TRAFFIC_CLASSES - 1; i >= 0; --i)
+    {
+      while (!m_trafficClassQueues[i].empty ())
+        {
+          PendingFrame frame = m_trafficClassQueues[i].front ();
+          m_trafficClassQueues[i].pop_front ();
+          TransmitFrame (frame.packet, frame.src, frame.dest, frame.protocol);
+        }
+    }
+}
+
+void
+EthernetNetDevice::SchedulingTxEnd (Ptr<const Packet> packet)
+{
+  ETHERNET_PROFILE (TRANSMIT_COMPLETE);
+  m_transmitting = false;
+  m_lastTxEnd = Simulator::Now ();
+  TransmitNextFrame ();
+}
+
+Time
+EthernetNetDevice::GetGateOpenTime (uint32_t trafficClass, Time from, Time duration) const
+{
+  uint8_t gate = 1 << trafficClass;
+  if (m_gateControlList.empty () || (m_gatesAlwaysOpen & gate))
+    {
+      return from;
+    }
+
+  //
+  // All the gates are open until the base time, but a frame cannot run
+  // over it.
+  //
+  if (from < m_gateBaseTime)
+    {
+      if (from + duration <= m_gateBaseTime)
+        {
+          return from;
+        }
+      from = m_gateBaseTime;
+    }
+
+  //
+  // Walk the list from the start of the current cycle.  Since the gate
+  // closes at least once per cycle, an open window long enough starts
+  // within the next cycle and ends within the one after.
+  //
+  int64_t base = m_gateBaseTime.GetTimeStep ();
+  int64_t now = from.GetTimeStep () - base;
+  int64_t need = duration.GetTimeStep ();
+  int64_t entryStart = now - now % m_gateCycleTime.GetTimeStep ();
+  int64_t openStart = -1;
+  uint32_t n = m_gateControlList.size ();
+  for (uint32_t i = 0; i < 3 * n; ++i)
+    {
+      const GateControlEntry &entry = m_gateControlList[i % n];
+      int64_t entryEnd = entryStart + entry.interval.GetTimeStep ();
+      if (entryEnd > now)
+        {
+          if (entry.gateStates & gate)
+            {
+              if (openStart < 0)
+                {
+                  openStart = std::max (entryStart, now);
+                }
+              if (entryEnd - openStart >= need)
+                {
+                  return TimeStep (base + openStart);
+                }
+            }
+          else
+            {
+              openStart = -1;
+            }
+        }
+      entryStart = entryEnd;
+    }
+  return Simulator::GetMaximumSimulationTime ();
+}
+
+uint32_t
+EthernetNetDevice::GetFragmentSize (uint32_t remaining) const
+{
+  //
+  // The last fragment takes what is left if that is less than two
+  // fragments, so no fragment is shorter than PreemptionFragmentSize.
+  //
+  static const uint8_t MAX_INDEX = 0x7f;
+  if (remaining < 2 * m_fragmentSize || m_fragmentIndex == MAX_INDEX)
+    {
+      return remaining;
+    }
+  return m_fragmentSize;
+}
+
+void
+EthernetNetDevice::TransmitNextFrame (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  if (m_channel == 0)
+    {
+      return;
+    }
+  while (!m_transmitting)
+    {
+      Simulator::Cancel (m_gateEvent);
+
+      //
+      // A frame handed over right after the previous one ends waits for the
+      // interframe gap in the transmit device.
+      //
+      Time start = std::max (Simulator::Now (), m_lastTxEnd + m_txInterframeGap);
+      Time wakeup = Simulator::GetMaximumSimulationTime ();
+      DataRate rate = GetDataRate ();
+      int32_t selected = -1;
+      uint32_t selectedSize = 0;
+      bool selectedFragment = false;
+
+      //
+      // Express classes first, then the preemptible ones, the highest class
+      // first in each.  Only one preemptible frame may be in progress.
+      //
+      for (uint32_t pass = 0; pass < 2 && selected < 0; ++pass)
+        {
+          for (int32_t tc = N_TRAFFIC_CLASSES - 1; tc >= 0; --tc)
+            {
+              bool preemptible = m_expressClasses != 0 && !(m_expressClasses & (1 << tc));
+              if (m_trafficClassQueues[tc].empty () || preemptible != (pass == 1)
+                  || (preemptible && m_fragmentIndex != 0 && (uint32_t) tc != m_fragmentClass))
+                {
+                  continue;
+                }
+              uint32_t size = m_trafficClassQueues[tc].front ().packet->GetSize ();
+              uint32_t fragment = preemptible ? GetFragmentSize (size) : size;
+              bool isFragment = preemptible && (fragment < size || m_fragmentIndex != 0);
+              uint32_t wireSize = GetWireSize (isFragment ? fragment + EthernetFragmentHeader::SIZE : fragment);
+
+              Time open = GetGateOpenTime (tc, start, rate.CalculateTxTime (wireSize));
+              if (open == Simulator::GetMaximumSimulationTime ())
+                {
+                  NS_LOG_LOGIC ("Frame of traffic class " << tc << " never fits its gate, dropping");
+                  const PendingFrame &frame = m_trafficClassQueues[tc].front ();
+                  NotifyTxDrop (frame.packet, frame.src, frame.dest, frame.protocol);
+                  m_trafficClassQueues[tc].pop_front ();
+                  if (preemptible && m_fragmentIndex != 0)
+                    {
+                      m_fragmentIndex = 0;
+                      ++m_fragmentSequence;
+                    }
+                  ++tc;
+                  continue;
+                }
+              if (open == start)
+                {
+                  selected = tc;
+                  selectedSize = fragment;
+                  selectedFragment = isFragment;
+                  break;
+                }
+              wakeup = std::min (wakeup, open);
+            }
+        }
+
+      if (selected < 0)
+        {
+          if (wakeup != Simulator::GetMaximumSimulationTime ())
+            {
+              m_gateEvent = Simulator::Schedule (wakeup - Simulator::Now (), &EthernetNetDevice::TransmitNextFrame, this);
+            }
+          return;
+        }
+
+      std::deque<PendingFrame> &queue = m_trafficClassQueues[selected];
+      PendingFrame frame = queue.front ();
+      if (!selectedFragment)
+        {
+          queue.pop_front ();
+          m_transmitting = TransmitFrame (frame.packet, frame.src, frame.dest, frame.protocol);
+          continue;
+        }
+
+      bool last = selectedSize == frame.packet->GetSize ();
+      EthernetFragmentHeader header;
+      header.SetSequence (m_fragmentSequence);
+      header.SetIndex (m_fragmentIndex);
+      header.SetLast (last);
+      header.SetLengthType (frame.protocol);
+      header.SetFragmentSize (selectedSize);
+      Ptr<Packet> fragment = frame.packet->CreateFragment (0, selectedSize);
+      fragment->AddHeader (header);
+      if (last)
+        {
+          queue.pop_front ();
+          m_fragmentIndex = 0;
+          ++m_fragmentSequence;
+        }
+      else
+        {
+          frame.packet->RemoveAtStart (selectedSize);
+          m_fragmentClass = selected;
+          ++m_fragmentIndex;
+        }
+      m_transmitting = TransmitFrame (fragment, frame.src, frame.dest, EthernetFragmentHeader::ETHERTYPE);
+    }
+}
+
+Ptr<Packet>
+EthernetNetDevice::Reassemble (uint32_t path, Ptr<const Packet> fragment, Mac48Address from, uint16_t &protocol)
+{
+  Ptr<Packet> packet = fragment->Copy ();
+  EthernetFragmentHeader header;
+  packet->RemoveHeader (header);
+  if (packet->GetSize () > header.GetFragmentSize ())
+    {
+      packet->RemoveAtEnd (packet->GetSize () - header.GetFragmentSize ());
+    }
+
+  //
+  // Fragments of a frame come in order over the link, anything else means
+  // some were lost.
+  //
+  ReassemblyMap &reassembly = m_reassembly[path];
+  ReassemblyMap::iterator i = reassembly.find (from);
+  if (header.GetIndex () == 0)
+    {
+      Reassembly &entry = reassembly[from];
+      entry.sequence = header.GetSequence ();
+      entry.nextIndex = 1;
+      entry.packet = packet;
+      i = reassembly.find (from);
+    }
+  else if (i == reassembly.end () || i->second.sequence != header.GetSequence ()
+           || i->second.nextIndex != header.GetIndex ())
+    {
+      NS_LOG_LOGIC ("Dropping fragment " << (uint32_t) header.GetIndex () << " of frame "
+                    << (uint32_t) header.GetSequence () << " from " << from);
+      if (i != reassembly.end ())
+        {
+          reassembly.erase (i);
+        }
+      return 0;
+    }
+  else
+    {
+      i->second.packet->AddAtEnd (packet);
+      ++i->second.nextIndex;
+    }
+
+  if (!header.IsLast ())
+    {
+      return 0;
+    }
+  Ptr<Packet> whole = i->second.packet;
+  reassembly.erase (i);
+  protocol = header.GetLengthType ();
+  if (protocol <= 1500)
+    {
+      LlcSnapHeader llc;
+      whole->RemoveHeader (llc);
+      protocol = llc.GetType ();
+    }
+  return whole;
+}
+
+CsmaNetDevice::EncapsulationMode
+EthernetNetDevice::GetFramingMode (void) const
+{
+  return m_vlanMode == VLAN_NONE ? m_encapMode : CsmaNetDevice::DIX;
+}
+
+void
+EthernetNetDevice::SetVlanMode (VlanMode mode)
+{
+  NS_LOG_FUNCTION (mode);
+  m_vlanMode = mode;
+  m_txDev->SetEncapsulationMode (GetFramingMode ());
+  m_txDev->SetMtu (m_vlanMode == VLAN_NONE ? m_mtu : m_mtu + EthernetVlanHeader::SIZE);
+  SelectSendPath ();
+}
+
+EthernetNetDevice::VlanMode
+EthernetNetDevice::GetVlanMode (void) const
+{
+  return m_vlanMode;
+}
+
+void
+EthernetNetDevice::AddVlan (uint16_t vid)
+{
+  NS_LOG_FUNCTION (vid);
+  NS_ASSERT (vid > 0 && vid < 4095);
+  m_vlans.insert (vid);
+}
+
+void
+EthernetNetDevice::RemoveVlan (uint16_t vid)
+{
+  NS_LOG_FUNCTION (vid);
+  m_vlans.erase (vid);
+}
+
+bool
+EthernetNetDevice::IsVlanMember (uint16_t vid) const
+{
+  switch (m_vlanMode)
+    {
+    case VLAN_ACCESS:
+      return vid != 0 && vid == m_pvid;
+    case VLAN_TRUNK:
+      return vid != 0 && (vid == m_pvid || m_vlans.empty () || m_vlans.find (vid) != m_vlans.end ());
+    case VLAN_NONE:
+    default:
+      return vid == 0;
+    }
+}
+
+bool
+EthernetNetDevice::PushVlanTag (Ptr<Packet> packet, uint16_t &protocolNumber) const
+{
+  EthernetVlanTag tag (m_pvid);
+  packet->PeekPacketTag (tag);
+  if (!IsVlanMember (tag.GetVid ()))
+    {
+      NS_LOG_LOGIC ("Dropping frame of VLAN " << tag.GetVid ());
+      return false;
+    }
+
+  if (m_encapMode == CsmaNetDevice::LLC)
+    {
+      LlcSnapHeader llc;
+      llc.SetType (protocolNumber);
+      packet->AddHeader (llc);
+      protocolNumber = packet->GetSize ();
+    }
+  if (tag.GetVid () != m_pvid)
+    {
+      EthernetVlanHeader header;
+      header.SetVid (tag.GetVid ());
+      header.SetPcp (tag.GetPcp ());
+      header.SetLengthType (protocolNumber);
+      packet->AddHeader (header);
+      protocolNumber = EthernetVlanHeader::TPID;
+    }
+  return true;
+}
+
+bool
+EthernetNetDevice::PopVlanTag (Ptr<Packet> packet, uint16_t &protocol) const
+{
+  EthernetVlanTag tag (m_pvid);
+  if (protocol == EthernetVlanHeader::TPID)
+    {
+      EthernetVlanHeader header;
+      packet->RemoveHeader (header);
+      protocol = header.GetLengthType ();
+      if (protocol <= 1500)
+        {
+          //
+          // The receive device left the padding of the short frames in,
+          // the length tells how much of it there is.
+          //
+          if (packet->GetSize () > protocol)
+            {
+              packet->RemoveAtEnd (packet->GetSize () - protocol);
+            }
+          LlcSnapHeader llc;
+          packet->RemoveHeader (llc);
+          protocol = llc.GetType ();
+        }
+      //
+      // A VLAN identifier of zero marks a priority-tagged frame of the port
+      // VLAN.
+      //
+      if (header.GetVid () != 0)
+        {
+          tag.SetVid (header.GetVid ());
+        }
+      tag.SetPcp (header.GetPcp ());
+    }
+
+  if (!IsVlanMember (tag.GetVid ()))
+    {
+      NS_LOG_LOGIC ("Dropping frame of VLAN " << tag.GetVid ());
+      return false;
+    }
+  EthernetVlanTag old;
+  packet->RemovePacketTag (old);
+  packet->AddPacketTag (tag);
+  return true;
+}
+
+bool 
+EthernetNetDevice::NeedsArp (void) const
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  return true;
+}
+
+Address
+EthernetNetDevice::GetMulticast (Ipv6Address addr) const
+{
+  return Mac48Address::GetMulticast (addr);
+}
+
+bool 
+EthernetNetDevice::SupportsSendFrom () const
+{
+  return true;
+}
+
+void
+EthernetNetDevice::SetLatencyHistograms (bool enable)
+{
+  NS_LOG_FUNCTION (enable);
+  if (enable != m_latencyEnabled)
+    {
+      ConnectLatencySinks (enable);
+      m_latencyEnabled = enable;
+    }
+}
+
+bool
+EthernetNetDevice::GetLatencyHistograms (void) const
+{
+  return m_latencyEnabled;
+}
+
+const EthernetLatencyHistogram &
+EthernetNetDevice::GetLatencyHistogram (LatencyInterval interval) const
+{
+  NS_ASSERT (interval < N_LATENCY_INTERVALS);
+  return m_latency[interval];
+}
+
+void
+EthernetNetDevice::ConnectLatencySinks (bool connect)
+{
+  NS_LOG_FUNCTION (connect);
+
+  Ptr<Queue> queue = GetQueue ();
+  if (connect)
+    {
+      if (queue != 0)
+        {
+          queue->TraceConnectWithoutContext ("Dequeue", MakeCallback (&EthernetNetDevice::LatencyDequeue, this));
+        }
+      m_txDev->TraceConnectWithoutContext ("PhyTxEnd", MakeCallback (&EthernetNetDevice::LatencyTxEnd, this));
+      m_rxDev->TraceConnectWithoutContext ("MacRx", MakeCallback (&EthernetNetDevice::LatencyRx, this));
+    }
+  else
+    {
+      if (queue != 0)
+        {
+          queue->TraceDisconnectWithoutContext ("Dequeue", MakeCallback (&EthernetNetDevice::LatencyDequeue, this));
+        }
+      m_txDev->TraceDisconnectWithoutContext ("PhyTxEnd", MakeCallback (&EthernetNetDevice::LatencyTxEnd, this));
+      m_rxDev->TraceDisconnectWithoutContext ("MacRx", MakeCallback (&EthernetNetDevice::LatencyRx, this));
+    }
+}
+
+void
+EthernetNetDevice::StampTimestamp (Ptr<Packet> packet)
+{
+  EthernetTimestampTag tag (Simulator::Now ());
+  EthernetTimestampTag previous;
+  if (packet->RemovePacketTag (previous))
+    {
+      tag.SetOrigin (previous.GetOrigin ());
+    }
+  packet->AddPacketTag (tag);
+}
+
+void
+EthernetNetDevice::LatencyDequeue (Ptr<const Packet> packet)
+{
+  m_lastDequeue = Simulator::Now ();
+  EthernetTimestampTag tag;
+  if (packet->PeekPacketTag (tag))
+    {
+      m_latency[QUEUEING].Record (m_lastDequeue - tag.GetHop ());
+    }
+}
+
+void
+EthernetNetDevice::LatencyTxEnd (Ptr<const Packet> packet)
+{
+  ETHERNET_PROFILE (TRANSMIT_COMPLETE);
+  m_latency[TRANSMISSION].Record (Simulator::Now () - m_lastDequeue);
+}
+
+void
+EthernetNetDevice::LatencyRx (Ptr<const Packet> packet)
+{
+  EthernetTimestampTag tag;
+  if (!packet->PeekPacketTag (tag))
+    {
+      return;
+    }
+  //
+  // The channel has its own copy of the frame before the sender sees the
+  // end of the transmission, so the tag cannot tell when it went out: the
+  // frame took its transmit time at the rate of the incoming direction,
+  // then the delay of that direction.
+  //
+  if (m_channel != 0)
+    {
+      uint32_t direction = 1 - m_deviceId;
+      Time transmit = m_channel->GetDirectionDataRate (direction).CalculateTxTime (packet->GetSize ());
+      m_latency[LINK].Record (transmit + m_channel->GetDirectionDelay (direction));
+    }
+  m_latency[END_TO_END].Record (Simulator::Now () - tag.GetOrigin ());
+}
+
+void
+EthernetNetDevice::NotifyLinkUp (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_linkUp = true;
+  m_linkChangeCallbacks ();
+}
+
+/**
+ * Queue::Drop, which counts a packet as dropped by the queue and fires the
+ * Drop trace, is only open to the queues themselves.
+ */
+namespace {
+class QueueDropPath : public Queue
+{
+public:
+  static void DropFrom (Ptr<Queue> queue, Ptr<Packet> packet)
+  {
+    void (Queue::*drop)(Ptr<Packet>) = &QueueDropPath::Drop;
+    (PeekPointer (queue)->*drop)(packet);
+  }
+};
+} // anonymous namespace
+
+void
+EthernetNetDevice::SetLinkState (bool up)
+{
+  NS_LOG_FUNCTION (up);
+
+  Simulator::Cancel (m_receiveEnableEvent);
+  m_txDev->SetSendEnable (up);
+  if (up)
+    {
+      //
+      // The frames sent before the failure are all gone by one delay after
+      // the link came back up, unless the link was down for less than a
+      // frame time.
+      //
+      Time delay = m_channel == 0 ? Seconds (0) : m_channel->GetDirectionDelay (1 - m_deviceId);
+      m_receiveEnableEvent = Simulator::Schedule (delay, &CsmaNetDevice::SetReceiveEnable, m_rxDev, true);
+    }
+  else
+    {
+      m_rxDev->SetReceiveEnable (false);
+
+      //
+      // A queue cannot give up its frames other than by dequeuing them:
+      // the accounting of the device done on Dequeue is taken off while
+      // the queue is emptied, and each frame goes through the drop path
+      // of the queue as well as MacTxDrop.
+      //
+      if (m_latencyEnabled)
+        {
+          ConnectLatencySinks (false);
+        }
+      if (m_snapshotsEnabled)
+        {
+          ConnectQueueSinks (false);
+        }
+      Ptr<Queue> queue = GetQueue ();
+      while (Ptr<Packet> packet = queue->Dequeue ())
+        {
+          QueueDropPath::DropFrom (queue, packet);
+          m_macTxDropTrace (packet);
+        }
+      if (m_snapshotsEnabled)
+        {
+          ConnectQueueSinks (true);
+        }
+      if (m_latencyEnabled)
+        {
+          ConnectLatencySinks (true);
+        }
+
+      //
+      // Nothing waiting upstream of the transmit queue survives the
+      // failure either, and the transmit path starts afresh: the frame on
+      // the wire never ends, and the rest of a partly sent one is lost.
+      //
+      Simulator::Cancel (m_shaperEvent);
+      while (!m_shaperBacklog.empty ())
+        {
+          const PendingFrame &frame = m_shaperBacklog.front ();
+          NotifyTxDrop (frame.packet, frame.src, frame.dest, frame.protocol);
+          m_shaperBacklog.pop_front ();
+        }
+      Simulator::Cancel (m_gateEvent);
+      m_transmitting = false;
+      if (m_fragmentIndex != 0)
+        {
+          m_fragmentIndex = 0;
+          ++m_fragmentSequence;
+        }
+      for (uint32_t i = 0; i < N_TRAFFIC_CLASSES; ++i)
+        {
+          while (!m_trafficClassQueues[i].empty ())
+            {
+              const PendingFrame &frame = m_trafficClassQueues[i].front ();
+              NotifyTxDrop (frame.packet, frame.src, frame.dest, frame.protocol);
+              m_trafficClassQueues[i].pop_front ();
+            }
+        }
+    }
+
+  if (up != m_linkUp)
+    {
+      NS_LOG_LOGIC ("Link " << (up ? "up" : "down"));
+      m_linkUp = up;
+      m_linkChangeCallbacks ();
+    }
+}
+
+void
+EthernetNetDevice::AddLinkChangeCallback (Callback<void> callback)
+{
+  m_linkChangeCallbacks.ConnectWithoutContext (callback);
+}
+
+void 
+EthernetNetDevice::SetReceiveCallback (NetDevice::ReceiveCallback cb)
+{
+  m_rxCallback = cb;
+  UpdateReceiveCallbacks ();
+}
+
+void 
+EthernetNetDevice::SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb)
+{
+  m_promiscRxCallback = cb;
+  UpdateReceiveCallbacks ();
+}
+
+void
+EthernetNetDevice::UpdateReceiveCallbacks (void)
+{
+  //
+  // The non-promiscuous receive callback does not get the destination
+  // address.  With the multicast filter on, frames are delivered from the
+  // promiscuous one instead and the other does nothing.
+  //
+  bool filtering = m_multicastFilter && !m_rxCallback.IsNull ();
+
+  if (m_rxCallback.IsNull ()) 
+    {
+      m_rxDev->SetReceiveCallback (m_rxCallback);
+    }
+  else if (filtering)
+    {
+      m_rxDev->SetReceiveCallback (MakeCallback (&EthernetNetDevice::DiscardReceiveFromDevice, this));
+    }
+  else
+    {
+      m_rxDev->SetReceiveCallback (MakeCallback (&EthernetNetDevice::NonPromiscReceiveFromDevice, this));
+    }
+
+  if (m_promiscRxCallback.IsNull () && !filtering && m_virtualFunctions.empty ())
+    {
+      m_rxDev->SetPromiscReceiveCallback (m_promiscRxCallback);
+    }
+  else
+    {
+      m_rxDev->SetPromiscReceiveCallback (MakeCallback (&EthernetNetDevice::PromiscReceiveFromDevice, this));
+    }
+}
+
+bool
+EthernetNetDevice::NonPromiscReceiveFromDevice (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                                   const Address &from)
+{
+  ETHERNET_PROFILE (RECEIVE);
+  if (protocol == EthernetFragmentHeader::ETHERTYPE)
+    {
+      Ptr<Packet> whole = Reassemble (0, packet, Mac48Address::ConvertFrom (from), protocol);
+      if (whole == 0)
+        {
+          return true;
+        }
+      packet = whole;
+    }
+  if (m_vlanMode != VLAN_NONE)
+    {
+      Ptr<Packet> copy = packet->Copy ();
+      if (!PopVlanTag (copy, protocol))
+        {
+          return true;
+        }
+      EthernetVlanTag tag;
+      copy->RemovePacketTag (tag);
+      return ForwardUp (copy, protocol, from);
+    }
+  return ForwardUp (packet, protocol, from);
+}
+
+bool
+EthernetNetDevice::DiscardReceiveFromDevice (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                                             const Address &from)
+{
+  return true;
+}
+
+bool
+EthernetNetDevice::PromiscReceiveFromDevice (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                                const Address &from, const Address &to, NetDevice::PacketType packetType)
+{
+  ETHERNET_PROFILE (RECEIVE);
+  if (protocol == EthernetFragmentHeader::ETHERTYPE)
+    {
+      Ptr<Packet> whole = Reassemble (1, packet, Mac48Address::ConvertFrom (from), protocol);
+      if (whole == 0)
+        {
+          return true;
+        }
+      packet = whole;
+    }
+  //
+  // The promiscuous receive callback gets the frame tagged with its VLAN,
+  // the stacks above get it as it was sent.
+  //
+  Ptr<const Packet> untagged = packet;
+  if (m_vlanMode != VLAN_NONE)
+    {
+      Ptr<Packet> copy = packet->Copy ();
+      if (!PopVlanTag (copy, protocol))
+        {
+          return true;
+        }
+      packet = copy;
+      if (!m_virtualFunctions.empty () || (m_multicastFilter && !m_rxCallback.IsNull ()))
+        {
+          Ptr<Packet> stripped = copy->Copy ();
+          EthernetVlanTag tag;
+          stripped->RemovePacketTag (tag);
+          untagged = stripped;
+        }
+    }
+  if (!m_virtualFunctions.empty ())
+    {
+      DemuxVirtualFunctions (untagged, protocol, from, to, packetType);
+    }
+  if (!m_promiscRxCallback.IsNull ())
+    {
+      ETHERNET_PROFILE (DELIVER);
+      m_promiscRxCallback (this, packet, protocol, from, to, packetType);
+    }
+  if (m_multicastFilter && !m_rxCallback.IsNull () && packetType != PACKET_OTHERHOST)
+    {
+      if (packetType == PACKET_MULTICAST && !IsMulticastAccepted (Mac48Address::ConvertFrom (to)))
+        {
+          NS_LOG_LOGIC ("Filtering multicast frame to " << to);
+          return true;
+        }
+      ForwardUp (untagged, protocol, from);
+    }
+  return true;
+}
+
+void
+EthernetNetDevice::SetReceiveQueues (uint32_t n)
+{
+  NS_LOG_FUNCTION (n);
+  for (uint32_t i = 0; i < m_receiveQueues.size (); ++i)
+    {
+      FlushReceiveQueue (i);
+    }
+  ReceiveQueue queue;
+  queue.serviceRate = m_receiveServiceRate;
+  queue.drops = 0;
+  m_receiveQueues.assign (n, queue);
+}
+
+uint32_t
+EthernetNetDevice::GetReceiveQueues (void) const
+{
+  return m_receiveQueues.size ();
+}
+
+void
+EthernetNetDevice::SetReceiveServiceRate (double framesPerSecond)
+{
+  NS_LOG_FUNCTION (framesPerSecond);
+  m_receiveServiceRate = framesPerSecond;
+  for (uint32_t i = 0; i < m_receiveQueues.size (); ++i)
+    {
+      SetReceiveQueueServiceRate (i, framesPerSecond);
+    }
+}
+
+double
+EthernetNetDevice::GetReceiveServiceRate (void) const
+{
+  return m_receiveServiceRate;
+}
+
+void
+EthernetNetDevice::SetReceiveQueueServiceRate (uint32_t queue, double framesPerSecond)
+{
+  NS_LOG_FUNCTION (queue << framesPerSecond);
+  NS_ASSERT_MSG (queue < m_receiveQueues.size (), "EthernetNetDevice::SetReceiveQueueServiceRate(): no such queue");
+  NS_ASSERT (framesPerSecond >= 0);
+  ReceiveQueue &q = m_receiveQueues[queue];
+  q.serviceRate = framesPerSecond;
+  //
+  // The frame being served keeps the time it was given; the next ones are
+  // served at the new rate.
+  //
+  if (framesPerSecond == 0)
+    {
+      FlushReceiveQueue (queue);
+    }
+}
+
+void
+EthernetNetDevice::SetReceiveQueueCallback (uint32_t queue, NetDevice::ReceiveCallback cb)
+{
+  NS_ASSERT_MSG (queue < m_receiveQueues.size (), "EthernetNetDevice::SetReceiveQueueCallback(): no such queue");
+  m_receiveQueues[queue].callback = cb;
+}
+
+uint32_t
+EthernetNetDevice::GetReceiveQueueLength (uint32_t queue) const
+{
+  NS_ASSERT (queue < m_receiveQueues.size ());
+  return m_receiveQueues[queue].frames.size ();
+}
+
+uint64_t
+EthernetNetDevice::GetReceiveQueueDrops (uint32_t queue) const
+{
+  NS_ASSERT (queue < m_receiveQueues.size ());
+  return m_receiveQueues[queue].drops;
+}
+
+uint64_t
+EthernetNetDevice::GetNReceivedFrames (void) const
+{
+  return m_nReceivedFrames;
+}
+
+uint64_t
+EthernetNetDevice::GetNReceivedBytes (void) const
+{
+  return m_nReceivedBytes;
+}
+
+uint64_t
+EthernetNetDevice::GetNQueuedFrames (void) const
+{
+  return m_queuedFramesBase + GetQueue ()->GetTotalReceivedPackets ();
+}
+
+uint64_t
+EthernetNetDevice::GetNQueuedBytes (void) const
+{
+  return m_queuedBytesBase + GetQueue ()->GetTotalReceivedBytes ();
+}
+
+uint64_t
+EthernetNetDevice::GetNQueueDrops (void) const
+{
+  return m_queueDropsBase + GetQueue ()->GetTotalDroppedPackets ();
+}
+
+bool
+EthernetNetDevice::ForwardUp (Ptr<const Packet> packet, uint16_t protocol, const Address &from)
+{
+  uint32_t n = m_receiveQueues.size ();
+  if (n == 0)
+    {
+      ETHERNET_PROFILE (DELIVER);
+      ++m_nReceivedFrames;
+      m_nReceivedBytes += packet->GetSize ();
+      return m_rxCallback (this, packet, protocol, from);
+    }
+
+  uint32_t index = 0;
+  if (n > 1)
+    {
+      if (m_rssHash == 0)
+        {
+          m_rssHash = CreateObject<EthernetEcmpGroup> ();
+        }
+      index = m_rssHash->Hash (packet, protocol, Mac48Address::ConvertFrom (from), m_address) % n;
+    }
+
+  ReceiveQueue &queue = m_receiveQueues[index];
+  if (queue.serviceRate == 0 && queue.frames.empty ())
+    {
+      return DeliverFrame (index, packet, protocol, from);
+    }
+  if (queue.frames.size () >= m_receiveQueueLimit)
+    {
+      NS_LOG_LOGIC ("Receive queue " << index << " full, dropping frame");
+      ++queue.drops;
+      ETHERNET_PROFILE (TRACE_DISPATCH);
+      m_rxQueueDropTrace (packet, index);
+      return false;
+    }
+
+  ReceivedFrame frame;
+  frame.packet = packet;
+  frame.protocol = protocol;
+  frame.from = from;
+  queue.frames.push_back (frame);
+  if (!queue.event.IsRunning ())
+    {
+      queue.event = Simulator::Schedule (Seconds (1 / queue.serviceRate),
+                                         &EthernetNetDevice::ServeReceiveQueue, this, index);
+    }
+  return true;
+}
+
+void
+EthernetNetDevice::ServeReceiveQueue (uint32_t index)
+{
+  ReceiveQueue &queue = m_receiveQueues[index];
+  NS_ASSERT (!queue.frames.empty ());
+  ReceivedFrame frame = queue.frames.front ();
+  queue.frames.pop_front ();
+  if (!queue.frames.empty ())
+    {
+      queue.event = Simulator::Schedule (Seconds (1 / queue.serviceRate),
+                                         &EthernetNetDevice::ServeReceiveQueue, this, index);
+    }
+  DeliverFrame (index, frame.packet, frame.protocol, frame.from);
+}
+
+void
+EthernetNetDevice::FlushReceiveQueue (uint32_t index)
+{
+  ReceiveQueue &queue = m_receiveQueues[index];
+  Simulator::Cancel (queue.event);
+  while (!queue.frames.empty ())
+    {
+      ReceivedFrame frame = queue.frames.front ();
+      queue.frames.pop_front ();
+      DeliverFrame (index, frame.packet, frame.protocol, frame.from);
+    }
+}
+
+bool
+EthernetNetDevice::DeliverFrame (uint32_t index, Ptr<const Packet> packet, uint16_t protocol, const Address &from)
+{
+  ETHERNET_PROFILE (DELIVER);
+  ++m_nReceivedFrames;
+  m_nReceivedBytes += packet->GetSize ();
+  const NetDevice::ReceiveCallback &cb = m_receiveQueues[index].callback;
+  if (!cb.IsNull ())
+    {
+      return cb (this, packet, protocol, from);
+    }
+  return m_rxCallback (this, packet, protocol, from);
+}
+
+void
+EthernetNetDevice::AddVirtualFunction (Ptr<EthernetVirtualFunction> vf)
+{
+  NS_LOG_FUNCTION (vf);
+  if (FindVirtualFunction (Mac48Address::ConvertFrom (vf->GetAddress ())) != 0)
+    {
+      NS_FATAL_ERROR ("EthernetNetDevice::AddVirtualFunction(): address already in use");
+    }
+  if (m_virtualFunctions.empty ())
+    {
+      m_txDev->TraceConnectWithoutContext ("PhyTxEnd", MakeCallback (&EthernetNetDevice::VirtualFunctionTxEnd, this));
+    }
+  m_virtualFunctions.push_back (vf);
+  vf->SetPhysicalDevice (this);
+  RebuildVirtualFunctionTable ();
+  UpdateReceiveCallbacks ();
+}
+
+uint32_t
+EthernetNetDevice::GetNVirtualFunctions (void) const
+{
+  return m_virtualFunctions.size ();
+}
+
+Ptr<EthernetVirtualFunction>
+EthernetNetDevice::GetVirtualFunction (uint32_t i) const
+{
+  NS_ASSERT (i < m_virtualFunctions.size ());
+  return m_virtualFunctions[i];
+}
+
+uint32_t
+EthernetNetDevice::GetVirtualFunctionSlot (Mac48Address address) const
+{
+  //
+  // The vendor part of the addresses is mostly the same, the low four
+  // bytes are what tells them apart.
+  //
+  uint8_t buffer[6];
+  address.CopyTo (buffer);
+  uint32_t key = ((uint32_t) buffer[2] << 24) | ((uint32_t) buffer[3] << 16) | ((uint32_t) buffer[4] << 8) | buffer[5];
+  return (key * 0x9e3779b1) & (m_virtualFunctionTable.size () - 1);
+}
+
+void
+EthernetNetDevice::RebuildVirtualFunctionTable (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  uint32_t size = 4;
+  while (size < 2 * m_virtualFunctions.size ())
+    {
+      size *= 2;
+    }
+  VirtualFunctionSlot empty;
+  empty.index = -1;
+  m_virtualFunctionTable.assign (size, empty);
+  for (uint32_t i = 0; i < m_virtualFunctions.size (); ++i)
+    {
+      Mac48Address address = Mac48Address::ConvertFrom (m_virtualFunctions[i]->GetAddress ());
+      uint32_t slot = GetVirtualFunctionSlot (address);
+      while (m_virtualFunctionTable[slot].index >= 0)
+        {
+          slot = (slot + 1) & (size - 1);
+        }
+      m_virtualFunctionTable[slot].address = address;
+      m_virtualFunctionTable[slot].index = i;
+    }
+}
+
+Ptr<EthernetVirtualFunction>
+EthernetNetDevice::FindVirtualFunction (Mac48Address address) const
+{
+  if (m_virtualFunctionTable.empty ())
+    {
+      return 0;
+    }
+  uint32_t mask = m_virtualFunctionTable.size () - 1;
+  for (uint32_t slot = GetVirtualFunctionSlot (address); ; slot = (slot + 1) & mask)
+    {
+      const VirtualFunctionSlot &entry = m_virtualFunctionTable[slot];
+      if (entry.index < 0)
+        {
+          return 0;
+        }
+      if (entry.address == address)
+        {
+          return m_virtualFunctions[entry.index];
+        }
+    }
+}
+
+void
+EthernetNetDevice::DemuxVirtualFunctions (Ptr<const Packet> packet, uint16_t protocol, const Address &from,
+                                          const Address &to, NetDevice::PacketType packetType)
+{
+  if (packetType == PACKET_OTHERHOST)
+    {
+      Ptr<EthernetVirtualFunction> vf = FindVirtualFunction (Mac48Address::ConvertFrom (to));
+      if (vf != 0)
+        {
+          vf->Receive (packet, protocol, from, to, PACKET_HOST);
+        }
+    }
+  else if (packetType != PACKET_HOST)
+    {
+      for (uint32_t i = 0; i < m_virtualFunctions.size (); ++i)
+        {
+          m_virtualFunctions[i]->Receive (packet, protocol, from, to, packetType);
+        }
+    }
+}
+
+bool
+EthernetNetDevice::SwitchToVirtualFunctions (Ptr<Packet> packet, Mac48Address src, Mac48Address dest,
+                                             uint16_t protocolNumber)
+{
+  if (!dest.IsGroup ())
+    {
+      Ptr<EthernetVirtualFunction> vf = FindVirtualFunction (dest);
+      if (vf == 0)
+        {
+          return false;
+        }
+      NS_LOG_LOGIC ("Switching frame to " << dest << " internally");
+      vf->Receive (packet, protocolNumber, src, dest, NetDevice::PACKET_HOST);
+      return true;
+    }
+  NetDevice::PacketType packetType = dest.IsBroadcast () ? NetDevice::PACKET_BROADCAST : NetDevice::PACKET_MULTICAST;
+  for (uint32_t i = 0; i < m_virtualFunctions.size (); ++i)
+    {
+      m_virtualFunctions[i]->Receive (packet->Copy (), protocolNumber, src, dest, packetType);
+    }
+  return false;
+}
+
+void
+EthernetNetDevice::ReceiveFromVirtualFunction (Ptr<const Packet> packet, uint16_t protocol, Mac48Address from,
+                                               Mac48Address to, NetDevice::PacketType packetType)
+{
+  NS_LOG_FUNCTION (packet << protocol << from << to << packetType);
+  if (!m_promiscRxCallback.IsNull ())
+    {
+      ETHERNET_PROFILE (DELIVER);
+      m_promiscRxCallback (this, packet, protocol, from, to, packetType);
+    }
+  if (m_rxCallback.IsNull ())
+    {
+      return;
+    }
+  if (packetType == PACKET_MULTICAST && m_multicastFilter && !IsMulticastAccepted (to))
+    {
+      NS_LOG_LOGIC ("Filtering multicast frame to " << to);
+      return;
+    }
+  ForwardUp (packet, protocol, from);
+}
+
+void
+EthernetNetDevice::ServeVirtualFunctions (void)
+{
+  uint32_t n = m_virtualFunctions.size ();
+  for (;;)
+    {
+      //
+      // Hand frames over only while the transmit path is idle, so the
+      // virtual functions take turns instead of filling its queues in
+      // arrival order.
+      //
+      if (!GetQueue ()->IsEmpty () || !m_shaperBacklog.empty ())
+        {
+          return;
+        }
+      for (uint32_t tc = 0; tc < N_TRAFFIC_CLASSES; ++tc)
+        {
+          if (!m_trafficClassQueues[tc].empty ())
+            {
+              return;
+            }
+        }
+
+      uint32_t i = 0;
+      while (i < n && !m_virtualFunctions[(m_nextVirtualFunction + i) % n]->TransmitNext ())
+        {
+          ++i;
+        }
+      if (i == n)
+        {
+          return;
+        }
+      m_nextVirtualFunction = (m_nextVirtualFunction + i + 1) % n;
+    }
+}
+
+void
+EthernetNetDevice::VirtualFunctionTxEnd (Ptr<const Packet> packet)
+{
+  ETHERNET_PROFILE (TRANSMIT_COMPLETE);
+  ServeVirtualFunctions ();
+}
+
+void
+EthernetNetDevice::UnframeFrame (Ptr<Packet> frame, Mac48Address &src, Mac48Address &dest, uint16_t &protocol) const
+{
+  EthernetTrailer trailer;
+  frame->RemoveTrailer (trailer);
+  EthernetHeader header (false);
+  frame->RemoveHeader (header);
+  src = header.GetSource ();
+  dest = header.GetDestination ();
+  protocol = header.GetLengthType ();
+  if (GetFramingMode () == CsmaNetDevice::LLC)
+    {
+      LlcSnapHeader llc;
+      frame->RemoveHeader (llc);
+      protocol = llc.GetType ();
+    }
+}
+
+static void
+WritePendingFrame (EthernetSnapshotWriter &writer, Ptr<const Packet> packet, Mac48Address src,
+                   Mac48Address dest, uint16_t protocol)
+{
+  writer.WriteMac48Address (src);
+  writer.WriteMac48Address (dest);
+  writer.WriteU16 (protocol);
+  writer.WritePacket (packet);
+  //
+  // The VLAN tag of a frame gives its traffic class.
+  //
+  EthernetVlanTag tag;
+  bool tagged = packet->PeekPacketTag (tag);
+  writer.WriteU8 (tagged);
+  writer.WriteU16 (tagged ? tag.GetVid () : 0);
+  writer.WriteU8 (tagged ? tag.GetPcp () : 0);
+}
+
+static Ptr<Packet>
+ReadPendingFrame (EthernetSnapshotReader &reader, Mac48Address &src, Mac48Address &dest, uint16_t &protocol)
+{
+  src = reader.ReadMac48Address ();
+  dest = reader.ReadMac48Address ();
+  protocol = reader.ReadU16 ();
+  Ptr<Packet> packet = reader.ReadPacket ();
+  bool tagged = reader.ReadU8 ();
+  uint16_t vid = reader.ReadU16 ();
+  uint8_t pcp = reader.ReadU8 ();
+  if (tagged)
+    {
+      packet->AddPacketTag (EthernetVlanTag (vid, pcp));
+    }
+  return packet;
+}
+
+void
+EthernetNetDevice::SaveState (EthernetSnapshotWriter &writer) const
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  writer.WriteU8 (m_linkUp);
+
+  NS_ABORT_MSG_IF (!m_snapshotsEnabled && GetQueue ()->GetNPackets () != 0,
+                   "EthernetNetDevice::SaveState(): frames queued, but the Snapshots attribute is not set");
+  writer.WriteU64 (GetNQueuedFrames ());
+  writer.WriteU64 (GetNQueuedBytes ());
+  writer.WriteU64 (GetNQueueDrops ());
+  writer.WriteU64 (m_nReceivedFrames);
+  writer.WriteU64 (m_nReceivedBytes);
+  writer.WriteU32 (m_queuedFrames.size ());
+  for (std::deque<Ptr<const Packet> >::const_iterator i = m_queuedFrames.begin (); i != m_queuedFrames.end (); ++i)
+    {
+      Ptr<Packet> copy = (*i)->Copy ();
+      Mac48Address src;
+      Mac48Address dest;
+      uint16_t protocol;
+      UnframeFrame (copy, src, dest, protocol);
+      WritePendingFrame (writer, copy, src, dest, protocol);
+    }
+
+  //
+  // The tokens as RefillTokens would leave them now.
+  //
+  double tokens = m_shaperTokens;
+  if (m_shaperRate.GetBitRate () != 0)
+    {
+      tokens += (Simulator::Now () - m_shaperLastUpdate).GetSeconds () * m_shaperRate.GetBitRate () / 8;
+      tokens = std::min (tokens, (double) m_shaperBurst);
+    }
+  writer.WriteDouble (tokens);
+  writer.WriteU32 (m_shaperBacklog.size ());
+  for (std::deque<PendingFrame>::const_iterator i = m_shaperBacklog.begin (); i != m_shaperBacklog.end (); ++i)
+    {
+      WritePendingFrame (writer, i->packet, i->src, i->dest, i->protocol);
+    }
+
+  for (uint32_t tc = 0; tc < N_TRAFFIC_CLASSES; ++tc)
+    {
+      std::deque<PendingFrame>::const_iterator i = m_trafficClassQueues[tc].begin ();
+      if (m_fragmentIndex != 0 && tc == m_fragmentClass)
+        {
+          ++i;
+        }
+      writer.WriteU32 (m_trafficClassQueues[tc].end () - i);
+      for (; i != m_trafficClassQueues[tc].end (); ++i)
+        {
+          WritePendingFrame (writer, i->packet, i->src, i->dest, i->protocol);
+        }
+    }
+
+  writer.WriteU32 (m_receiveQueues.size ());
+  for (uint32_t q = 0; q < m_receiveQueues.size (); ++q)
+    {
+      const ReceiveQueue &queue = m_receiveQueues[q];
+      writer.WriteU64 (queue.drops);
+      writer.WriteU32 (queue.frames.size ());
+      for (std::deque<ReceivedFrame>::const_iterator i = queue.frames.begin (); i != queue.frames.end (); ++i)
+        {
+          writer.WriteU16 (i->protocol);
+          writer.WriteMac48Address (Mac48Address::ConvertFrom (i->from));
+          writer.WritePacket (i->packet);
+        }
+    }
+}
+
+void
+EthernetNetDevice::RestoreState (EthernetSnapshotReader &reader)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  NS_ABORT_MSG_IF (m_channel == 0, "EthernetNetDevice::RestoreState(): device not attached");
+
+  bool linkUp = reader.ReadU8 ();
+  if (linkUp != m_linkUp)
+    {
+      SetLinkState (linkUp);
+    }
+
+  uint64_t queuedFrames = reader.ReadU64 ();
+  uint64_t queuedBytes = reader.ReadU64 ();
+  uint64_t queueDrops = reader.ReadU64 ();
+  m_nReceivedFrames = reader.ReadU64 ();
+  m_nReceivedBytes = reader.ReadU64 ();
+
+  //
+  // The frames which had made it to the transmit queue skip the shaper
+  // and the traffic class queues.  They were counted already, so the
+  // counters of the queue are made to read as saved once they are back.
+  //
+  Ptr<Queue> queue = GetQueue ();
+  queue->ResetStatistics ();
+  uint32_t n = reader.ReadU32 ();
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      Mac48Address src;
+      Mac48Address dest;
+      uint16_t protocol;
+      Ptr<Packet> packet = ReadPendingFrame (reader, src, dest, protocol);
+      TransmitFrame (packet, src, dest, protocol);
+    }
+  m_queuedFramesBase = queuedFrames - std::min<uint64_t> (queuedFrames, queue->GetTotalReceivedPackets ());
+  m_queuedBytesBase = queuedBytes - std::min<uint64_t> (queuedBytes, queue->GetTotalReceivedBytes ());
+  m_queueDropsBase = queueDrops - std::min<uint64_t> (queueDrops, queue->GetTotalDroppedPackets ());
+
+  m_shaperTokens = std::min (reader.ReadDouble (), (double) m_shaperBurst);
+  m_shaperLastUpdate = Simulator::Now ();
+  n = reader.ReadU32 ();
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      PendingFrame frame;
+      frame.packet = ReadPendingFrame (reader, frame.src, frame.dest, frame.protocol);
+      if (m_shaperRate.GetBitRate () != 0)
+        {
+          m_shaperBacklog.push_back (frame);
+        }
+      else
+        {
+          DispatchFrame (frame.packet, frame.src, frame.dest, frame.protocol);
+        }
+    }
+  if (!m_shaperBacklog.empty ())
+    {
+      Simulator::Cancel (m_shaperEvent);
+      ReleaseShapedFrames ();
+    }
+
+  for (uint32_t tc = 0; tc < N_TRAFFIC_CLASSES; ++tc)
+    {
+      n = reader.ReadU32 ();
+      for (uint32_t i = 0; i < n; ++i)
+        {
+          PendingFrame frame;
+          frame.packet = ReadPendingFrame (reader, frame.src, frame.dest, frame.protocol);
+          if (m_scheduling)
+            {
+              m_trafficClassQueues[tc].push_back (frame);
+            }
+          else
+            {
+              TransmitFrame (frame.packet, frame.src, frame.dest, frame.protocol);
+            }
+        }
+    }
+  TransmitNextFrame ();
+
+  //
+  // The frames go through the receive queues as they are now, hashed
+  // again.
+  //
+  uint32_t nQueues = reader.ReadU32 ();
+  for (uint32_t q = 0; q < nQueues; ++q)
+    {
+      uint64_t drops = reader.ReadU64 ();
+      if (nQueues == m_receiveQueues.size ())
+        {
+          m_receiveQueues[q].drops = drops;
+        }
+      n = reader.ReadU32 ();
+      for (uint32_t i = 0; i < n; ++i)
+        {
+          uint16_t protocol = reader.ReadU16 ();
+          Mac48Address from = reader.ReadMac48Address ();
+          Ptr<Packet> packet = reader.ReadPacket ();
+          ForwardUp (packet, protocol, from);
+        }
+    }
+}
+
+void
+EthernetNetDevice::SetMulticastFilter (bool enable)
+{
+  NS_LOG_FUNCTION (enable);
+  m_multicastFilter = enable;
+  UpdateReceiveCallbacks ();
+}
+
+bool
+EthernetNetDevice::GetMulticastFilter (void) const
+{
+  return m_multicastFilter;
+}
+
+uint32_t
+EthernetNetDevice::GetMulticastBucket (Mac48Address group) const
+{
+  //
+  // The bucket is given by the top bits of the Ethernet CRC-32 of the
+  // address, as in most NIC multicast hash filters.
+  //
+  uint8_t buffer[6];
+  group.CopyTo (buffer);
+  uint32_t crc = 0xffffffff;
+  for (uint32_t i = 0; i < 6; ++i)
+    {
+      crc ^= buffer[i];
+      for (uint32_t j = 0; j < 8; ++j)
+        {
+          crc = (crc >> 1) ^ (0xedb88320 & (-(crc & 1)));
+        }
+    }
+  return ~crc >> (32 - m_multicastFilterBits);
+}
+
+void
+EthernetNetDevice::JoinGroup (Mac48Address group)
+{
+  NS_LOG_FUNCTION (group);
+  NS_ASSERT (group.IsGroup ());
+  if (m_multicastBuckets.size () != (1u << m_multicastFilterBits))
+    {
+      m_multicastBuckets.assign (1u << m_multicastFilterBits, 0);
+    }
+  ++m_multicastBuckets[GetMulticastBucket (group)];
+}
+
+void
+EthernetNetDevice::LeaveGroup (Mac48Address group)
+{
+  NS_LOG_FUNCTION (group);
+  if (m_multicastBuckets.size () != (1u << m_multicastFilterBits))
+    {
+      return;
+    }
+  uint32_t &count = m_multicastBuckets[GetMulticastBucket (group)];
+  if (count > 0)
+    {
+      --count;
+    }
+}
+
+bool
+EthernetNetDevice::IsMulticastAccepted (Mac48Address group) const
+{
+  uint8_t buffer[6];
+  group.CopyTo (buffer);
+  //
+  // 01:00:5e:00:00:xx (224.0.0.x), 33:33:00:00:00:xx (ff02::x) and
+  // 33:33:ff:xx:xx:xx (solicited-node) are never joined explicitly.
+  //
+  if (buffer[0] == 0x01 && buffer[1] == 0x00 && buffer[2] == 0x5e
+      && buffer[3] == 0x00 && buffer[4] == 0x00)
+    {
+      return true;
+    }
+  if (buffer[0] == 0x33 && buffer[1] == 0x33
+      && (buffer[2] == 0xff || (buffer[2] == 0x00 && buffer[3] == 0x00 && buffer[4] == 0x00)))
+    {
+      return true;
+    }
+  if (m_multicastBuckets.size () != (1u << m_multicastFilterBits))
+    {
+      return false;
+    }
+  return m_multicastBuckets[GetMulticastBucket (group)] > 0;
 }
 
 } // namespace ns3
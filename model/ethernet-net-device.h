@@ -25,21 +25,34 @@
 #include "ns3/node.h"
 #include "ns3/address.h"
 #include "ns3/net-device.h"
+#include <vector>
+#include <set>
+#include <deque>
+#include <map>
+#include <list>
 #include "ns3/callback.h"
 #include "ns3/packet.h"
 #include "ns3/traced-callback.h"
 #include "ns3/nstime.h"
 #include "ns3/data-rate.h"
+#include "ns3/event-id.h"
 #include "ns3/ptr.h"
 #include "ns3/random-variable.h"
 #include "ns3/mac48-address.h"
 #include "ns3/csma-net-device.h"
+#include "ethernet-header-cache.h"
+#include "ethernet-latency-histogram.h"
 
 namespace ns3 {
 
 class Queue;
 class EthernetChannel;
 class ErrorModel;
+class EthernetEcmpGroup;
+class EthernetVirtualFunction;
+class EthernetSnapshotWriter;
+class EthernetSnapshotReader;
+class EthernetProfiledSink;
 
 class ProxyTracedCallback
 {
@@ -51,10 +64,52 @@ public:
   void Connect (const CallbackBase &callback, std::string context);
   void DisconnectWithoutContext (const CallbackBase &callback);
   void Disconnect (const CallbackBase &callback, std::string context);
+  /**
+   * Fire the sinks for a packet that did not go through the proxied
+   * objects.
+   */
+  void operator() (Ptr<const Packet> packet) const;
+  /**
+   * @return true if no sink is connected to this trace source
+   */
+  bool IsEmpty (void) const;
+  /**
+   * Set a callback invoked every time a sink is connected or disconnected.
+   */
+  void SetSinksChangedCallback (Callback<void> callback);
 private:
+  void NotifySinksChanged (void);
+  /**
+   * @return the sink to connect to the proxied objects for callback, which
+   * accounts its time when profiling
+   */
+  CallbackBase AddProxiedSink (const CallbackBase &callback, bool hasContext, std::string context);
+  /**
+   * @return the sink connected to the proxied objects for callback
+   */
+  CallbackBase RemoveProxiedSink (const CallbackBase &callback, bool hasContext, std::string context);
+  /**
+   * Forget a sink connected through this trace source.
+   *
+   * @return false if callback was not connected with this context
+   */
+  bool RemoveSink (const CallbackBase &callback, bool hasContext, std::string context);
+
+  struct Sink
+  {
+    bool hasContext;
+    std::string context;
+    Callback<void, Ptr<const Packet> > sink;
+    Callback<void, std::string, Ptr<const Packet> > contextSink;
+  };
+
   std::string m_name;
   Ptr<Object> m_obj1;
   Ptr<Object> m_obj2;
+  TracedCallback<Ptr<const Packet> > m_local;
+  std::list<Sink> m_sinks;
+  Callback<void> m_sinksChanged;
+  std::list<Ptr<EthernetProfiledSink> > m_profiledSinks;
 };
   
 /**
@@ -68,6 +123,26 @@ private:
 class EthernetNetDevice : public NetDevice 
 {
 public:
+  /**
+   * The intervals covered by the latency histograms of a device.
+   */
+  enum LatencyInterval 
+    {
+      QUEUEING = 0,     /**< Send to dequeue from the transmit queue */
+      TRANSMISSION,     /**< dequeue to PhyTxEnd */
+      LINK,             /**< transmission start on the previous hop to MacRx on this device */
+      END_TO_END        /**< first Send along the path to MacRx on this device */
+    };
+  /**
+   * The 802.1Q port modes of a device.
+   */
+  enum VlanMode
+    {
+      VLAN_NONE = 0,    /**< VLAN-unaware, frames are sent and passed up as they are */
+      VLAN_ACCESS,      /**< untagged member of the port VLAN only */
+      VLAN_TRUNK        /**< tagged member of its VLANs, untagged member of the port VLAN */
+    };
+
   static TypeId GetTypeId (void);
   /**
    * Construct a EthernetNetDevice
@@ -92,11 +167,58 @@ public:
   /**
    * Set the interframe gap used to separate packets.  The interframe gap
    * defines the minimum space required between packets sent by this device.
-   * It defaults to 96 bit times.
+   * It defaults to 96 bit times at the data rate of the link, which a
+   * negative gap stands for.
    *
    * @param t the interframe gap time
    */
   void SetInterframeGap (Time t);
+  /**
+   * @return the interframe gap, negative for the default one while the
+   * device is not attached
+   */
+  Time GetInterframeGap (void) const;
+  /**
+   * Enable or disable accurate framing.
+   *
+   * The transmit device puts the frame (header, padded payload and FCS) on
+   * the wire.  With accurate framing the 8 bytes of preamble and SFD are
+   * accounted for too, as part of the gap in front of each frame, so a
+   * minimum-size frame occupies the 84 byte times it does on a real link.
+   * The egress shaper then also charges frames for preamble, SFD and
+   * interframe gap.
+   *
+   * @param enable true to account for preamble and SFD
+   */
+  void SetAccurateFraming (bool enable);
+  /**
+   * @return true if accurate framing is enabled
+   */
+  bool GetAccurateFraming (void) const;
+  /**
+   * Recompute the gap the transmit device leaves in front of each frame.
+   * Called by the channel once it has attached the transmit device, and
+   * when its data rate changes.
+   */
+  void UpdateInterframeGap (void);
+  /**
+   * Bring the link of the device down or up.  Called by the channel for
+   * both of its ends.
+   *
+   * While the link is down the device sends and receives nothing: the
+   * frames waiting in the transmit queue, the shaper, the traffic class
+   * queues and the transmit queues of the virtual functions are dropped
+   * (the transmit queue traces them as drops, not departures), as are the
+   * frames sent meanwhile, and the frames on the wire never arrive.
+   * Receiving resumes one delay of the incoming direction after the link comes
+   * back up, once the frames sent before the failure have gone by.  The
+   * link change callbacks are called, so bonds and switches using the
+   * device for ECMP move its traffic away, and switches forget the
+   * addresses they learned on it.
+   *
+   * @param up true if the link is up
+   */
+  void SetLinkState (bool up);
   /**
    * Attach the device to a channel.
    *
@@ -113,6 +235,19 @@ public:
    * @param queue the queue for being assigned to the device.
    */
   void SetQueue (const Ptr<Queue> &queue);
+  /**
+   * Keep a list of the frames in the transmit queue, which SaveState
+   * needs to save them: the queue cannot be read without dequeuing its
+   * frames.  Enable it before anything is queued.
+   *
+   * @param enable true to keep the list
+   */
+  void SetSnapshotsEnabled (bool enable);
+  /**
+   * @return true if the frames in the transmit queue are listed for
+   * SaveState
+   */
+  bool GetSnapshotsEnabled (void) const;
   /**
    * Get the attached Queue.
    */
@@ -138,6 +273,306 @@ public:
    * @return The encapsulation mode of this device.
    */
   CsmaNetDevice::EncapsulationMode GetEncapsulationMode (void) const;
+  /**
+   * Enable or disable the latency histograms of this device.
+   *
+   * When enabled, every packet sent is tagged with an EthernetTimestampTag
+   * and the QUEUEING and TRANSMISSION intervals are recorded on this device;
+   * LINK and END_TO_END are recorded on the receiving device, which must
+   * have its histograms enabled too.  LINK is worked out from the size of
+   * the frame and the rate and delay of the direction it came in on.
+   *
+   * @param enable true to record latencies
+   */
+  void SetLatencyHistograms (bool enable);
+  /**
+   * @return true if the latency histograms are enabled
+   */
+  bool GetLatencyHistograms (void) const;
+  /**
+   * @param interval the interval of interest
+   * @return the latency histogram of this interval
+   */
+  const EthernetLatencyHistogram &GetLatencyHistogram (LatencyInterval interval) const;
+  /**
+   * Enable or disable the multicast receive filter.
+   *
+   * When enabled, multicast frames are passed up the stack only if their
+   * destination hashes to a bucket of a joined group (as a NIC hash filter
+   * does, with the CRC-32 of the address), so a few unwanted groups may
+   * still get through.  The IPv4 and IPv6 link-local control groups and
+   * the IPv6 solicited-node groups are always accepted, as the stack uses
+   * them without joining.  Promiscuous receivers, such as switches, see
+   * every frame anyway.
+   *
+   * @param enable true to filter multicast frames
+   */
+  void SetMulticastFilter (bool enable);
+  /**
+   * @return true if the multicast receive filter is enabled
+   */
+  bool GetMulticastFilter (void) const;
+  /**
+   * Accept the frames sent to a multicast group.  Joins are counted, every
+   * join must be matched by a leave.
+   *
+   * @param group the group MAC address
+   */
+  void JoinGroup (Mac48Address group);
+  /**
+   * Stop accepting the frames sent to a multicast group.
+   *
+   * @param group the group MAC address
+   */
+  void LeaveGroup (Mac48Address group);
+  /**
+   * Set the 802.1Q mode of this device.
+   *
+   * A VLAN-aware device pops the 802.1Q header of the frames it receives
+   * and tags them with an EthernetVlanTag instead, for its promiscuous
+   * receive callback (a switch); untagged frames get the port VLAN (Pvid).
+   * The frames passed up to the stack and to the virtual functions carry
+   * no tag.  Frames of other VLANs are dropped.  On transmit, the
+   * VLAN and priority come from the EthernetVlanTag of the packet, or are
+   * the port VLAN and 0 if it has none: the frame is sent untagged if it
+   * belongs to the port VLAN, tagged otherwise (trunk mode only).
+   *
+   * In LLC encapsulation mode the LLC/SNAP header goes after the 802.1Q
+   * header, and the transmit device only ever adds DIX headers.
+   *
+   * @param mode the VLAN mode
+   */
+  void SetVlanMode (VlanMode mode);
+  /**
+   * @return the VLAN mode of this device
+   */
+  VlanMode GetVlanMode (void) const;
+  /**
+   * Allow a VLAN on a trunk.  A trunk with no VLAN added carries them all.
+   *
+   * @param vid the VLAN identifier, 1 to 4094
+   */
+  void AddVlan (uint16_t vid);
+  /**
+   * Stop carrying a VLAN on a trunk.
+   *
+   * @param vid the VLAN identifier
+   */
+  void RemoveVlan (uint16_t vid);
+  /**
+   * @param vid a VLAN identifier, 0 for the frames of VLAN-unaware devices
+   * @return true if the frames of this VLAN are sent and received by this
+   * device
+   */
+  bool IsVlanMember (uint16_t vid) const;
+  /**
+   * Set the rate of the egress shaper of this device.
+   *
+   * The shaper is a token bucket in front of the transmit device: a frame
+   * is handed to it only once the bucket holds enough tokens for the whole
+   * frame (header and FCS included), otherwise it waits in the shaper
+   * backlog of ShaperQueueLimit frames.  The bucket fills at this rate up
+   * to ShaperBurst bytes.  Frames bigger than the burst leave with a full
+   * bucket and put it in debt.  A rate of zero disables the shaper and
+   * releases the backlog at once.
+   *
+   * @param rate the sustained egress rate
+   */
+  void SetShaperRate (DataRate rate);
+  /**
+   * @return the rate of the egress shaper, zero if disabled
+   */
+  DataRate GetShaperRate (void) const;
+  /**
+   * Add an entry at the end of the gate control list of the time-aware
+   * shaper (802.1Qbv).
+   *
+   * With a gate control list, frames are queued per traffic class (the
+   * priority of their EthernetVlanTag, 0 without one) and a frame is only
+   * sent if the gate of its class stays open until its last bit is out at
+   * the rate of the channel: the guard band in front of a closing gate is
+   * as long as the frame needs.  Among the classes that can send, the
+   * highest goes first.  The list repeats from GateControlBaseTime on;
+   * before that all the gates are open.
+   *
+   * @param gateStates the gates open during the entry, bit n for class n
+   * @param interval the duration of the entry
+   */
+  void AddGateControlEntry (uint8_t gateStates, Time interval);
+  /**
+   * Remove all the gate control entries, opening all the gates.
+   */
+  void ClearGateControlList (void);
+  /**
+   * @return the time a frame of the maximum size takes on the channel,
+   * which is the longest guard band the time-aware shaper may leave
+   */
+  Time GetGuardBand (void) const;
+  /**
+   * Set the traffic classes sent as express frames (802.3br).
+   *
+   * The other classes become preemptible and, as the transmit device
+   * cannot interrupt a frame on the wire, are sent as fragments of
+   * PreemptionFragmentSize bytes, each a frame of its own (see
+   * EthernetFragmentHeader) reassembled by the receiving device.  Express
+   * frames are sent between fragments, and only the next fragment of a
+   * preemptible frame needs to fit in front of a closing gate.  Zero turns
+   * preemption off.
+   *
+   * @param classes bit n set if class n is express
+   */
+  void SetExpressClasses (uint8_t classes);
+  /**
+   * @return the traffic classes sent as express frames
+   */
+  uint8_t GetExpressClasses (void) const;
+  /**
+   * Set the number of receive queues of this device.
+   *
+   * Without receive queues, the frames received are passed up as soon as
+   * they are in.  With them, the frames to pass up are spread over the
+   * queues by flow hash (receive-side scaling, see the RssHash attribute),
+   * and each queue passes them up one at a time at its service rate, as
+   * the core polling it would.  A full queue drops the frames it gets.
+   * Changing the number of queues first passes up their backlog.
+   *
+   * @param n the number of receive queues, 0 for none
+   */
+  void SetReceiveQueues (uint32_t n);
+  /**
+   * @return the number of receive queues
+   */
+  uint32_t GetReceiveQueues (void) const;
+  /**
+   * Set the service rate of every receive queue, including those created
+   * later on.
+   *
+   * @param framesPerSecond the frames passed up per second, 0 for no limit
+   */
+  void SetReceiveServiceRate (double framesPerSecond);
+  /**
+   * @return the default service rate of the receive queues
+   */
+  double GetReceiveServiceRate (void) const;
+  /**
+   * Set the service rate of a receive queue.  A NAPI budget of B frames
+   * per poll, with a poll every T seconds, is a rate of B / T.
+   *
+   * @param queue the index of the receive queue
+   * @param framesPerSecond the frames passed up per second, 0 for no limit
+   */
+  void SetReceiveQueueServiceRate (uint32_t queue, double framesPerSecond);
+  /**
+   * Pass up the frames of a receive queue through their own callback
+   * instead of the receive callback of the device.
+   *
+   * @param queue the index of the receive queue
+   * @param cb the callback, or a null callback to use the one of the device
+   */
+  void SetReceiveQueueCallback (uint32_t queue, NetDevice::ReceiveCallback cb);
+  /**
+   * @param queue the index of the receive queue
+   * @return the number of frames waiting in the queue
+   */
+  uint32_t GetReceiveQueueLength (uint32_t queue) const;
+  /**
+   * @param queue the index of the receive queue
+   * @return the number of frames the queue dropped
+   */
+  uint64_t GetReceiveQueueDrops (uint32_t queue) const;
+  /**
+   * @return the number of frames passed up to the upper layers, after the
+   * receive queues
+   */
+  uint64_t GetNReceivedFrames (void) const;
+  /**
+   * @return the number of payload bytes passed up to the upper layers
+   */
+  uint64_t GetNReceivedBytes (void) const;
+  /**
+   * @return the number of frames the transmit queue took in, including
+   * those counted before a restored snapshot
+   */
+  uint64_t GetNQueuedFrames (void) const;
+  /**
+   * @return the number of bytes the transmit queue took in, including
+   * those counted before a restored snapshot
+   */
+  uint64_t GetNQueuedBytes (void) const;
+  /**
+   * @return the number of frames the transmit queue dropped, including
+   * those counted before a restored snapshot
+   */
+  uint64_t GetNQueueDrops (void) const;
+  /**
+   * Multiplex a virtual function on this device, see
+   * EthernetVirtualFunction.  The virtual function must have its own
+   * address.
+   *
+   * @param vf the virtual function
+   */
+  void AddVirtualFunction (Ptr<EthernetVirtualFunction> vf);
+  /**
+   * @return the number of virtual functions of this device
+   */
+  uint32_t GetNVirtualFunctions (void) const;
+  /**
+   * @param i the index of the virtual function
+   * @return the virtual function
+   */
+  Ptr<EthernetVirtualFunction> GetVirtualFunction (uint32_t i) const;
+  /**
+   * @param address a MAC address
+   * @return the virtual function with this address, or 0 if none
+   */
+  Ptr<EthernetVirtualFunction> FindVirtualFunction (Mac48Address address) const;
+  /**
+   * Rebuild the address lookup table of the virtual functions.  Called by
+   * the virtual functions when their address changes.
+   */
+  void RebuildVirtualFunctionTable (void);
+  /**
+   * Take frames from the transmit queues of the virtual functions, in
+   * turn, while the transmit path of this device is idle.  Called by the
+   * virtual functions when they queue a frame.
+   */
+  void ServeVirtualFunctions (void);
+  /**
+   * Send a frame of a virtual function of this device, which switched it
+   * to the other functions and to this device already.
+   */
+  bool SendFromVirtualFunction (Ptr<Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocolNumber);
+  /**
+   * Pass up a frame a virtual function of this device switched to it
+   * internally, as if it had been received.
+   */
+  void ReceiveFromVirtualFunction (Ptr<const Packet> packet, uint16_t protocol, Mac48Address from,
+                                   Mac48Address to, NetDevice::PacketType packetType);
+  /**
+   * Write the state of this device to a snapshot: link state, the frames
+   * waiting in the transmit queue, the shaper and the traffic class
+   * queues, the shaper tokens, and the frames waiting in the receive
+   * queues with their drop counters.
+   *
+   * The frame being transmitted, the rest of a partly sent preemptible
+   * frame and the fragments being reassembled are not saved, nor are the
+   * latency histograms.  The frames of the transmit queue are read from a
+   * list kept alongside it, so the queue itself is left alone; aborts if
+   * the queue holds frames and the list is not enabled (see
+   * SetSnapshotsEnabled).  The counters of the transmit queue and of the
+   * frames passed up are saved too.
+   *
+   * @param writer the snapshot to write to
+   */
+  void SaveState (EthernetSnapshotWriter &writer) const;
+  /**
+   * Restore the state SaveState wrote, as of now, on a device configured
+   * and attached as the saved one was.  The frames restored are sent
+   * again through the current configuration.
+   *
+   * @param reader the snapshot to read from
+   */
+  void RestoreState (EthernetSnapshotReader &reader);
   /**
    * Get Tx device
    *
@@ -150,6 +585,11 @@ public:
    * @return net device which is used for receiving
    */
   Ptr<CsmaNetDevice> GetRxDevice (void) const;
+  /**
+   * @return the data rate the device transmits at, which is the data rate
+   * of its direction of the channel
+   */
+  DataRate GetDataRate (void) const;
 
   // The following methods are inherited from NetDevice base class.
   virtual void SetIfIndex (const uint32_t index);
@@ -184,17 +624,193 @@ protected:
 
 private:
   static const uint16_t DEFAULT_MTU = 1500;
+  static const uint32_t N_LATENCY_INTERVALS = 4;
+  static const uint32_t DEFAULT_INTERFRAME_GAP_BITS = 96;
 
   EthernetNetDevice &operator = (const EthernetNetDevice &o);
   EthernetNetDevice (const EthernetNetDevice &o);
 
   void NotifyLinkUp (void);
+  /**
+   * Remove the Ethernet header and trailer, and the LLC/SNAP header if
+   * any, of a frame framed by the transmit device or the header cache.
+   */
+  void UnframeFrame (Ptr<Packet> frame, Mac48Address &src, Mac48Address &dest, uint16_t &protocol) const;
+  /**
+   * Frame a packet from the header cache and put it straight into the
+   * transmit queue, bypassing the framing of the transmit device.  Only
+   * valid while the queue is not empty: the transmit device then keeps
+   * draining it on its own.
+   *
+   * Instantiated for every encapsulation mode and with or without MacTx
+   * tracing, see SelectSendPath.
+   */
+  template <CsmaNetDevice::EncapsulationMode Mode, bool Tracing>
+  bool SendFramed (Ptr<Packet> packet, Mac48Address dest, uint16_t protocolNumber);
+  /**
+   * Pick the SendFramed instantiation matching the current encapsulation
+   * mode and MacTx/MacTxDrop sinks.
+   */
+  void SelectSendPath (void);
+  /**
+   * @return the encapsulation mode of the transmit device and header cache
+   */
+  CsmaNetDevice::EncapsulationMode GetFramingMode (void) const;
+  /**
+   * Push the LLC/SNAP and 802.1Q headers of a frame as needed.
+   *
+   * @param packet the packet to send
+   * @param protocolNumber the protocol of the packet, replaced by the
+   * length/type to put in the Ethernet header
+   * @return false if the frame does not belong to a VLAN of this device
+   */
+  bool PushVlanTag (Ptr<Packet> packet, uint16_t &protocolNumber) const;
+  /**
+   * Pop the 802.1Q and LLC/SNAP headers of a received frame, if any, and
+   * tag it with its VLAN.
+   *
+   * @param packet the packet received
+   * @param protocol the protocol reported by the receive device, replaced
+   * by the one of the payload
+   * @return false if the frame does not belong to a VLAN of this device
+   */
+  bool PopVlanTag (Ptr<Packet> packet, uint16_t &protocol) const;
+
+  typedef bool (EthernetNetDevice::*SendFramedMethod)(Ptr<Packet>, Mac48Address, uint16_t);
+
+  /**
+   * Keep m_queuedFrames in step with the transmit queue, which cannot be
+   * read without dequeuing its frames.
+   */
+  void ConnectQueueSinks (bool connect);
+  void QueueEnqueue (Ptr<const Packet> packet);
+  void QueueDequeue (Ptr<const Packet> packet);
+  void QueueDrop (Ptr<const Packet> packet);
+
+  void ConnectLatencySinks (bool connect);
+  void StampTimestamp (Ptr<Packet> packet);
+  void LatencyDequeue (Ptr<const Packet> packet);
+  void LatencyTxEnd (Ptr<const Packet> packet);
+  void LatencyRx (Ptr<const Packet> packet);
+
+  /**
+   * Fire MacTxDrop for a frame dropped before it was framed, with a
+   * framed copy of it, so the sinks can read its addresses the way they
+   * do for the frames the transmit queue drops.
+   */
+  void NotifyTxDrop (Ptr<const Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocolNumber);
+  /**
+   * Hand a frame to the transmit device, or straight to the transmit
+   * queue when it is backlogged.
+   */
+  bool TransmitFrame (Ptr<Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocolNumber);
+  /**
+   * Send a frame through the egress shaper.
+   */
+  bool ShapeFrame (Ptr<Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocolNumber);
+  /**
+   * Add the tokens earned since the last update to the bucket.
+   */
+  void RefillTokens (void);
+  /**
+   * Send the backlogged frames the bucket has tokens for, and schedule the
+   * next wakeup for the first frame it has not.
+   */
+  void ReleaseShapedFrames (void);
+  /**
+   * @return the bytes a packet of this size takes on the wire, padding,
+   * header and FCS included
+   */
+  uint32_t GetWireSize (uint32_t size) const;
+
+  /**
+   * Hand a frame to the time-aware shaper if it is enabled, to the
+   * transmit device otherwise.
+   */
+  bool DispatchFrame (Ptr<Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocolNumber);
+  /**
+   * Connect to the end of the transmissions when the traffic class
+   * scheduling is needed, disconnect otherwise.
+   */
+  void UpdateScheduling (void);
+  /**
+   * Send the next frame the gates allow, or schedule a wakeup for when
+   * one of them opens.
+   */
+  void TransmitNextFrame (void);
+  void SchedulingTxEnd (Ptr<const Packet> packet);
+  /**
+   * @return the earliest time from which the gate of a class stays open
+   * for a duration, or the maximum simulation time if it never does
+   */
+  Time GetGateOpenTime (uint32_t trafficClass, Time from, Time duration) const;
+  /**
+   * @return the payload bytes of the next fragment of a preemptible frame
+   * with this many bytes left
+   */
+  uint32_t GetFragmentSize (uint32_t remaining) const;
+  /**
+   * Collect the fragments of preempted frames.  The promiscuous and
+   * non-promiscuous receive paths see every fragment, and reassemble
+   * separately.
+   *
+   * @param path 0 for the non-promiscuous path, 1 for the promiscuous one
+   * @return the whole frame once its last fragment is in, 0 otherwise
+   */
+  Ptr<Packet> Reassemble (uint32_t path, Ptr<const Packet> fragment, Mac48Address from, uint16_t &protocol);
+
+  /**
+   * Point the receive callbacks of the receive device at this device,
+   * according to the callbacks set and to the multicast filter.
+   */
+  void UpdateReceiveCallbacks (void);
+  bool DiscardReceiveFromDevice (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                                 const Address &from);
+  uint32_t GetMulticastBucket (Mac48Address group) const;
+  bool IsMulticastAccepted (Mac48Address group) const;
   bool NonPromiscReceiveFromDevice (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
                                    const Address &from);
   bool PromiscReceiveFromDevice (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
                                 const Address &from, const Address &to, NetDevice::PacketType packetType);
+  /**
+   * Pass a frame up, through its receive queue if there are any.
+   */
+  bool ForwardUp (Ptr<const Packet> packet, uint16_t protocol, const Address &from);
+  /**
+   * Pass up the frame at the head of a receive queue, and start serving
+   * the next one.
+   */
+  void ServeReceiveQueue (uint32_t index);
+  /**
+   * Pass up all the frames waiting in a receive queue.
+   */
+  void FlushReceiveQueue (uint32_t index);
+  bool DeliverFrame (uint32_t index, Ptr<const Packet> packet, uint16_t protocol, const Address &from);
+  /**
+   * Pass a received frame to the virtual functions it is for.
+   */
+  void DemuxVirtualFunctions (Ptr<const Packet> packet, uint16_t protocol, const Address &from,
+                              const Address &to, NetDevice::PacketType packetType);
+  void VirtualFunctionTxEnd (Ptr<const Packet> packet);
+  /**
+   * Pass a frame this device sends to the virtual functions it is for.
+   *
+   * @return true if the frame is for a virtual function only, and must
+   * not go on the wire
+   */
+  bool SwitchToVirtualFunctions (Ptr<Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocolNumber);
+  /**
+   * Send a frame through the VLAN tagging, the shaper and the traffic
+   * classes.
+   */
+  bool DoSendFrom (Ptr<Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocolNumber);
+  /**
+   * @return the slot of the address lookup table to start probing from
+   */
+  uint32_t GetVirtualFunctionSlot (Mac48Address address) const;
                                   
   bool m_linkUp;
+  EventId m_receiveEnableEvent;
   CsmaNetDevice::EncapsulationMode m_encapMode;
   Ptr<Node> m_node;
   Ptr<EthernetChannel> m_channel;
@@ -204,6 +820,126 @@ private:
   uint32_t m_ifIndex;
   uint32_t m_mtu;
   Mac48Address m_address;
+  EthernetHeaderCache m_headerCache;
+  SendFramedMethod m_sendFramed;
+
+  bool m_latencyEnabled;
+  EthernetLatencyHistogram m_latency[N_LATENCY_INTERVALS];
+  Time m_lastDequeue;
+
+  bool m_multicastFilter;
+  uint32_t m_multicastFilterBits;
+  std::vector<uint32_t> m_multicastBuckets;
+
+  VlanMode m_vlanMode;
+  uint16_t m_pvid;
+  std::set<uint16_t> m_vlans;
+
+  struct PendingFrame
+  {
+    Ptr<Packet> packet;
+    Mac48Address src;
+    Mac48Address dest;
+    uint16_t protocol;
+  };
+
+  DataRate m_shaperRate;
+  uint32_t m_shaperBurst;
+  uint32_t m_shaperQueueLimit;
+  double m_shaperTokens;
+  Time m_shaperLastUpdate;
+  EventId m_shaperEvent;
+  std::deque<PendingFrame> m_shaperBacklog;
+
+  /**
+   * The frames in the transmit queue, in queue order, when snapshots are
+   * enabled.
+   */
+  std::deque<Ptr<const Packet> > m_queuedFrames;
+  bool m_snapshotsEnabled;
+  /**
+   * The counters of the transmit queue before the snapshot restored, which
+   * the queue cannot be given back.
+   */
+  uint64_t m_queuedFramesBase;
+  uint64_t m_queuedBytesBase;
+  uint64_t m_queueDropsBase;
+
+  static const uint32_t N_TRAFFIC_CLASSES = 8;
+
+  struct GateControlEntry
+  {
+    uint8_t gateStates;
+    Time interval;
+  };
+
+  struct Reassembly
+  {
+    uint8_t sequence;
+    uint8_t nextIndex;
+    Ptr<Packet> packet;
+  };
+  typedef std::map<Mac48Address, Reassembly> ReassemblyMap;
+
+  std::vector<GateControlEntry> m_gateControlList;
+  Time m_gateCycleTime;
+  uint8_t m_gatesAlwaysOpen;
+  Time m_gateBaseTime;
+  uint32_t m_trafficClassQueueLimit;
+  std::deque<PendingFrame> m_trafficClassQueues[N_TRAFFIC_CLASSES];
+  bool m_scheduling;
+  bool m_transmitting;
+  Time m_lastTxEnd;
+  Time m_interframeGap;
+  Time m_txInterframeGap;
+  bool m_accurateFraming;
+  uint32_t m_framingOverhead;
+  EventId m_gateEvent;
+
+  uint8_t m_expressClasses;
+  uint32_t m_fragmentSize;
+  uint8_t m_fragmentSequence;
+  uint8_t m_fragmentIndex;
+  uint32_t m_fragmentClass;
+  ReassemblyMap m_reassembly[2];
+
+  struct ReceivedFrame
+  {
+    Ptr<const Packet> packet;
+    uint16_t protocol;
+    Address from;
+  };
+
+  struct ReceiveQueue
+  {
+    std::deque<ReceivedFrame> frames;
+    double serviceRate;
+    EventId event;
+    NetDevice::ReceiveCallback callback;
+    uint64_t drops;
+  };
+
+  std::vector<ReceiveQueue> m_receiveQueues;
+  double m_receiveServiceRate;
+  uint32_t m_receiveQueueLimit;
+  uint64_t m_nReceivedFrames;
+  uint64_t m_nReceivedBytes;
+  Ptr<EthernetEcmpGroup> m_rssHash;
+  TracedCallback<Ptr<const Packet>, uint32_t> m_rxQueueDropTrace;
+
+  struct VirtualFunctionSlot
+  {
+    Mac48Address address;
+    int32_t index;
+  };
+
+  std::vector<Ptr<EthernetVirtualFunction> > m_virtualFunctions;
+  /**
+   * Open-addressed with linear probing, a power of two at least twice the
+   * number of virtual functions, empty slots have index -1.
+   */
+  std::vector<VirtualFunctionSlot> m_virtualFunctionTable;
+  uint32_t m_nextVirtualFunction;
 
   ProxyTracedCallback m_macTxTrace;
   ProxyTracedCallback m_macTxDropTrace;
@@ -214,6 +950,7 @@ private:
   ProxyTracedCallback m_phyTxDropTrace;
   ProxyTracedCallback m_phyRxEndTrace;
   ProxyTracedCallback m_phyRxDropTrace;
+  ProxyTracedCallback m_snifferTrace;
   ProxyTracedCallback m_promiscSnifferTrace;
   
   TracedCallback<> m_linkChangeCallbacks;
@@ -0,0 +1,430 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ns3/net-device.h"
+#include "ns3/mac48-address.h"
+#include "ns3/string.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/trace-source-accessor.h"
+#include "ethernet-pcap-replay.h"
+
+NS_LOG_COMPONENT_DEFINE ("EthernetPcapReplay");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (EthernetPcapReplay);
+
+static const uint32_t PCAP_MAGIC = 0xa1b2c3d4;
+static const uint32_t PCAP_MAGIC_SWAPPED = 0xd4c3b2a1;
+static const uint32_t PCAP_NSEC_MAGIC = 0xa1b23c4d;
+static const uint32_t PCAP_NSEC_MAGIC_SWAPPED = 0x4d3cb2a1;
+static const uint32_t PCAP_FILE_HEADER_SIZE = 24;
+static const uint32_t PCAP_RECORD_HEADER_SIZE = 16;
+static const uint32_t PCAP_DLT_EN10MB = 1;
+//
+// The upper bits of the link type field may announce a frame check
+// sequence at the end of every frame: bit 26 says the FCS length field is
+// valid, bits 28-31 hold that length in 16-bit words.
+//
+static const uint32_t PCAP_LINKTYPE_MASK = 0x0000ffff;
+static const uint32_t PCAP_FCS_PRESENT = 0x04000000;
+static const uint32_t PCAP_FCS_SHIFT = 28;
+static const uint16_t ETHERTYPE_IPV4 = 0x0800;
+static const uint16_t ETHERTYPE_IPV6 = 0x86dd;
+
+TypeId
+EthernetPcapReplay::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetPcapReplay")
+    .SetParent<Application> ()
+    .AddConstructor<EthernetPcapReplay> ()
+    .AddAttribute ("Filename",
+                   "The pcap file to replay.",
+                   StringValue (""),
+                   MakeStringAccessor (&EthernetPcapReplay::m_filename),
+                   MakeStringChecker ())
+    .AddAttribute ("TimeScale",
+                   "Factor applied to the recorded inter-arrival times "
+                   "(0.5 replays twice as fast, 0 sends back to back).",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&EthernetPcapReplay::m_timeScale),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("ChunkSize",
+                   "The number of bytes of the file mapped at a time.",
+                   UintegerValue (64 << 20),
+                   MakeUintegerAccessor (&EthernetPcapReplay::m_chunkSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddTraceSource ("Tx",
+                     "A frame payload is being handed to the device",
+                     MakeTraceSourceAccessor (&EthernetPcapReplay::m_txTrace))
+    ;
+  return tid;
+}
+
+EthernetPcapReplay::EthernetPcapReplay ()
+  : m_fd (-1),
+    m_fileSize (0),
+    m_window (0),
+    m_windowOffset (0),
+    m_windowSize (0),
+    m_swapped (false),
+    m_nanoseconds (false),
+    m_snapLen (0),
+    m_fcsLength (0),
+    m_offset (0),
+    m_frameSize (0),
+    m_originalSize (0),
+    m_frameTime (0),
+    m_firstTime (0),
+    m_nFrames (0)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+EthernetPcapReplay::~EthernetPcapReplay ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+EthernetPcapReplay::DoDispose (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  CloseFile ();
+  m_device = 0;
+  Application::DoDispose ();
+}
+
+void
+EthernetPcapReplay::SetDevice (Ptr<NetDevice> device)
+{
+  NS_LOG_FUNCTION (device);
+  NS_ASSERT_MSG (device->SupportsSendFrom (), "EthernetPcapReplay::SetDevice(): device does not support SendFrom");
+  m_device = device;
+}
+
+Ptr<NetDevice>
+EthernetPcapReplay::GetDevice (void) const
+{
+  return m_device;
+}
+
+void
+EthernetPcapReplay::StartApplication (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  NS_ABORT_MSG_IF (m_device == 0, "EthernetPcapReplay::StartApplication(): no device set");
+
+  if (!OpenFile ())
+    {
+      return;
+    }
+
+  m_replayStart = Simulator::Now ();
+  if (ReadRecordHeader ())
+    {
+      m_firstTime = m_frameTime;
+      ScheduleNext ();
+    }
+}
+
+void
+EthernetPcapReplay::StopApplication (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  Simulator::Cancel (m_sendEvent);
+  NS_LOG_INFO ("Replayed " << m_nFrames << " frames from " << m_filename);
+  CloseFile ();
+}
+
+bool
+EthernetPcapReplay::OpenFile (void)
+{
+  NS_LOG_FUNCTION (m_filename);
+
+  m_fd = open (m_filename.c_str (), O_RDONLY);
+  NS_ABORT_MSG_IF (m_fd < 0, "EthernetPcapReplay::OpenFile(): cannot open " << m_filename << ": " << strerror (errno));
+
+  struct stat st;
+  NS_ABORT_MSG_IF (fstat (m_fd, &st) < 0, "EthernetPcapReplay::OpenFile(): cannot stat " << m_filename);
+  m_fileSize = st.st_size;
+
+  const uint8_t *header = Map (0, PCAP_FILE_HEADER_SIZE);
+  NS_ABORT_MSG_IF (header == 0, "EthernetPcapReplay::OpenFile(): " << m_filename << " is too short");
+
+  uint32_t magic;
+  memcpy (&magic, header, 4);
+  switch (magic)
+    {
+    case PCAP_MAGIC:
+      m_swapped = false;
+      m_nanoseconds = false;
+      break;
+    case PCAP_MAGIC_SWAPPED:
+      m_swapped = true;
+      m_nanoseconds = false;
+      break;
+    case PCAP_NSEC_MAGIC:
+      m_swapped = false;
+      m_nanoseconds = true;
+      break;
+    case PCAP_NSEC_MAGIC_SWAPPED:
+      m_swapped = true;
+      m_nanoseconds = true;
+      break;
+    default:
+      NS_FATAL_ERROR ("EthernetPcapReplay::OpenFile(): " << m_filename << " is not a pcap file");
+      break;
+    }
+
+  uint32_t snapLen;
+  memcpy (&snapLen, header + 16, 4);
+  m_snapLen = ToHost (snapLen);
+
+  uint32_t network;
+  memcpy (&network, header + 20, 4);
+  network = ToHost (network);
+  NS_ABORT_MSG_IF ((network & PCAP_LINKTYPE_MASK) != PCAP_DLT_EN10MB,
+                   "EthernetPcapReplay::OpenFile(): " << m_filename << " is not an Ethernet capture");
+  m_fcsLength = (network & PCAP_FCS_PRESENT) ? (network >> PCAP_FCS_SHIFT) * 2 : 0;
+  NS_LOG_LOGIC ("Snaplen " << m_snapLen << ", FCS length " << m_fcsLength);
+
+  m_offset = PCAP_FILE_HEADER_SIZE;
+  m_nFrames = 0;
+  return true;
+}
+
+void
+EthernetPcapReplay::CloseFile (void)
+{
+  if (m_window != 0)
+    {
+      munmap (const_cast<uint8_t *> (m_window), m_windowSize);
+      m_window = 0;
+      m_windowSize = 0;
+    }
+  if (m_fd >= 0)
+    {
+      close (m_fd);
+      m_fd = -1;
+    }
+}
+
+const uint8_t *
+EthernetPcapReplay::Map (uint64_t offset, uint32_t size)
+{
+  if (offset + size > m_fileSize)
+    {
+      return 0;
+    }
+  if (m_window != 0 && offset >= m_windowOffset && offset + size <= m_windowOffset + m_windowSize)
+    {
+      return m_window + (offset - m_windowOffset);
+    }
+
+  if (m_window != 0)
+    {
+      munmap (const_cast<uint8_t *> (m_window), m_windowSize);
+      m_window = 0;
+    }
+
+  //
+  // Map a new window starting at the page holding offset.  It is at least
+  // one chunk long, and long enough for the requested range.
+  //
+  uint64_t pageSize = sysconf (_SC_PAGESIZE);
+  m_windowOffset = offset - offset % pageSize;
+  m_windowSize = std::max<uint64_t> (m_chunkSize, offset + size - m_windowOffset);
+  m_windowSize = std::min<uint64_t> (m_windowSize, m_fileSize - m_windowOffset);
+
+  NS_LOG_LOGIC ("Mapping " << m_windowSize << " bytes at offset " << m_windowOffset);
+
+  void *window = mmap (0, m_windowSize, PROT_READ, MAP_PRIVATE, m_fd, m_windowOffset);
+  NS_ABORT_MSG_IF (window == MAP_FAILED, "EthernetPcapReplay::Map(): mmap failed: " << strerror (errno));
+  madvise (window, m_windowSize, MADV_SEQUENTIAL);
+
+  m_window = static_cast<const uint8_t *> (window);
+  return m_window + (offset - m_windowOffset);
+}
+
+uint32_t
+EthernetPcapReplay::ToHost (uint32_t v) const
+{
+  if (!m_swapped)
+    {
+      return v;
+    }
+  return ((v & 0xff) << 24) | ((v & 0xff00) << 8) | ((v >> 8) & 0xff00) | (v >> 24);
+}
+
+bool
+EthernetPcapReplay::ReadRecordHeader (void)
+{
+  const uint8_t *record = Map (m_offset, PCAP_RECORD_HEADER_SIZE);
+  if (record == 0)
+    {
+      return false;
+    }
+
+  uint32_t fields[4];
+  memcpy (fields, record, PCAP_RECORD_HEADER_SIZE);
+  uint64_t seconds = ToHost (fields[0]);
+  uint64_t fraction = ToHost (fields[1]);
+  m_frameSize = ToHost (fields[2]);
+  m_originalSize = ToHost (fields[3]);
+  m_frameTime = seconds * 1000000000 + (m_nanoseconds ? fraction : fraction * 1000);
+  return true;
+}
+
+uint32_t
+EthernetPcapReplay::TrimPadding (const uint8_t *payload, uint32_t size, uint16_t protocol) const
+{
+  //
+  // Frames shorter than the Ethernet minimum were padded on the wire, and
+  // captures without the FCS annotation may still carry it; the IP length
+  // tells where the datagram really ends.
+  //
+  uint32_t length = size;
+  if (protocol == ETHERTYPE_IPV4 && size >= 20 && (payload[0] >> 4) == 4)
+    {
+      length = (payload[2] << 8) | payload[3];
+    }
+  else if (protocol == ETHERTYPE_IPV6 && size >= 40 && (payload[0] >> 4) == 6)
+    {
+      length = 40 + ((payload[4] << 8) | payload[5]);
+    }
+  if (length < size)
+    {
+      NS_LOG_LOGIC ("Trimming " << size - length << " trailing bytes at offset " << m_offset);
+      return length;
+    }
+  return size;
+}
+
+void
+EthernetPcapReplay::ScheduleNext (void)
+{
+  //
+  // Captures are not always monotonic; a frame recorded before its
+  // predecessor is sent right away.
+  //
+  Time delay = Seconds (0);
+  if (m_frameTime > m_firstTime)
+    {
+      Time at = m_replayStart + NanoSeconds (static_cast<uint64_t> ((m_frameTime - m_firstTime) * m_timeScale));
+      if (at > Simulator::Now ())
+        {
+          delay = at - Simulator::Now ();
+        }
+    }
+  m_sendEvent = Simulator::Schedule (delay, &EthernetPcapReplay::SendFrame, this);
+}
+
+void
+EthernetPcapReplay::SendFrame (void)
+{
+  const uint8_t *frame = Map (m_offset + PCAP_RECORD_HEADER_SIZE, m_frameSize);
+  if (frame == 0)
+    {
+      NS_LOG_WARN ("Truncated record at offset " << m_offset << " in " << m_filename);
+      return;
+    }
+
+  //
+  // The FCS is only in the record when the capture kept the whole frame;
+  // a frame cut short by the snaplen lost it along with its tail.
+  //
+  uint32_t frameSize = m_frameSize;
+  bool truncated = m_frameSize < m_originalSize || (m_snapLen != 0 && m_originalSize > m_snapLen);
+  if (m_fcsLength != 0 && !truncated && frameSize >= 14 + m_fcsLength)
+    {
+      frameSize -= m_fcsLength;
+    }
+
+  if (frameSize >= 14)
+    {
+      Mac48Address destination;
+      Mac48Address source;
+      destination.CopyFrom (frame);
+      source.CopyFrom (frame + 6);
+      uint16_t protocol = (frame[12] << 8) | frame[13];
+      uint32_t headerSize = 14;
+      uint32_t payloadSize = frameSize - headerSize;
+
+      //
+      // A length interpretation of the field means an IEEE 802.2 frame;
+      // only LLC/SNAP carries a protocol number we can send with.
+      //
+      if (protocol <= 1500)
+        {
+          if (frameSize >= 22 && frame[14] == 0xaa && frame[15] == 0xaa && frame[16] == 0x03)
+            {
+              uint32_t length = std::min<uint32_t> (protocol, payloadSize);
+              payloadSize = length > 8 ? length - 8 : 0;
+              protocol = (frame[20] << 8) | frame[21];
+              headerSize = 22;
+            }
+          else
+            {
+              NS_LOG_LOGIC ("Skipping non-SNAP 802.2 frame at offset " << m_offset);
+              payloadSize = 0;
+              headerSize = 0;
+            }
+        }
+
+      if (headerSize != 0 && !truncated)
+        {
+          payloadSize = TrimPadding (frame + headerSize, payloadSize, protocol);
+        }
+
+      if (headerSize != 0)
+        {
+          Ptr<Packet> packet = Create<Packet> (frame + headerSize, payloadSize);
+          m_txTrace (packet);
+          m_device->SendFrom (packet, source, destination, protocol);
+          ++m_nFrames;
+        }
+    }
+
+  m_offset += PCAP_RECORD_HEADER_SIZE + m_frameSize;
+  if (ReadRecordHeader ())
+    {
+      ScheduleNext ();
+    }
+  else
+    {
+      NS_LOG_INFO ("End of " << m_filename << " after " << m_nFrames << " frames");
+    }
+}
+
+} // namespace ns3
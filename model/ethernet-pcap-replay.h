@@ -0,0 +1,135 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_PCAP_REPLAY_H
+#define ETHERNET_PCAP_REPLAY_H
+
+#include <string>
+#include "ns3/application.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+#include "ns3/packet.h"
+#include "ns3/traced-callback.h"
+
+namespace ns3 {
+
+class NetDevice;
+
+/**
+ * \brief Replay the frames of a pcap file through a net device.
+ *
+ * The file must be an Ethernet (DLT_EN10MB) capture, with micro- or
+ * nanosecond timestamps in either byte order.  Each frame is split into
+ * its source, destination and protocol and handed to NetDevice::SendFrom
+ * at its recorded time, relative to the first frame and to the application
+ * start, multiplied by the TimeScale attribute.  LLC/SNAP frames are
+ * unwrapped; frames truncated by the capture snaplen are sent as captured.
+ * The FCS is dropped when the link type field announces one, and IPv4 and
+ * IPv6 payloads are cut to their IP length, so neither the FCS nor the
+ * padding of short frames is replayed as data.
+ *
+ * The file is never read into memory: it is memory-mapped one window of
+ * ChunkSize bytes at a time, and only one replay event is pending at any
+ * time, so multi-gigabyte captures cost no more than small ones.
+ */
+class EthernetPcapReplay : public Application
+{
+public:
+  static TypeId GetTypeId (void);
+
+  EthernetPcapReplay ();
+  virtual ~EthernetPcapReplay ();
+
+  /**
+   * Set the device frames are injected into.  It must support SendFrom.
+   *
+   * @param device the device to send the frames from
+   */
+  void SetDevice (Ptr<NetDevice> device);
+  /**
+   * @return the device frames are injected into
+   */
+  Ptr<NetDevice> GetDevice (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+  bool OpenFile (void);
+  void CloseFile (void);
+  /**
+   * Make sure bytes [offset, offset + size) of the file are mapped.
+   *
+   * @return pointer to the byte at offset, or 0 if the file is shorter
+   */
+  const uint8_t *Map (uint64_t offset, uint32_t size);
+  uint32_t ToHost (uint32_t v) const;
+  /**
+   * Read the record header at m_offset.
+   *
+   * @return false at the end of the file
+   */
+  bool ReadRecordHeader (void);
+  /**
+   * @param payload the frame payload, after the Ethernet or SNAP header
+   * @param size the number of payload bytes captured
+   * @param protocol the protocol number of the payload
+   *
+   * @return size cut to the IP length of the payload, if it is shorter
+   */
+  uint32_t TrimPadding (const uint8_t *payload, uint32_t size, uint16_t protocol) const;
+  void ScheduleNext (void);
+  void SendFrame (void);
+
+  Ptr<NetDevice> m_device;
+  std::string m_filename;
+  double m_timeScale;
+  uint32_t m_chunkSize;
+
+  int m_fd;
+  uint64_t m_fileSize;
+  const uint8_t *m_window;
+  uint64_t m_windowOffset;
+  uint64_t m_windowSize;
+  bool m_swapped;
+  bool m_nanoseconds;
+  uint32_t m_snapLen;
+  uint32_t m_fcsLength;
+
+  uint64_t m_offset;
+  uint32_t m_frameSize;
+  uint32_t m_originalSize;
+  uint64_t m_frameTime;
+  uint64_t m_firstTime;
+  Time m_replayStart;
+
+  EventId m_sendEvent;
+  uint64_t m_nFrames;
+
+  TracedCallback<Ptr<const Packet> > m_txTrace;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_PCAP_REPLAY_H */
@@ -0,0 +1,313 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include <iostream>
+#include <iomanip>
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/boolean.h"
+#include "ns3/global-value.h"
+#include "ethernet-profiler.h"
+
+NS_LOG_COMPONENT_DEFINE ("EthernetProfiler");
+
+namespace ns3 {
+
+static GlobalValue g_ethernetProfiling ("EthernetProfiling",
+                                        "Account the wall-clock time of the internal operations of the "
+                                        "ethernet devices, and print it when the simulator is destroyed",
+                                        BooleanValue (false),
+                                        MakeBooleanChecker ());
+
+bool EthernetProfiler::m_initialized = false;
+bool EthernetProfiler::m_enabled = false;
+bool EthernetProfiler::m_reportScheduled = false;
+EthernetProfiler::Scope *EthernetProfiler::m_current = 0;
+uint64_t EthernetProfiler::m_calls[EthernetProfiler::N_OPERATIONS];
+uint64_t EthernetProfiler::m_cycles[EthernetProfiler::N_OPERATIONS];
+uint64_t EthernetProfiler::m_startCycles = 0;
+uint64_t EthernetProfiler::m_startTime = 0;
+
+static const char *g_operationNames[EthernetProfiler::N_OPERATIONS] = {
+  "send",
+  "transmit start",
+  "transmit complete",
+  "receive",
+  "deliver",
+  "trace dispatch",
+  "error model"
+};
+
+void
+EthernetProfiler::Initialize (void)
+{
+  if (m_initialized)
+    {
+      return;
+    }
+  m_initialized = true;
+  BooleanValue enabled;
+  g_ethernetProfiling.GetValue (enabled);
+  if (enabled.Get ())
+    {
+      Enable ();
+    }
+}
+
+void
+EthernetProfiler::Enable (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  if (m_enabled)
+    {
+      return;
+    }
+  m_initialized = true;
+  m_enabled = true;
+  Reset ();
+  //
+  // Enabled again after Disable, the profiler keeps the report already
+  // scheduled.
+  //
+  if (!m_reportScheduled)
+    {
+      m_reportScheduled = true;
+      Simulator::ScheduleDestroy (&EthernetProfiler::Report);
+    }
+}
+
+void
+EthernetProfiler::Disable (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_enabled = false;
+}
+
+void
+EthernetProfiler::Reset (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  for (uint32_t i = 0; i < N_OPERATIONS; ++i)
+    {
+      m_calls[i] = 0;
+      m_cycles[i] = 0;
+    }
+  m_startTime = ReadNanoSeconds ();
+  m_startCycles = ReadCycles ();
+}
+
+uint64_t
+EthernetProfiler::GetNCalls (enum Operation op)
+{
+  return m_calls[op];
+}
+
+uint64_t
+EthernetProfiler::GetCycles (enum Operation op)
+{
+  return m_cycles[op];
+}
+
+double
+EthernetProfiler::GetSeconds (enum Operation op)
+{
+  //
+  // The time stamp counter ticks at a constant rate on the processors worth
+  // profiling on, which is calibrated against the monotonic clock over the
+  // whole profiling run.
+  //
+  uint64_t time = ReadNanoSeconds () - m_startTime;
+  uint64_t cycles = ReadCycles () - m_startCycles;
+  if (time == 0 || cycles == 0)
+    {
+      return 0;
+    }
+  return m_cycles[op] * (time / static_cast<double> (cycles)) * 1e-9;
+}
+
+void
+EthernetProfiler::Print (std::ostream &os)
+{
+  double total = (ReadNanoSeconds () - m_startTime) * 1e-9;
+  double profiled = 0;
+
+  std::ios::fmtflags flags = os.flags ();
+  os << "Ethernet profile over " << std::fixed << std::setprecision (3) << total
+     << " s of wall-clock time" << std::endl;
+  os << std::left << std::setw (20) << "operation" << std::right
+     << std::setw (14) << "calls"
+     << std::setw (14) << "time (ms)"
+     << std::setw (12) << "ns/call"
+     << std::setw (9) << "share" << std::endl;
+  for (uint32_t i = 0; i < N_OPERATIONS; ++i)
+    {
+      enum Operation op = static_cast<enum Operation> (i);
+      double seconds = GetSeconds (op);
+      profiled += seconds;
+      os << std::left << std::setw (20) << g_operationNames[i] << std::right
+         << std::setw (14) << m_calls[i]
+         << std::setw (14) << std::setprecision (3) << seconds * 1e3
+         << std::setw (12) << std::setprecision (1) << (m_calls[i] ? seconds * 1e9 / m_calls[i] : 0.0)
+         << std::setw (8) << std::setprecision (1) << (total > 0 ? 100 * seconds / total : 0.0) << "%"
+         << std::endl;
+    }
+  double other = total > profiled ? total - profiled : 0;
+  os << std::left << std::setw (20) << "other" << std::right
+     << std::setw (14) << ""
+     << std::setw (14) << std::setprecision (3) << other * 1e3
+     << std::setw (12) << ""
+     << std::setw (8) << std::setprecision (1) << (total > 0 ? 100 * other / total : 0.0) << "%"
+     << std::endl;
+  os.flags (flags);
+}
+
+void
+EthernetProfiler::Report (void)
+{
+  Print (std::clog);
+  m_enabled = false;
+  m_initialized = false;
+  m_reportScheduled = false;
+}
+
+uint64_t
+EthernetProfiler::ReadNanoSeconds (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t> (ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void
+EthernetProfiler::Scope::Stop (void)
+{
+  uint64_t elapsed = ReadCycles () - m_start;
+  m_cycles[m_op] += elapsed - m_nested;
+  ++m_calls[m_op];
+  m_current = m_parent;
+  if (m_parent != 0)
+    {
+      m_parent->m_nested += elapsed;
+    }
+}
+
+EthernetProfiledSink::EthernetProfiledSink (const CallbackBase &sink)
+  : m_hasContext (false)
+{
+  m_sink.Assign (sink);
+}
+
+EthernetProfiledSink::EthernetProfiledSink (const CallbackBase &sink, std::string context)
+  : m_hasContext (true),
+    m_context (context)
+{
+  m_contextSink.Assign (sink);
+}
+
+bool
+EthernetProfiledSink::IsProfiling (const CallbackBase &sink, bool hasContext, std::string context) const
+{
+  if (hasContext != m_hasContext)
+    {
+      return false;
+    }
+  if (m_hasContext)
+    {
+      return context == m_context && m_contextSink.IsEqual (sink);
+    }
+  return m_sink.IsEqual (sink);
+}
+
+CallbackBase
+EthernetProfiledSink::GetSink (void)
+{
+  if (m_hasContext)
+    {
+      return MakeCallback (&EthernetProfiledSink::DispatchWithContext, Ptr<EthernetProfiledSink> (this));
+    }
+  return MakeCallback (&EthernetProfiledSink::Dispatch, Ptr<EthernetProfiledSink> (this));
+}
+
+void
+EthernetProfiledSink::Dispatch (Ptr<const Packet> packet)
+{
+  ETHERNET_PROFILE (TRACE_DISPATCH);
+  m_sink (packet);
+}
+
+void
+EthernetProfiledSink::DispatchWithContext (std::string context, Ptr<const Packet> packet)
+{
+  ETHERNET_PROFILE (TRACE_DISPATCH);
+  m_contextSink (context, packet);
+}
+
+NS_OBJECT_ENSURE_REGISTERED (EthernetProfiledErrorModel);
+
+TypeId
+EthernetProfiledErrorModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetProfiledErrorModel")
+    .SetParent<ErrorModel> ()
+    .AddConstructor<EthernetProfiledErrorModel> ()
+    ;
+  return tid;
+}
+
+EthernetProfiledErrorModel::EthernetProfiledErrorModel ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+EthernetProfiledErrorModel::~EthernetProfiledErrorModel ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+EthernetProfiledErrorModel::DoDispose (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_model = 0;
+  ErrorModel::DoDispose ();
+}
+
+void
+EthernetProfiledErrorModel::SetErrorModel (Ptr<ErrorModel> model)
+{
+  NS_LOG_FUNCTION (model);
+  m_model = model;
+}
+
+bool
+EthernetProfiledErrorModel::DoCorrupt (Ptr<Packet> p)
+{
+  ETHERNET_PROFILE (ERROR_MODEL);
+  return m_model->IsCorrupt (p);
+}
+
+void
+EthernetProfiledErrorModel::DoReset (void)
+{
+  m_model->Reset ();
+}
+
+} // namespace ns3
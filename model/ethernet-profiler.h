@@ -0,0 +1,267 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_PROFILER_H
+#define ETHERNET_PROFILER_H
+
+#include <stdint.h>
+#include <time.h>
+#include <ostream>
+#include <string>
+#include "ns3/ptr.h"
+#include "ns3/packet.h"
+#include "ns3/callback.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/error-model.h"
+
+namespace ns3 {
+
+/**
+ * \brief Wall-clock accounting of the internal operations of the ethernet
+ * module.
+ *
+ * When enabled, the devices count the calls of each operation and the
+ * processor cycles spent in it, read from the time stamp counter where the
+ * processor has one and from the monotonic clock otherwise.  The time of
+ * an operation nested in another one, like a trace sink fired while
+ * sending, is only accounted to the inner one.  The work the inner
+ * CsmaNetDevice does in its own events, outside any callback of the
+ * module, is left to the simulator.
+ *
+ * Profiling is off by default.  Set the EthernetProfiling global value,
+ * e.g. with --EthernetProfiling=1 on the command line, or call Enable,
+ * before creating the devices and connecting their trace sinks.  The
+ * accounting is printed to std::clog when the simulator is destroyed.
+ */
+class EthernetProfiler
+{
+public:
+  enum Operation
+    {
+      SEND,               /**< Send and SendFrom, up to the transmit path */
+      TRANSMIT_START,     /**< handing a frame to the transmit device */
+      TRANSMIT_COMPLETE,  /**< the work of the device when a transmission ends */
+      RECEIVE,            /**< the receive path, up to the upper layers */
+      DELIVER,            /**< the receive callbacks of the upper layers */
+      TRACE_DISPATCH,     /**< the trace sinks connected to the device */
+      ERROR_MODEL,        /**< the receive error model */
+      N_OPERATIONS
+    };
+
+  /**
+   * Enable profiling if the EthernetProfiling global value is set.  Only
+   * the first call after the simulator is destroyed reads it.
+   */
+  static void Initialize (void);
+  /**
+   * Start profiling now, and print the accounting when the simulator is
+   * destroyed.
+   */
+  static void Enable (void);
+  /**
+   * Stop profiling.  The accounting is kept.
+   */
+  static void Disable (void);
+  /**
+   * @return true if profiling is enabled
+   */
+  static bool IsEnabled (void);
+  /**
+   * Clear the accounting and restart the wall clock.
+   */
+  static void Reset (void);
+  /**
+   * @param op an operation
+   * @return the number of calls of the operation
+   */
+  static uint64_t GetNCalls (enum Operation op);
+  /**
+   * @param op an operation
+   * @return the cycles spent in the operation
+   */
+  static uint64_t GetCycles (enum Operation op);
+  /**
+   * @param op an operation
+   * @return the wall-clock time spent in the operation, in seconds
+   */
+  static double GetSeconds (enum Operation op);
+  /**
+   * Print the calls and the time of every operation, and their share of
+   * the wall-clock time since profiling started.
+   *
+   * @param os the stream to print to
+   */
+  static void Print (std::ostream &os);
+  /**
+   * @return the current value of the cycle counter
+   */
+  static uint64_t ReadCycles (void);
+
+  /**
+   * \brief Account the lifetime of the object to an operation.
+   */
+  class Scope
+  {
+  public:
+    Scope (enum Operation op);
+    ~Scope ();
+  private:
+    Scope (const Scope &o);
+    Scope &operator = (const Scope &o);
+    void Stop (void);
+
+    enum Operation m_op;
+    bool m_active;
+    Scope *m_parent;
+    uint64_t m_start;
+    uint64_t m_nested;
+  };
+
+private:
+  static void Report (void);
+  static uint64_t ReadNanoSeconds (void);
+
+  static bool m_initialized;
+  static bool m_enabled;
+  static bool m_reportScheduled;
+  static Scope *m_current;
+  static uint64_t m_calls[N_OPERATIONS];
+  static uint64_t m_cycles[N_OPERATIONS];
+  static uint64_t m_startCycles;
+  static uint64_t m_startTime;
+};
+
+/**
+ * Account the rest of the enclosing block to an EthernetProfiler
+ * operation, e.g. ETHERNET_PROFILE (SEND).
+ */
+#define ETHERNET_PROFILE(op) \
+  ns3::EthernetProfiler::Scope ethernetProfilerScope (ns3::EthernetProfiler::op)
+
+/**
+ * \brief A trace sink standing for another one, whose time it accounts to
+ * EthernetProfiler::TRACE_DISPATCH.
+ */
+class EthernetProfiledSink : public SimpleRefCount<EthernetProfiledSink>
+{
+public:
+  /**
+   * @param sink the sink to stand for, which takes a packet
+   */
+  EthernetProfiledSink (const CallbackBase &sink);
+  /**
+   * @param sink the sink to stand for, which takes a context and a packet
+   * @param context the context it is connected with
+   */
+  EthernetProfiledSink (const CallbackBase &sink, std::string context);
+
+  /**
+   * @param sink a sink
+   * @param hasContext whether the sink takes a context
+   * @param context the context it is connected with, if it takes one
+   * @return true if this object stands for sink
+   */
+  bool IsProfiling (const CallbackBase &sink, bool hasContext, std::string context) const;
+  /**
+   * @return the sink to connect in place of the profiled one
+   */
+  CallbackBase GetSink (void);
+
+private:
+  void Dispatch (Ptr<const Packet> packet);
+  void DispatchWithContext (std::string context, Ptr<const Packet> packet);
+
+  Callback<void, Ptr<const Packet> > m_sink;
+  Callback<void, std::string, Ptr<const Packet> > m_contextSink;
+  bool m_hasContext;
+  std::string m_context;
+};
+
+/**
+ * \brief An error model standing for another one, whose time it accounts
+ * to EthernetProfiler::ERROR_MODEL.
+ */
+class EthernetProfiledErrorModel : public ErrorModel
+{
+public:
+  static TypeId GetTypeId (void);
+
+  EthernetProfiledErrorModel ();
+  virtual ~EthernetProfiledErrorModel ();
+
+  /**
+   * @param model the error model to stand for
+   */
+  void SetErrorModel (Ptr<ErrorModel> model);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  virtual bool DoCorrupt (Ptr<Packet> p);
+  virtual void DoReset (void);
+
+  Ptr<ErrorModel> m_model;
+};
+
+inline bool
+EthernetProfiler::IsEnabled (void)
+{
+  return m_enabled;
+}
+
+inline uint64_t
+EthernetProfiler::ReadCycles (void)
+{
+#if defined (__i386__) || defined (__x86_64__)
+  uint32_t lo, hi;
+  __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+  return (static_cast<uint64_t> (hi) << 32) | lo;
+#else
+  return ReadNanoSeconds ();
+#endif
+}
+
+inline
+EthernetProfiler::Scope::Scope (enum Operation op)
+  : m_op (op),
+    m_active (m_enabled)
+{
+  if (m_active)
+    {
+      m_parent = m_current;
+      m_current = this;
+      m_nested = 0;
+      m_start = ReadCycles ();
+    }
+}
+
+inline
+EthernetProfiler::Scope::~Scope ()
+{
+  if (m_active)
+    {
+      Stop ();
+    }
+}
+
+} // namespace ns3
+
+#endif /* ETHERNET_PROFILER_H */
@@ -0,0 +1,333 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include <fstream>
+
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ns3/queue.h"
+#include "ns3/uinteger.h"
+#include "ns3/enum.h"
+#include "ns3/string.h"
+#include "ethernet-queue-sampler.h"
+
+NS_LOG_COMPONENT_DEFINE ("EthernetQueueSampler");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (EthernetQueueSampler);
+
+TypeId
+EthernetQueueSampler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetQueueSampler")
+    .SetParent<Object> ()
+    .AddConstructor<EthernetQueueSampler> ()
+    .AddAttribute ("Interval",
+                   "The time between samples.  Zero samples on every enqueue and dequeue.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&EthernetQueueSampler::m_interval),
+                   MakeTimeChecker ())
+    .AddAttribute ("Capacity",
+                   "The number of samples kept in memory.",
+                   UintegerValue (65536),
+                   MakeUintegerAccessor (&EthernetQueueSampler::m_capacity),
+                   MakeUintegerChecker<uint32_t> (2))
+    .AddAttribute ("Overflow",
+                   "What to do when the buffer is full.",
+                   EnumValue (DOWNSAMPLE),
+                   MakeEnumAccessor (&EthernetQueueSampler::m_overflow),
+                   MakeEnumChecker (DOWNSAMPLE, "Downsample",
+                                    OVERWRITE, "Overwrite"))
+    .AddAttribute ("Filename",
+                   "The file Flush appends the samples to.",
+                   StringValue ("queue-samples.eqs"),
+                   MakeStringAccessor (&EthernetQueueSampler::m_filename),
+                   MakeStringChecker ())
+    ;
+  return tid;
+}
+
+EthernetQueueSampler::EthernetQueueSampler ()
+  : m_running (false),
+    m_head (0),
+    m_size (0),
+    m_stride (1),
+    m_nPending (0),
+    m_enqueuePending (false),
+    m_headerWritten (false)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+EthernetQueueSampler::~EthernetQueueSampler ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+EthernetQueueSampler::DoDispose (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  Stop ();
+  m_queue = 0;
+  m_enqueuePacket = 0;
+  Object::DoDispose ();
+}
+
+void
+EthernetQueueSampler::SetQueue (Ptr<Queue> queue)
+{
+  NS_LOG_FUNCTION (queue);
+  NS_ABORT_MSG_IF (m_running, "EthernetQueueSampler::SetQueue(): sampler is running");
+  m_queue = queue;
+}
+
+void
+EthernetQueueSampler::Start (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  NS_ABORT_MSG_IF (m_queue == 0, "EthernetQueueSampler::Start(): no queue set");
+  if (m_running)
+    {
+      return;
+    }
+  m_running = true;
+
+  //
+  // The whole buffer is allocated here, sampling itself never allocates.
+  //
+  if (m_samples.size () != m_capacity)
+    {
+      if (m_size)
+        {
+          Flush ();
+        }
+      m_samples.resize (m_capacity);
+    }
+
+  if (m_interval.IsZero ())
+    {
+      m_queue->TraceConnectWithoutContext ("Enqueue", MakeCallback (&EthernetQueueSampler::EnqueueSample, this));
+      m_queue->TraceConnectWithoutContext ("Dequeue", MakeCallback (&EthernetQueueSampler::DequeueSample, this));
+      m_queue->TraceConnectWithoutContext ("Drop", MakeCallback (&EthernetQueueSampler::DropSample, this));
+      Record (Simulator::Now (), m_queue->GetNPackets (), m_queue->GetNBytes ());
+    }
+  else
+    {
+      PeriodicSample ();
+    }
+}
+
+void
+EthernetQueueSampler::Stop (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  if (!m_running)
+    {
+      return;
+    }
+  m_running = false;
+
+  if (m_interval.IsZero ())
+    {
+      m_queue->TraceDisconnectWithoutContext ("Enqueue", MakeCallback (&EthernetQueueSampler::EnqueueSample, this));
+      m_queue->TraceDisconnectWithoutContext ("Dequeue", MakeCallback (&EthernetQueueSampler::DequeueSample, this));
+      m_queue->TraceDisconnectWithoutContext ("Drop", MakeCallback (&EthernetQueueSampler::DropSample, this));
+      CommitEnqueueSample ();
+    }
+  else
+    {
+      Simulator::Cancel (m_sampleEvent);
+    }
+}
+
+uint32_t
+EthernetQueueSampler::GetNSamples (void) const
+{
+  return m_size;
+}
+
+void
+EthernetQueueSampler::PeriodicSample (void)
+{
+  Record (Simulator::Now (), m_queue->GetNPackets (), m_queue->GetNBytes ());
+  m_sampleEvent = Simulator::Schedule (m_interval, &EthernetQueueSampler::PeriodicSample, this);
+}
+
+void
+EthernetQueueSampler::EnqueueSample (Ptr<const Packet> packet)
+{
+  //
+  // Queue fires its Enqueue trace before counting the packet in, and
+  // before it decides to drop it.  The sample is held back until the next
+  // trace, and forgotten if that is the Drop of this packet.
+  //
+  CommitEnqueueSample ();
+  m_enqueueSample.time = Simulator::Now ().GetNanoSeconds ();
+  m_enqueueSample.packets = m_queue->GetNPackets () + 1;
+  m_enqueueSample.bytes = m_queue->GetNBytes () + packet->GetSize ();
+  m_enqueuePacket = packet;
+  m_enqueuePending = true;
+}
+
+void
+EthernetQueueSampler::DequeueSample (Ptr<const Packet> packet)
+{
+  //
+  // Queue fires its Dequeue trace after counting the packet out.
+  //
+  CommitEnqueueSample ();
+  Record (Simulator::Now (), m_queue->GetNPackets (), m_queue->GetNBytes ());
+}
+
+void
+EthernetQueueSampler::DropSample (Ptr<const Packet> packet)
+{
+  if (m_enqueuePending && m_enqueuePacket == packet)
+    {
+      m_enqueuePending = false;
+      m_enqueuePacket = 0;
+    }
+}
+
+void
+EthernetQueueSampler::CommitEnqueueSample (void)
+{
+  if (m_enqueuePending)
+    {
+      m_enqueuePending = false;
+      m_enqueuePacket = 0;
+      Record (NanoSeconds (m_enqueueSample.time), m_enqueueSample.packets, m_enqueueSample.bytes);
+    }
+}
+
+void
+EthernetQueueSampler::Record (Time time, uint32_t packets, uint32_t bytes)
+{
+  //
+  // Once downsampled, a stored sample stands for m_stride consecutive ones;
+  // keep the deepest of them.
+  //
+  if (m_nPending == 0 || bytes > m_pending.bytes)
+    {
+      m_pending.time = time.GetNanoSeconds ();
+      m_pending.packets = packets;
+      m_pending.bytes = bytes;
+    }
+  if (++m_nPending >= m_stride)
+    {
+      Push (m_pending);
+      m_nPending = 0;
+    }
+}
+
+void
+EthernetQueueSampler::Push (const Sample &sample)
+{
+  uint32_t capacity = m_samples.size ();
+  if (m_size == capacity)
+    {
+      if (m_overflow == DOWNSAMPLE)
+        {
+          Downsample ();
+        }
+      else
+        {
+          m_samples[m_head] = sample;
+          m_head = (m_head + 1) % capacity;
+          return;
+        }
+    }
+  m_samples[(m_head + m_size) % capacity] = sample;
+  ++m_size;
+}
+
+void
+EthernetQueueSampler::Downsample (void)
+{
+  NS_LOG_LOGIC ("Downsampling " << m_size << " samples, stride " << m_stride);
+
+  //
+  // Only DOWNSAMPLE fills the buffer, and it never wraps, so m_head is 0.
+  //
+  uint32_t n = m_size / 2;
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      const Sample &a = m_samples[2 * i];
+      const Sample &b = m_samples[2 * i + 1];
+      m_samples[i] = b.bytes > a.bytes ? b : a;
+    }
+  if (m_size % 2)
+    {
+      m_samples[n++] = m_samples[m_size - 1];
+    }
+  m_size = n;
+  m_stride *= 2;
+}
+
+static void
+WriteLittleEndian (std::ofstream &os, uint64_t value, uint32_t size)
+{
+  char buffer[8];
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      buffer[i] = (value >> (8 * i)) & 0xff;
+    }
+  os.write (buffer, size);
+}
+
+void
+EthernetQueueSampler::Flush (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  CommitEnqueueSample ();
+  if (m_nPending)
+    {
+      Push (m_pending);
+      m_nPending = 0;
+    }
+  if (m_size == 0 && m_headerWritten)
+    {
+      return;
+    }
+
+  std::ofstream os (m_filename.c_str (), std::ios::binary | (m_headerWritten ? std::ios::app : std::ios::trunc));
+  NS_ABORT_MSG_UNLESS (os, "EthernetQueueSampler::Flush(): cannot open " << m_filename);
+  if (!m_headerWritten)
+    {
+      os.write ("EQS1", 4);
+      m_headerWritten = true;
+    }
+  for (uint32_t i = 0; i < m_size; ++i)
+    {
+      const Sample &sample = m_samples[(m_head + i) % m_samples.size ()];
+      WriteLittleEndian (os, sample.time, 8);
+      WriteLittleEndian (os, sample.packets, 4);
+      WriteLittleEndian (os, sample.bytes, 4);
+    }
+  m_head = 0;
+  m_size = 0;
+  m_stride = 1;
+}
+
+} // namespace ns3
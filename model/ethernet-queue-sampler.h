@@ -0,0 +1,135 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_QUEUE_SAMPLER_H
+#define ETHERNET_QUEUE_SAMPLER_H
+
+#include <string>
+#include <vector>
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include "ns3/packet.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+
+namespace ns3 {
+
+class Queue;
+
+/**
+ * \brief Record the occupancy of a queue into a fixed-size memory buffer.
+ *
+ * The sampler stores (time, packets, bytes) triples either every Interval
+ * or, when Interval is zero, on every enqueue and dequeue.  The buffer holds
+ * Capacity samples and never grows.  When it is full, the DOWNSAMPLE
+ * overflow policy merges adjacent samples pairwise, keeping the deeper one
+ * so bursts survive, and from then on keeps one sample out of twice as many;
+ * the OVERWRITE policy keeps the most recent Capacity samples.
+ *
+ * Flush appends the buffered samples to Filename in a compact binary format
+ * and empties the buffer.  The file starts with the four bytes "EQS1"
+ * followed by fixed 16-byte records: the time in nanoseconds (64 bits), the
+ * number of packets and the number of bytes (32 bits each), all
+ * little-endian.
+ */
+class EthernetQueueSampler : public Object
+{
+public:
+  enum OverflowPolicy
+    {
+      DOWNSAMPLE,
+      OVERWRITE
+    };
+
+  static TypeId GetTypeId (void);
+
+  EthernetQueueSampler ();
+  virtual ~EthernetQueueSampler ();
+
+  /**
+   * Set the queue to sample.  Must be called before Start.
+   *
+   * @param queue the queue of interest
+   */
+  void SetQueue (Ptr<Queue> queue);
+  /**
+   * Start sampling now.
+   */
+  void Start (void);
+  /**
+   * Stop sampling.  The buffered samples are kept.
+   */
+  void Stop (void);
+  /**
+   * Append the buffered samples to the file and empty the buffer.
+   */
+  void Flush (void);
+  /**
+   * @return the number of samples currently buffered
+   */
+  uint32_t GetNSamples (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  struct Sample
+  {
+    int64_t time;
+    uint32_t packets;
+    uint32_t bytes;
+  };
+
+  void PeriodicSample (void);
+  void EnqueueSample (Ptr<const Packet> packet);
+  void DequeueSample (Ptr<const Packet> packet);
+  void DropSample (Ptr<const Packet> packet);
+  void CommitEnqueueSample (void);
+  void Record (Time time, uint32_t packets, uint32_t bytes);
+  void Push (const Sample &sample);
+  void Downsample (void);
+
+  Ptr<Queue> m_queue;
+  Time m_interval;
+  uint32_t m_capacity;
+  OverflowPolicy m_overflow;
+  std::string m_filename;
+
+  bool m_running;
+  EventId m_sampleEvent;
+
+  std::vector<Sample> m_samples;
+  uint32_t m_head;
+  uint32_t m_size;
+  uint32_t m_stride;
+  uint32_t m_nPending;
+  Sample m_pending;
+  /**
+   * The sample of the last enqueue, until it is known not to be a drop.
+   */
+  bool m_enqueuePending;
+  Sample m_enqueueSample;
+  Ptr<const Packet> m_enqueuePacket;
+  bool m_headerWritten;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_QUEUE_SAMPLER_H */
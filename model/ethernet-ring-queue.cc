@@ -0,0 +1,142 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/uinteger.h"
+#include "ethernet-ring-queue.h"
+
+NS_LOG_COMPONENT_DEFINE ("EthernetRingQueue");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (EthernetRingQueue);
+
+TypeId
+EthernetRingQueue::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetRingQueue")
+    .SetParent<Queue> ()
+    .AddConstructor<EthernetRingQueue> ()
+    .AddAttribute ("MaxPackets",
+                   "The number of descriptors of the ring, rounded up to a power of two.",
+                   UintegerValue (256),
+                   MakeUintegerAccessor (&EthernetRingQueue::SetMaxPackets,
+                                         &EthernetRingQueue::GetMaxPackets),
+                   MakeUintegerChecker<uint32_t> (1, 0x80000000))
+    .AddAttribute ("MaxBytes",
+                   "The number of bytes the queued frames may take, zero for no limit but the descriptors.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&EthernetRingQueue::m_maxBytes),
+                   MakeUintegerChecker<uint32_t> ())
+    ;
+  return tid;
+}
+
+EthernetRingQueue::EthernetRingQueue ()
+  : m_mask (0),
+    m_head (0),
+    m_count (0),
+    m_maxBytes (0)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+EthernetRingQueue::~EthernetRingQueue ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+EthernetRingQueue::SetMaxPackets (uint32_t maxPackets)
+{
+  NS_LOG_FUNCTION (maxPackets);
+  NS_ABORT_MSG_IF (m_count != 0, "EthernetRingQueue::SetMaxPackets(): queue not empty");
+  uint32_t size = 1;
+  while (size < maxPackets)
+    {
+      size <<= 1;
+    }
+  m_ring.assign (size, 0);
+  m_mask = size - 1;
+  m_head = 0;
+}
+
+uint32_t
+EthernetRingQueue::GetMaxPackets (void) const
+{
+  return m_ring.size ();
+}
+
+bool
+EthernetRingQueue::DoEnqueue (Ptr<Packet> p)
+{
+  NS_LOG_FUNCTION (p);
+
+  //
+  // Queue::Enqueue counts the frame in after this returns, so GetNBytes
+  // does not include it yet.
+  //
+  if (m_count == m_ring.size ())
+    {
+      NS_LOG_LOGIC ("No free descriptor, dropping");
+      Drop (p);
+      return false;
+    }
+  if (m_maxBytes != 0 && GetNBytes () + p->GetSize () > m_maxBytes)
+    {
+      NS_LOG_LOGIC ("Byte limit reached, dropping");
+      Drop (p);
+      return false;
+    }
+  m_ring[(m_head + m_count) & m_mask] = p;
+  ++m_count;
+  return true;
+}
+
+Ptr<Packet>
+EthernetRingQueue::DoDequeue (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  if (m_count == 0)
+    {
+      NS_LOG_LOGIC ("Queue empty");
+      return 0;
+    }
+  Ptr<Packet> p = m_ring[m_head];
+  m_ring[m_head] = 0;
+  m_head = (m_head + 1) & m_mask;
+  --m_count;
+  return p;
+}
+
+Ptr<const Packet>
+EthernetRingQueue::DoPeek (void) const
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  if (m_count == 0)
+    {
+      NS_LOG_LOGIC ("Queue empty");
+      return 0;
+    }
+  return m_ring[m_head];
+}
+
+} // namespace ns3
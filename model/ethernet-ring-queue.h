@@ -0,0 +1,79 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_RING_QUEUE_H
+#define ETHERNET_RING_QUEUE_H
+
+#include <vector>
+#include "ns3/queue.h"
+#include "ns3/packet.h"
+#include "ns3/ptr.h"
+
+namespace ns3 {
+
+/**
+ * \brief A transmit queue laid out like the descriptor ring of a NIC.
+ *
+ * The frames are held in a ring of MaxPackets descriptors, rounded up to a
+ * power of two and allocated when the attribute is set, so enqueueing and
+ * dequeueing are a few index operations and never allocate.  A frame is
+ * dropped when no descriptor is free or, with MaxBytes not zero, when it
+ * would take the bytes queued beyond MaxBytes, like a NIC running out of
+ * packet buffer.
+ *
+ * The Enqueue, Dequeue and Drop traces are those of every ns3::Queue, so
+ * the ASCII and queue sampler hooks work unchanged.  Use it with
+ * EthernetHelper::SetQueue ("ns3::EthernetRingQueue").
+ */
+class EthernetRingQueue : public Queue
+{
+public:
+  static TypeId GetTypeId (void);
+
+  EthernetRingQueue ();
+  virtual ~EthernetRingQueue ();
+
+  /**
+   * Resize the ring.  The queue must be empty.
+   *
+   * @param maxPackets the number of descriptors, rounded up to a power of
+   *        two
+   */
+  void SetMaxPackets (uint32_t maxPackets);
+  /**
+   * @return the number of descriptors of the ring
+   */
+  uint32_t GetMaxPackets (void) const;
+
+private:
+  virtual bool DoEnqueue (Ptr<Packet> p);
+  virtual Ptr<Packet> DoDequeue (void);
+  virtual Ptr<const Packet> DoPeek (void) const;
+
+  std::vector<Ptr<Packet> > m_ring;
+  uint32_t m_mask;
+  uint32_t m_head;
+  uint32_t m_count;
+  uint32_t m_maxBytes;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_RING_QUEUE_H */
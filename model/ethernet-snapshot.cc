@@ -0,0 +1,207 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include <string.h>
+#include <vector>
+
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ethernet-snapshot.h"
+
+namespace ns3 {
+
+static const uint64_t NEVER = static_cast<uint64_t> (1) << 63;
+
+EthernetSnapshotWriter::EthernetSnapshotWriter (std::ostream &os)
+  : m_os (os)
+{
+}
+
+void
+EthernetSnapshotWriter::Write (uint64_t value, uint32_t size)
+{
+  char buffer[8];
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      buffer[i] = (value >> (8 * i)) & 0xff;
+    }
+  m_os.write (buffer, size);
+}
+
+void
+EthernetSnapshotWriter::WriteU8 (uint8_t value)
+{
+  Write (value, 1);
+}
+
+void
+EthernetSnapshotWriter::WriteU16 (uint16_t value)
+{
+  Write (value, 2);
+}
+
+void
+EthernetSnapshotWriter::WriteU32 (uint32_t value)
+{
+  Write (value, 4);
+}
+
+void
+EthernetSnapshotWriter::WriteU64 (uint64_t value)
+{
+  Write (value, 8);
+}
+
+void
+EthernetSnapshotWriter::WriteDouble (double value)
+{
+  uint64_t bits;
+  memcpy (&bits, &value, sizeof (bits));
+  Write (bits, 8);
+}
+
+void
+EthernetSnapshotWriter::WriteTime (Time t)
+{
+  //
+  // The maximum simulation time stands for never, and stays so.
+  //
+  if (t == Simulator::GetMaximumSimulationTime ())
+    {
+      Write (NEVER, 8);
+      return;
+    }
+  Write ((t - Simulator::Now ()).GetNanoSeconds (), 8);
+}
+
+void
+EthernetSnapshotWriter::WriteMac48Address (Mac48Address address)
+{
+  uint8_t buffer[6];
+  address.CopyTo (buffer);
+  m_os.write (reinterpret_cast<const char *> (buffer), 6);
+}
+
+void
+EthernetSnapshotWriter::WritePacket (Ptr<const Packet> packet)
+{
+  uint32_t size = packet->GetSize ();
+  std::vector<uint8_t> buffer (size);
+  if (size)
+    {
+      packet->CopyData (&buffer[0], size);
+    }
+  Write (size, 4);
+  if (size)
+    {
+      m_os.write (reinterpret_cast<const char *> (&buffer[0]), size);
+    }
+}
+
+EthernetSnapshotReader::EthernetSnapshotReader (std::istream &is)
+  : m_is (is)
+{
+}
+
+uint64_t
+EthernetSnapshotReader::Read (uint32_t size)
+{
+  unsigned char buffer[8];
+  m_is.read (reinterpret_cast<char *> (buffer), size);
+  NS_ABORT_MSG_UNLESS (m_is, "EthernetSnapshotReader: truncated snapshot");
+  uint64_t value = 0;
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      value |= static_cast<uint64_t> (buffer[i]) << (8 * i);
+    }
+  return value;
+}
+
+uint8_t
+EthernetSnapshotReader::ReadU8 (void)
+{
+  return Read (1);
+}
+
+uint16_t
+EthernetSnapshotReader::ReadU16 (void)
+{
+  return Read (2);
+}
+
+uint32_t
+EthernetSnapshotReader::ReadU32 (void)
+{
+  return Read (4);
+}
+
+uint64_t
+EthernetSnapshotReader::ReadU64 (void)
+{
+  return Read (8);
+}
+
+double
+EthernetSnapshotReader::ReadDouble (void)
+{
+  uint64_t bits = Read (8);
+  double value;
+  memcpy (&value, &bits, sizeof (value));
+  return value;
+}
+
+Time
+EthernetSnapshotReader::ReadTime (void)
+{
+  uint64_t value = Read (8);
+  if (value == NEVER)
+    {
+      return Simulator::GetMaximumSimulationTime ();
+    }
+  return Simulator::Now () + NanoSeconds (static_cast<int64_t> (value));
+}
+
+Mac48Address
+EthernetSnapshotReader::ReadMac48Address (void)
+{
+  uint8_t buffer[6];
+  m_is.read (reinterpret_cast<char *> (buffer), 6);
+  NS_ABORT_MSG_UNLESS (m_is, "EthernetSnapshotReader: truncated snapshot");
+  Mac48Address address;
+  address.CopyFrom (buffer);
+  return address;
+}
+
+Ptr<Packet>
+EthernetSnapshotReader::ReadPacket (void)
+{
+  uint32_t size = Read (4);
+  NS_ABORT_MSG_IF (size > 65536, "EthernetSnapshotReader: malformed packet");
+  std::vector<uint8_t> buffer (size);
+  if (size)
+    {
+      m_is.read (reinterpret_cast<char *> (&buffer[0]), size);
+      NS_ABORT_MSG_UNLESS (m_is, "EthernetSnapshotReader: truncated snapshot");
+      return Create<Packet> (&buffer[0], size);
+    }
+  return Create<Packet> ();
+}
+
+} // namespace ns3
@@ -0,0 +1,90 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_SNAPSHOT_H
+#define ETHERNET_SNAPSHOT_H
+
+#include <istream>
+#include <ostream>
+#include "ns3/ptr.h"
+#include "ns3/packet.h"
+#include "ns3/nstime.h"
+#include "ns3/mac48-address.h"
+
+namespace ns3 {
+
+/**
+ * \brief Write the state of Ethernet objects to a binary snapshot.
+ *
+ * Integers are written little-endian.  Times are written relative to the
+ * current simulation time, so a snapshot taken at any time restores at
+ * any other.  Packets are written as their bytes: their tags are lost.
+ */
+class EthernetSnapshotWriter
+{
+public:
+  EthernetSnapshotWriter (std::ostream &os);
+
+  void WriteU8 (uint8_t value);
+  void WriteU16 (uint16_t value);
+  void WriteU32 (uint32_t value);
+  void WriteU64 (uint64_t value);
+  void WriteDouble (double value);
+  void WriteTime (Time t);
+  void WriteMac48Address (Mac48Address address);
+  void WritePacket (Ptr<const Packet> packet);
+
+private:
+  void Write (uint64_t value, uint32_t size);
+
+  std::ostream &m_os;
+};
+
+/**
+ * \brief Read back what EthernetSnapshotWriter wrote.
+ *
+ * A truncated or malformed snapshot is a fatal error.
+ */
+class EthernetSnapshotReader
+{
+public:
+  EthernetSnapshotReader (std::istream &is);
+
+  uint8_t ReadU8 (void);
+  uint16_t ReadU16 (void);
+  uint32_t ReadU32 (void);
+  uint64_t ReadU64 (void);
+  double ReadDouble (void);
+  /**
+   * @return the time written, shifted to the current simulation time
+   */
+  Time ReadTime (void);
+  Mac48Address ReadMac48Address (void);
+  Ptr<Packet> ReadPacket (void);
+
+private:
+  uint64_t Read (uint32_t size);
+
+  std::istream &m_is;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_SNAPSHOT_H */
@@ -0,0 +1,134 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/abort.h"
+#include "ns3/queue.h"
+#include "ethernet-stats-buffer.h"
+#include "ethernet-net-device.h"
+
+NS_LOG_COMPONENT_DEFINE ("EthernetStatsBuffer");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (EthernetStatsBuffer);
+
+TypeId
+EthernetStatsBuffer::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetStatsBuffer")
+    .SetParent<Object> ()
+    .AddConstructor<EthernetStatsBuffer> ()
+    ;
+  return tid;
+}
+
+EthernetStatsBuffer::EthernetStatsBuffer ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+EthernetStatsBuffer::~EthernetStatsBuffer ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+EthernetStatsBuffer::DoDispose (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_devices.clear ();
+  Object::DoDispose ();
+}
+
+void
+EthernetStatsBuffer::SetDevices (NetDeviceContainer c)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  NS_ABORT_MSG_IF (!m_devices.empty (), "EthernetStatsBuffer::SetDevices(): devices already set");
+  for (NetDeviceContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      m_devices.push_back ((*i)->GetObject<EthernetNetDevice> ());
+    }
+  m_buffer.assign (m_devices.size () * N_FIELDS, 0);
+  Update ();
+}
+
+void
+EthernetStatsBuffer::Update (void)
+{
+  uint64_t *row = m_buffer.empty () ? 0 : &m_buffer[0];
+  for (uint32_t i = 0; i < m_devices.size (); ++i, row += N_FIELDS)
+    {
+      Ptr<EthernetNetDevice> device = m_devices[i];
+      if (device == 0)
+        {
+          continue;
+        }
+      Ptr<Queue> queue = device->GetQueue ();
+      row[TX_FRAMES] = device->GetNQueuedFrames ();
+      row[TX_BYTES] = device->GetNQueuedBytes ();
+      row[TX_DROPS] = device->GetNQueueDrops ();
+      row[RX_FRAMES] = device->GetNReceivedFrames ();
+      row[RX_BYTES] = device->GetNReceivedBytes ();
+      uint64_t drops = 0;
+      for (uint32_t q = 0; q < device->GetReceiveQueues (); ++q)
+        {
+          drops += device->GetReceiveQueueDrops (q);
+        }
+      row[RX_DROPS] = drops;
+      row[QUEUE_FRAMES] = queue->GetNPackets ();
+      row[QUEUE_BYTES] = queue->GetNBytes ();
+    }
+}
+
+uint32_t
+EthernetStatsBuffer::GetNDevices (void) const
+{
+  return m_devices.size ();
+}
+
+uint32_t
+EthernetStatsBuffer::GetNFields (void) const
+{
+  return N_FIELDS;
+}
+
+uint64_t
+EthernetStatsBuffer::Get (uint32_t device, enum Field field) const
+{
+  NS_ASSERT (device < m_devices.size ());
+  return m_buffer[device * N_FIELDS + field];
+}
+
+const uint64_t *
+EthernetStatsBuffer::GetBuffer (void) const
+{
+  return m_buffer.empty () ? 0 : &m_buffer[0];
+}
+
+uint32_t
+EthernetStatsBuffer::GetBufferSize (void) const
+{
+  return m_buffer.size () * sizeof (uint64_t);
+}
+
+} // namespace ns3
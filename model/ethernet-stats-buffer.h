@@ -0,0 +1,123 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_STATS_BUFFER_H
+#define ETHERNET_STATS_BUFFER_H
+
+#include <vector>
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include "ns3/net-device-container.h"
+
+namespace ns3 {
+
+class EthernetNetDevice;
+
+/**
+ * \brief The counters and queue depths of many devices, in one contiguous
+ * buffer.
+ *
+ * The buffer holds a row of N_FIELDS 64-bit counters per device, in the
+ * order of the container given to SetDevices, and is refreshed in place by
+ * Update.  It is allocated once, by SetDevices, so its address stays valid
+ * for the life of the object: the Python bindings expose it as a
+ * read-only buffer which numpy can view without copying, e.g.
+ *
+ * \code
+ *   stats = helper.CreateStatsBuffer (devices)
+ *   counters = numpy.frombuffer (stats.GetBuffer (), dtype=numpy.uint64)
+ *   counters = counters.reshape (stats.GetNDevices (), stats.GetNFields ())
+ *   ...
+ *   stats.Update ()   # counters now holds the current values
+ * \endcode
+ *
+ * The view keeps the object alive.  Devices which are not
+ * EthernetNetDevice get a row of zeros.
+ *
+ * The transmit byte counters count the frames as queued, with their
+ * Ethernet header and trailer, while the receive byte counter counts the
+ * payload handed to the upper layers.
+ */
+class EthernetStatsBuffer : public Object
+{
+public:
+  enum Field
+    {
+      TX_FRAMES,     /**< frames accepted into the transmit queue */
+      TX_BYTES,      /**< bytes accepted into the transmit queue, framed */
+      TX_DROPS,      /**< frames dropped by the transmit queue */
+      RX_FRAMES,     /**< frames received for the upper layers */
+      RX_BYTES,      /**< payload bytes received for the upper layers */
+      RX_DROPS,      /**< frames dropped by full receive queues */
+      QUEUE_FRAMES,  /**< frames in the transmit queue */
+      QUEUE_BYTES,   /**< bytes in the transmit queue, framed */
+      N_FIELDS
+    };
+
+  static TypeId GetTypeId (void);
+
+  EthernetStatsBuffer ();
+  virtual ~EthernetStatsBuffer ();
+
+  /**
+   * Set the devices to collect the counters of, and allocate the buffer.
+   * Can only be called once, as views of the buffer may exist.
+   *
+   * @param c the devices, normally returned by EthernetHelper::Install
+   */
+  void SetDevices (NetDeviceContainer c);
+  /**
+   * Refresh the whole buffer with the current counters.
+   */
+  void Update (void);
+  /**
+   * @return the number of rows of the buffer
+   */
+  uint32_t GetNDevices (void) const;
+  /**
+   * @return the number of counters in a row
+   */
+  uint32_t GetNFields (void) const;
+  /**
+   * @param device the index of the device in the container
+   * @param field the counter
+   * @return the counter as of the last Update
+   */
+  uint64_t Get (uint32_t device, enum Field field) const;
+  /**
+   * @return the first counter of the buffer
+   */
+  const uint64_t *GetBuffer (void) const;
+  /**
+   * @return the size of the buffer in bytes
+   */
+  uint32_t GetBufferSize (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  std::vector<Ptr<EthernetNetDevice> > m_devices;
+  std::vector<uint64_t> m_buffer;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_STATS_BUFFER_H */
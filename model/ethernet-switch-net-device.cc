@@ -0,0 +1,1217 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include <algorithm>
+#include <set>
+
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/channel.h"
+#include "ns3/simulator.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "ns3/string.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv6-address.h"
+#include "ns3/bridge-channel.h"
+#include "ethernet-switch-net-device.h"
+#include "ethernet-ecmp-group.h"
+#include "ethernet-net-device.h"
+#include "ethernet-vlan-tag.h"
+#include "ethernet-snapshot.h"
+
+NS_LOG_COMPONENT_DEFINE ("EthernetSwitchNetDevice");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (EthernetSwitchNetDevice);
+
+TypeId
+EthernetSwitchNetDevice::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetSwitchNetDevice")
+    .SetParent<NetDevice> ()
+    .AddConstructor<EthernetSwitchNetDevice> ()
+    .AddAttribute ("Mtu", "The MAC-level Maximum Transmission Unit",
+                   UintegerValue (1500),
+                   MakeUintegerAccessor (&EthernetSwitchNetDevice::SetMtu,
+                                         &EthernetSwitchNetDevice::GetMtu),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("EnableLearning",
+                   "Learn the port of source addresses.  Static entries are always used.",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&EthernetSwitchNetDevice::m_enableLearning),
+                   MakeBooleanChecker ())
+    .AddAttribute ("ExpirationTime",
+                   "Time it takes for a learned MAC address entry to expire.",
+                   TimeValue (Seconds (300)),
+                   MakeTimeAccessor (&EthernetSwitchNetDevice::m_expirationTime),
+                   MakeTimeChecker ())
+    .AddAttribute ("Snooping",
+                   "Forward multicast frames only to the ports behind which members reported themselves.",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&EthernetSwitchNetDevice::m_snooping),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MembershipTimeout",
+                   "Time it takes for a snooped multicast membership to expire.",
+                   TimeValue (Seconds (260)),
+                   MakeTimeAccessor (&EthernetSwitchNetDevice::m_membershipTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("LastMemberTimeout",
+                   "Time a snooped multicast membership lasts after a leave, for the other members "
+                   "behind the port to answer the query of the router.",
+                   TimeValue (Seconds (2)),
+                   MakeTimeAccessor (&EthernetSwitchNetDevice::m_lastMemberTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("RouterTimeout",
+                   "Time it takes for a port to stop being a multicast router port after the last "
+                   "query or PIM hello received on it.",
+                   TimeValue (Seconds (260)),
+                   MakeTimeAccessor (&EthernetSwitchNetDevice::m_routerTimeout),
+                   MakeTimeChecker ())
+    ;
+  return tid;
+}
+
+EthernetSwitchNetDevice::EthernetSwitchNetDevice ()
+  : m_node (0),
+    m_ifIndex (0)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_channel = CreateObject<BridgeChannel> ();
+}
+
+EthernetSwitchNetDevice::~EthernetSwitchNetDevice ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+EthernetSwitchNetDevice::DoDispose (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_ports.clear ();
+  m_tables.clear ();
+  m_ecmpGroups.clear ();
+  m_activeEcmpGroups.clear ();
+  m_groups.clear ();
+  m_routerPorts.clear ();
+  m_channel = 0;
+  m_node = 0;
+  m_rxCallback = MakeNullCallback<bool, Ptr<NetDevice>, Ptr<const Packet>, uint16_t, const Address &> ();
+  m_promiscRxCallback = MakeNullCallback<bool, Ptr<NetDevice>, Ptr<const Packet>, uint16_t, const Address &, const Address &, PacketType> ();
+  NetDevice::DoDispose ();
+}
+
+void
+EthernetSwitchNetDevice::AddSwitchPort (Ptr<NetDevice> port)
+{
+  NS_LOG_FUNCTION (port);
+  NS_ASSERT (port != this);
+  NS_ASSERT (m_node != 0 && port->GetNode () == m_node);
+  if (!Mac48Address::IsMatchingType (port->GetAddress ()))
+    {
+      NS_FATAL_ERROR ("EthernetSwitchNetDevice::AddSwitchPort(): port does not have a MAC-48 address");
+    }
+  if (!port->SupportsSendFrom ())
+    {
+      NS_FATAL_ERROR ("EthernetSwitchNetDevice::AddSwitchPort(): port does not support SendFrom");
+    }
+  if (m_address == Mac48Address ())
+    {
+      m_address = Mac48Address::ConvertFrom (port->GetAddress ());
+    }
+
+  m_node->RegisterProtocolHandler (MakeCallback (&EthernetSwitchNetDevice::ReceiveFromDevice, this),
+                                   0, port, true);
+  m_ports.push_back (port);
+  m_channel->AddChannel (port->GetChannel ());
+  port->AddLinkChangeCallback (MakeCallback (&EthernetSwitchNetDevice::FlushDownPorts, this));
+}
+
+uint32_t
+EthernetSwitchNetDevice::GetNSwitchPorts (void) const
+{
+  return m_ports.size ();
+}
+
+Ptr<NetDevice>
+EthernetSwitchNetDevice::GetSwitchPort (uint32_t n) const
+{
+  NS_ASSERT (n < m_ports.size ());
+  return m_ports[n];
+}
+
+void
+EthernetSwitchNetDevice::AddStaticEntry (Mac48Address address, Ptr<NetDevice> port, uint16_t vid)
+{
+  NS_LOG_FUNCTION (address << port << vid);
+  ForwardingEntry &entry = m_tables[vid][address];
+  entry.port = port;
+  entry.isStatic = true;
+}
+
+void
+EthernetSwitchNetDevice::ClearStaticEntries (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  for (VlanTables::iterator table = m_tables.begin (); table != m_tables.end (); ++table)
+    {
+      ForwardingTable::iterator i = table->second.begin ();
+      while (i != table->second.end ())
+        {
+          if (i->second.isStatic)
+            {
+              table->second.erase (i++);
+            }
+          else
+            {
+              ++i;
+            }
+        }
+    }
+}
+
+void
+EthernetSwitchNetDevice::FlushDownPorts (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  std::set<Ptr<NetDevice> > down;
+  for (std::vector<Ptr<NetDevice> >::const_iterator i = m_ports.begin (); i != m_ports.end (); ++i)
+    {
+      if (!(*i)->IsLinkUp ())
+        {
+          down.insert (*i);
+        }
+    }
+  if (down.empty ())
+    {
+      return;
+    }
+
+  //
+  // The stations behind a port that went down are only found again by
+  // flooding, wherever they moved to; the static entries stay.
+  //
+  for (VlanTables::iterator table = m_tables.begin (); table != m_tables.end (); ++table)
+    {
+      ForwardingTable::iterator i = table->second.begin ();
+      while (i != table->second.end ())
+        {
+          if (!i->second.isStatic && down.count (i->second.port) != 0)
+            {
+              NS_LOG_LOGIC ("Flushing " << i->first << " learned on port " << i->second.port->GetIfIndex ());
+              table->second.erase (i++);
+            }
+          else
+            {
+              ++i;
+            }
+        }
+    }
+  for (GroupTable::iterator group = m_groups.begin (); group != m_groups.end (); )
+    {
+      for (std::set<Ptr<NetDevice> >::const_iterator i = down.begin (); i != down.end (); ++i)
+        {
+          MemberPorts::iterator member = group->second.find (*i);
+          if (member != group->second.end () && member->second != Simulator::GetMaximumSimulationTime ())
+            {
+              group->second.erase (member);
+            }
+        }
+      if (group->second.empty ())
+        {
+          m_groups.erase (group++);
+        }
+      else
+        {
+          ++group;
+        }
+    }
+  for (std::map<uint16_t, MemberPorts>::iterator vlan = m_routerPorts.begin (); vlan != m_routerPorts.end (); ++vlan)
+    {
+      for (std::set<Ptr<NetDevice> >::const_iterator i = down.begin (); i != down.end (); ++i)
+        {
+          vlan->second.erase (*i);
+        }
+    }
+}
+
+Ptr<NetDevice>
+EthernetSwitchNetDevice::LookupPort (Mac48Address address, uint16_t vid)
+{
+  VlanTables::iterator table = m_tables.find (vid);
+  if (table != m_tables.end ())
+    {
+      ForwardingTable::iterator i = table->second.find (address);
+      if (i != table->second.end ())
+        {
+          if (i->second.isStatic || i->second.expirationTime > Simulator::Now ())
+            {
+              return i->second.port;
+            }
+          NS_LOG_LOGIC ("Entry for " << address << " in VLAN " << vid << " expired");
+          table->second.erase (i);
+        }
+    }
+
+  //
+  // The static entries of VLAN 0 stand for every VLAN.
+  //
+  if (vid != 0)
+    {
+      table = m_tables.find (0);
+      if (table != m_tables.end ())
+        {
+          ForwardingTable::iterator i = table->second.find (address);
+          if (i != table->second.end () && i->second.isStatic)
+            {
+              return i->second.port;
+            }
+        }
+    }
+  return 0;
+}
+
+void
+EthernetSwitchNetDevice::AddEcmpGroup (Ptr<EthernetEcmpGroup> group)
+{
+  NS_LOG_FUNCTION (group);
+  for (uint32_t i = 0; i < group->GetNMembers (); ++i)
+    {
+      NS_ASSERT_MSG (std::find (m_ports.begin (), m_ports.end (), group->GetMember (i)) != m_ports.end (),
+                     "EthernetSwitchNetDevice::AddEcmpGroup(): member is not a switch port");
+    }
+  m_ecmpGroups.push_back (group);
+
+  //
+  // The frames are spread over a copy of the group holding just the
+  // members whose link is up.
+  //
+  Ptr<EthernetEcmpGroup> active = CreateObject<EthernetEcmpGroup> ();
+  static const char *attributes[] = { "Seed", "HashFields", "Buckets" };
+  for (uint32_t i = 0; i < sizeof (attributes) / sizeof (attributes[0]); ++i)
+    {
+      StringValue value;
+      group->GetAttribute (attributes[i], value);
+      active->SetAttribute (attributes[i], value);
+    }
+  m_activeEcmpGroups.push_back (active);
+  for (uint32_t i = 0; i < group->GetNMembers (); ++i)
+    {
+      group->GetMember (i)->AddLinkChangeCallback (MakeCallback (&EthernetSwitchNetDevice::UpdateEcmpGroups, this));
+    }
+  UpdateEcmpGroups ();
+}
+
+void
+EthernetSwitchNetDevice::UpdateEcmpGroups (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  for (uint32_t i = 0; i < m_ecmpGroups.size (); ++i)
+    {
+      for (uint32_t j = 0; j < m_ecmpGroups[i]->GetNMembers (); ++j)
+        {
+          Ptr<NetDevice> member = m_ecmpGroups[i]->GetMember (j);
+          if (member->IsLinkUp ())
+            {
+              m_activeEcmpGroups[i]->AddMember (member);
+            }
+          else
+            {
+              m_activeEcmpGroups[i]->RemoveMember (member);
+            }
+        }
+    }
+}
+
+Ptr<EthernetEcmpGroup>
+EthernetSwitchNetDevice::FindEcmpGroup (Ptr<NetDevice> port) const
+{
+  for (std::vector<Ptr<EthernetEcmpGroup> >::const_iterator i = m_ecmpGroups.begin (); i != m_ecmpGroups.end (); ++i)
+    {
+      if ((*i)->IsMember (port))
+        {
+          return *i;
+        }
+    }
+  return 0;
+}
+
+Ptr<EthernetEcmpGroup>
+EthernetSwitchNetDevice::FindActiveEcmpGroup (Ptr<NetDevice> port) const
+{
+  for (uint32_t i = 0; i < m_ecmpGroups.size (); ++i)
+    {
+      if (m_ecmpGroups[i]->IsMember (port))
+        {
+          return m_activeEcmpGroups[i];
+        }
+    }
+  return 0;
+}
+
+Ptr<NetDevice>
+EthernetSwitchNetDevice::SelectEgress (Ptr<NetDevice> port, Ptr<const Packet> packet,
+                                       uint16_t protocol, Mac48Address src, Mac48Address dst) const
+{
+  if (m_ecmpGroups.empty ())
+    {
+      return port;
+    }
+  Ptr<EthernetEcmpGroup> group = FindActiveEcmpGroup (port);
+  Ptr<NetDevice> member = group == 0 ? 0 : group->Select (packet, protocol, src, dst);
+  return member == 0 ? port : member;
+}
+
+uint16_t
+EthernetSwitchNetDevice::GetVlan (Ptr<NetDevice> port, Ptr<const Packet> packet)
+{
+  Ptr<EthernetNetDevice> device = DynamicCast<EthernetNetDevice> (port);
+  if (device == 0 || device->GetVlanMode () == EthernetNetDevice::VLAN_NONE)
+    {
+      return 0;
+    }
+  EthernetVlanTag tag;
+  packet->PeekPacketTag (tag);
+  return tag.GetVid ();
+}
+
+bool
+EthernetSwitchNetDevice::IsVlanMember (Ptr<NetDevice> port, uint16_t vid)
+{
+  Ptr<EthernetNetDevice> device = DynamicCast<EthernetNetDevice> (port);
+  return device == 0 ? vid == 0 : device->IsVlanMember (vid);
+}
+
+void
+EthernetSwitchNetDevice::Flood (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet, uint16_t vid,
+                                uint16_t protocol, Mac48Address src, Mac48Address dst)
+{
+  //
+  // An ECMP group is a single logical port: it gets one copy, on the member
+  // the flow hashes to, and never the frames that came in through it.
+  //
+  Ptr<EthernetEcmpGroup> incomingGroup = incomingPort == 0 ? 0 : FindEcmpGroup (incomingPort);
+  for (std::vector<Ptr<NetDevice> >::iterator i = m_ports.begin (); i != m_ports.end (); ++i)
+    {
+      if (*i == incomingPort || !IsVlanMember (*i, vid))
+        {
+          continue;
+        }
+      if (!m_ecmpGroups.empty ())
+        {
+          Ptr<EthernetEcmpGroup> group = FindEcmpGroup (*i);
+          if (group != 0 && (group == incomingGroup
+                             || FindActiveEcmpGroup (*i)->Select (packet, protocol, src, dst) != *i))
+            {
+              continue;
+            }
+        }
+      (*i)->SendFrom (packet->Copy (), src, dst, protocol);
+    }
+}
+
+static uint32_t
+FindPortIndex (const std::vector<Ptr<NetDevice> > &ports, Ptr<NetDevice> port)
+{
+  return std::find (ports.begin (), ports.end (), port) - ports.begin ();
+}
+
+void
+EthernetSwitchNetDevice::SaveState (EthernetSnapshotWriter &writer) const
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  Time now = Simulator::Now ();
+
+  uint32_t n = 0;
+  for (VlanTables::const_iterator table = m_tables.begin (); table != m_tables.end (); ++table)
+    {
+      for (ForwardingTable::const_iterator i = table->second.begin (); i != table->second.end (); ++i)
+        {
+          n += !i->second.isStatic && i->second.expirationTime > now;
+        }
+    }
+  writer.WriteU32 (n);
+  for (VlanTables::const_iterator table = m_tables.begin (); table != m_tables.end (); ++table)
+    {
+      for (ForwardingTable::const_iterator i = table->second.begin (); i != table->second.end (); ++i)
+        {
+          if (!i->second.isStatic && i->second.expirationTime > now)
+            {
+              writer.WriteU16 (table->first);
+              writer.WriteMac48Address (i->first);
+              writer.WriteU32 (FindPortIndex (m_ports, i->second.port));
+              writer.WriteTime (i->second.expirationTime);
+            }
+        }
+    }
+
+  n = 0;
+  for (GroupTable::const_iterator group = m_groups.begin (); group != m_groups.end (); ++group)
+    {
+      for (MemberPorts::const_iterator i = group->second.begin (); i != group->second.end (); ++i)
+        {
+          n += i->second != Simulator::GetMaximumSimulationTime () && i->second > now;
+        }
+    }
+  writer.WriteU32 (n);
+  for (GroupTable::const_iterator group = m_groups.begin (); group != m_groups.end (); ++group)
+    {
+      for (MemberPorts::const_iterator i = group->second.begin (); i != group->second.end (); ++i)
+        {
+          if (i->second != Simulator::GetMaximumSimulationTime () && i->second > now)
+            {
+              writer.WriteU16 (group->first.first);
+              writer.WriteMac48Address (group->first.second);
+              writer.WriteU32 (FindPortIndex (m_ports, i->first));
+              writer.WriteTime (i->second);
+            }
+        }
+    }
+
+  n = 0;
+  for (std::map<uint16_t, MemberPorts>::const_iterator vlan = m_routerPorts.begin (); vlan != m_routerPorts.end (); ++vlan)
+    {
+      for (MemberPorts::const_iterator i = vlan->second.begin (); i != vlan->second.end (); ++i)
+        {
+          n += i->second > now;
+        }
+    }
+  writer.WriteU32 (n);
+  for (std::map<uint16_t, MemberPorts>::const_iterator vlan = m_routerPorts.begin (); vlan != m_routerPorts.end (); ++vlan)
+    {
+      for (MemberPorts::const_iterator i = vlan->second.begin (); i != vlan->second.end (); ++i)
+        {
+          if (i->second > now)
+            {
+              writer.WriteU16 (vlan->first);
+              writer.WriteU32 (FindPortIndex (m_ports, i->first));
+              writer.WriteTime (i->second);
+            }
+        }
+    }
+}
+
+void
+EthernetSwitchNetDevice::RestoreState (EthernetSnapshotReader &reader)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  uint32_t n = reader.ReadU32 ();
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      uint16_t vid = reader.ReadU16 ();
+      Mac48Address address = reader.ReadMac48Address ();
+      uint32_t port = reader.ReadU32 ();
+      Time expiration = reader.ReadTime ();
+      NS_ABORT_MSG_IF (port >= m_ports.size (), "EthernetSwitchNetDevice::RestoreState(): no port " << port);
+      ForwardingEntry &entry = m_tables[vid][address];
+      if (entry.port != 0 && entry.isStatic)
+        {
+          continue;
+        }
+      entry.port = m_ports[port];
+      entry.expirationTime = expiration;
+      entry.isStatic = false;
+    }
+
+  n = reader.ReadU32 ();
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      uint16_t vid = reader.ReadU16 ();
+      Mac48Address group = reader.ReadMac48Address ();
+      uint32_t port = reader.ReadU32 ();
+      Time expiration = reader.ReadTime ();
+      NS_ABORT_MSG_IF (port >= m_ports.size (), "EthernetSwitchNetDevice::RestoreState(): no port " << port);
+      Time &member = m_groups[GroupKey (vid, group)][m_ports[port]];
+      if (member != Simulator::GetMaximumSimulationTime ())
+        {
+          member = expiration;
+        }
+    }
+
+  n = reader.ReadU32 ();
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      uint16_t vid = reader.ReadU16 ();
+      uint32_t port = reader.ReadU32 ();
+      Time expiration = reader.ReadTime ();
+      NS_ABORT_MSG_IF (port >= m_ports.size (), "EthernetSwitchNetDevice::RestoreState(): no port " << port);
+      m_routerPorts[vid][m_ports[port]] = expiration;
+    }
+}
+
+void
+EthernetSwitchNetDevice::Learn (Mac48Address source, Ptr<NetDevice> port, uint16_t vid)
+{
+  if (!m_enableLearning)
+    {
+      return;
+    }
+  if (vid != 0)
+    {
+      ForwardingTable &shared = m_tables[0];
+      ForwardingTable::iterator i = shared.find (source);
+      if (i != shared.end () && i->second.isStatic)
+        {
+          return;
+        }
+    }
+  ForwardingEntry &entry = m_tables[vid][source];
+  if (entry.port != 0 && entry.isStatic)
+    {
+      return;
+    }
+  NS_LOG_LOGIC ("Learned " << source << " in VLAN " << vid << " on port " << port->GetIfIndex ());
+  entry.port = port;
+  entry.expirationTime = Simulator::Now () + m_expirationTime;
+  entry.isStatic = false;
+}
+
+bool
+EthernetSwitchNetDevice::ReceiveFromDevice (Ptr<NetDevice> port, Ptr<const Packet> packet, uint16_t protocol,
+                                            const Address &source, const Address &destination, PacketType packetType)
+{
+  NS_LOG_FUNCTION (port << packet << protocol << source << destination << packetType);
+
+  Mac48Address src48 = Mac48Address::ConvertFrom (source);
+  Mac48Address dst48 = Mac48Address::ConvertFrom (destination);
+  uint16_t vid = GetVlan (port, packet);
+
+  if (!m_promiscRxCallback.IsNull ())
+    {
+      m_promiscRxCallback (this, packet, protocol, source, destination, packetType);
+    }
+
+  switch (packetType)
+    {
+    case PACKET_HOST:
+      if (dst48 == m_address)
+        {
+          Learn (src48, port, vid);
+          m_rxCallback (this, packet, protocol, source);
+        }
+      break;
+
+    case PACKET_BROADCAST:
+      m_rxCallback (this, packet, protocol, source);
+      ForwardBroadcast (port, packet, vid, protocol, src48, dst48);
+      break;
+
+    case PACKET_MULTICAST:
+      m_rxCallback (this, packet, protocol, source);
+      if (m_snooping)
+        {
+          if (Snoop (port, packet, vid, protocol))
+            {
+              ForwardReport (port, packet, vid, protocol, src48, dst48);
+            }
+          else
+            {
+              ForwardMulticast (port, packet, vid, protocol, src48, dst48);
+            }
+        }
+      else
+        {
+          ForwardBroadcast (port, packet, vid, protocol, src48, dst48);
+        }
+      break;
+
+    case PACKET_OTHERHOST:
+      if (dst48 == m_address)
+        {
+          Learn (src48, port, vid);
+          m_rxCallback (this, packet, protocol, source);
+        }
+      else
+        {
+          ForwardUnicast (port, packet, vid, protocol, src48, dst48);
+        }
+      break;
+    }
+  return true;
+}
+
+void
+EthernetSwitchNetDevice::ForwardUnicast (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet, uint16_t vid,
+                                         uint16_t protocol, Mac48Address src, Mac48Address dst)
+{
+  NS_LOG_FUNCTION (incomingPort << packet << vid << protocol << src << dst);
+
+  Learn (src, incomingPort, vid);
+  Ptr<NetDevice> outPort = LookupPort (dst, vid);
+  if (outPort == incomingPort
+      || (outPort != 0 && !m_ecmpGroups.empty () && FindEcmpGroup (outPort) != 0
+          && FindEcmpGroup (outPort) == FindEcmpGroup (incomingPort)))
+    {
+      NS_LOG_LOGIC ("Filtering frame to " << dst << ", it is behind the incoming port");
+      return;
+    }
+  if (outPort != 0)
+    {
+      outPort = SelectEgress (outPort, packet, protocol, src, dst);
+      if (!IsVlanMember (outPort, vid))
+        {
+          NS_LOG_LOGIC ("Filtering frame to " << dst << ", its port is not in VLAN " << vid);
+          return;
+        }
+      outPort->SendFrom (packet->Copy (), src, dst, protocol);
+      return;
+    }
+
+  NS_LOG_LOGIC ("No forwarding entry for " << dst << ", flooding");
+  Flood (incomingPort, packet, vid, protocol, src, dst);
+}
+
+void
+EthernetSwitchNetDevice::ForwardBroadcast (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet, uint16_t vid,
+                                           uint16_t protocol, Mac48Address src, Mac48Address dst)
+{
+  NS_LOG_FUNCTION (incomingPort << packet << vid << protocol << src << dst);
+
+  Learn (src, incomingPort, vid);
+  Flood (incomingPort, packet, vid, protocol, src, dst);
+}
+
+void
+EthernetSwitchNetDevice::ForwardMulticast (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet, uint16_t vid,
+                                           uint16_t protocol, Mac48Address src, Mac48Address dst)
+{
+  NS_LOG_FUNCTION (incomingPort << packet << vid << protocol << src << dst);
+
+  Learn (src, incomingPort, vid);
+  GroupTable::iterator group = m_groups.find (GroupKey (vid, dst));
+  if (group != m_groups.end ())
+    {
+      ExpirePorts (group->second);
+      if (group->second.empty ())
+        {
+          m_groups.erase (group);
+          group = m_groups.end ();
+        }
+    }
+
+  if (group == m_groups.end ())
+    {
+      NS_LOG_LOGIC ("No member of " << dst << ", flooding");
+      Flood (incomingPort, packet, vid, protocol, src, dst);
+      return;
+    }
+  for (MemberPorts::iterator i = group->second.begin (); i != group->second.end (); ++i)
+    {
+      if (i->first != incomingPort && IsVlanMember (i->first, vid))
+        {
+          i->first->SendFrom (packet->Copy (), src, dst, protocol);
+        }
+    }
+
+  //
+  // The routers forward the group beyond the segment, whether or not they
+  // reported themselves.
+  //
+  MemberPorts &routers = m_routerPorts[vid];
+  ExpirePorts (routers);
+  for (MemberPorts::iterator i = routers.begin (); i != routers.end (); ++i)
+    {
+      if (i->first != incomingPort && group->second.find (i->first) == group->second.end ()
+          && IsVlanMember (i->first, vid))
+        {
+          i->first->SendFrom (packet->Copy (), src, dst, protocol);
+        }
+    }
+}
+
+void
+EthernetSwitchNetDevice::ForwardReport (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet, uint16_t vid,
+                                        uint16_t protocol, Mac48Address src, Mac48Address dst)
+{
+  NS_LOG_FUNCTION (incomingPort << packet << vid << protocol << src << dst);
+
+  //
+  // Membership reports go to the multicast routers only, so that the
+  // upstream switches learn about the members behind this one and the
+  // other members do not suppress their own reports.  Without a known
+  // router they are flooded, to reach whatever lies upstream.
+  //
+  Learn (src, incomingPort, vid);
+  MemberPorts &routers = m_routerPorts[vid];
+  ExpirePorts (routers);
+  if (routers.empty ())
+    {
+      NS_LOG_LOGIC ("No multicast router, flooding report");
+      Flood (incomingPort, packet, vid, protocol, src, dst);
+      return;
+    }
+  for (MemberPorts::iterator i = routers.begin (); i != routers.end (); ++i)
+    {
+      if (i->first != incomingPort && IsVlanMember (i->first, vid))
+        {
+          i->first->SendFrom (packet->Copy (), src, dst, protocol);
+        }
+    }
+}
+
+void
+EthernetSwitchNetDevice::LearnRouter (Ptr<NetDevice> port, uint16_t vid)
+{
+  NS_LOG_LOGIC ("Multicast router in VLAN " << vid << " on port " << port->GetIfIndex ());
+  m_routerPorts[vid][port] = Simulator::Now () + m_routerTimeout;
+}
+
+void
+EthernetSwitchNetDevice::ExpirePorts (MemberPorts &ports)
+{
+  MemberPorts::iterator i = ports.begin ();
+  while (i != ports.end ())
+    {
+      if (i->second <= Simulator::Now ())
+        {
+          NS_LOG_LOGIC ("Port " << i->first->GetIfIndex () << " expired");
+          ports.erase (i++);
+        }
+      else
+        {
+          ++i;
+        }
+    }
+}
+
+void
+EthernetSwitchNetDevice::AddMulticastMember (Mac48Address group, Ptr<NetDevice> port, uint16_t vid)
+{
+  NS_LOG_FUNCTION (group << port << vid);
+  NS_ASSERT (group.IsGroup ());
+  m_groups[GroupKey (vid, group)][port] = Simulator::GetMaximumSimulationTime ();
+}
+
+void
+EthernetSwitchNetDevice::RemoveMulticastMember (Mac48Address group, Ptr<NetDevice> port, uint16_t vid)
+{
+  NS_LOG_FUNCTION (group << port << vid);
+  GroupTable::iterator i = m_groups.find (GroupKey (vid, group));
+  if (i != m_groups.end ())
+    {
+      i->second.erase (port);
+      if (i->second.empty ())
+        {
+          m_groups.erase (i);
+        }
+    }
+}
+
+void
+EthernetSwitchNetDevice::Report (Mac48Address group, Ptr<NetDevice> port, uint16_t vid, bool join)
+{
+  NS_LOG_LOGIC ((join ? "Join " : "Leave ") << group << " in VLAN " << vid << " on port " << port->GetIfIndex ());
+
+  //
+  // Link-local control groups (224.0.0.x, ff02::x) are always flooded.
+  //
+  uint8_t address[6];
+  group.CopyTo (address);
+  if ((address[0] == 0x01 && address[1] == 0x00 && address[2] == 0x5e && address[3] == 0x00 && address[4] == 0x00)
+      || (address[0] == 0x33 && address[1] == 0x33 && address[2] == 0x00 && address[3] == 0x00 && address[4] == 0x00))
+    {
+      return;
+    }
+
+  if (join)
+    {
+      Time &expiration = m_groups[GroupKey (vid, group)][port];
+      if (expiration != Simulator::GetMaximumSimulationTime ())
+        {
+          expiration = Simulator::Now () + m_membershipTimeout;
+        }
+    }
+  else
+    {
+      GroupTable::iterator i = m_groups.find (GroupKey (vid, group));
+      if (i == m_groups.end ())
+        {
+          return;
+        }
+      //
+      // Other members may sit behind the same port, behind a hub or another
+      // switch: rather than pruning the port at once, keep it until the
+      // query the router sends for the group gets answered, or not.
+      //
+      MemberPorts::iterator member = i->second.find (port);
+      if (member != i->second.end () && member->second != Simulator::GetMaximumSimulationTime ())
+        {
+          member->second = std::min (member->second, Simulator::Now () + m_lastMemberTimeout);
+        }
+    }
+}
+
+bool
+EthernetSwitchNetDevice::Snoop (Ptr<NetDevice> port, Ptr<const Packet> packet, uint16_t vid, uint16_t protocol)
+{
+  static const uint16_t IPV4_PROT_NUMBER = 0x0800;
+  static const uint16_t IPV6_PROT_NUMBER = 0x86dd;
+  static const uint8_t IGMP_PROT_NUMBER = 2;
+  static const uint8_t PIM_PROT_NUMBER = 103;
+  static const uint8_t HOP_BY_HOP_HEADER = 0;
+  static const uint8_t ICMPV6_PROT_NUMBER = 58;
+
+  if (protocol != IPV4_PROT_NUMBER && protocol != IPV6_PROT_NUMBER)
+    {
+      return false;
+    }
+
+  //
+  // Look at the network header first, and only copy the whole frame for the
+  // rare membership reports.
+  //
+  uint8_t header[48];
+  uint32_t size = packet->CopyData (header, sizeof (header));
+  uint32_t offset;
+  if (protocol == IPV4_PROT_NUMBER)
+    {
+      if (size < 20 || (header[0] >> 4) != 4)
+        {
+          return false;
+        }
+      if (header[9] == PIM_PROT_NUMBER)
+        {
+          LearnRouter (port, vid);
+          return false;
+        }
+      if (header[9] != IGMP_PROT_NUMBER)
+        {
+          return false;
+        }
+      offset = (header[0] & 0x0f) * 4;
+    }
+  else
+    {
+      if (size < 40 || (header[0] >> 4) != 6)
+        {
+          return false;
+        }
+      //
+      // MLD messages come after a hop-by-hop options header carrying the
+      // router alert option.
+      //
+      offset = 40;
+      uint8_t next = header[6];
+      if (next == HOP_BY_HOP_HEADER && size >= 42)
+        {
+          next = header[40];
+          offset += (header[41] + 1) * 8;
+        }
+      if (next == PIM_PROT_NUMBER)
+        {
+          LearnRouter (port, vid);
+          return false;
+        }
+      if (next != ICMPV6_PROT_NUMBER)
+        {
+          return false;
+        }
+    }
+
+  std::vector<uint8_t> buffer (packet->GetSize ());
+  packet->CopyData (&buffer[0], buffer.size ());
+  if (offset >= buffer.size ())
+    {
+      return false;
+    }
+  if (protocol == IPV4_PROT_NUMBER)
+    {
+      return SnoopIgmp (port, vid, &buffer[offset], buffer.size () - offset);
+    }
+  return SnoopMld (port, vid, &buffer[offset], buffer.size () - offset);
+}
+
+bool
+EthernetSwitchNetDevice::SnoopIgmp (Ptr<NetDevice> port, uint16_t vid, const uint8_t *igmp, uint32_t size)
+{
+  static const uint8_t QUERY = 0x11;
+  static const uint8_t V1_REPORT = 0x12;
+  static const uint8_t V2_REPORT = 0x16;
+  static const uint8_t V2_LEAVE = 0x17;
+  static const uint8_t V3_REPORT = 0x22;
+
+  if (size < 8)
+    {
+      return false;
+    }
+  switch (igmp[0])
+    {
+    case QUERY:
+      LearnRouter (port, vid);
+      return false;
+    case V1_REPORT:
+    case V2_REPORT:
+    case V2_LEAVE:
+      {
+        Ipv4Address group = Ipv4Address::Deserialize (igmp + 4);
+        Report (Mac48Address::GetMulticast (group), port, vid, igmp[0] != V2_LEAVE);
+        return true;
+      }
+    case V3_REPORT:
+      {
+        //
+        // Group records: type, aux data length (words), number of sources,
+        // group address, sources, aux data.  An INCLUDE of no source is a
+        // leave, anything else a join.
+        //
+        uint32_t nRecords = (igmp[6] << 8) | igmp[7];
+        uint32_t offset = 8;
+        for (uint32_t i = 0; i < nRecords && offset + 8 <= size; ++i)
+          {
+            const uint8_t *record = igmp + offset;
+            uint8_t type = record[0];
+            uint32_t nSources = (record[2] << 8) | record[3];
+            Ipv4Address group = Ipv4Address::Deserialize (record + 4);
+            bool leave = (type == 1 || type == 3) && nSources == 0;
+            Report (Mac48Address::GetMulticast (group), port, vid, !leave);
+            offset += 8 + nSources * 4 + record[1] * 4;
+          }
+        return true;
+      }
+    default:
+      return false;
+    }
+}
+
+bool
+EthernetSwitchNetDevice::SnoopMld (Ptr<NetDevice> port, uint16_t vid, const uint8_t *mld, uint32_t size)
+{
+  static const uint8_t QUERY = 130;
+  static const uint8_t V1_REPORT = 131;
+  static const uint8_t V1_DONE = 132;
+  static const uint8_t V2_REPORT = 143;
+
+  if (size < 8)
+    {
+      return false;
+    }
+  switch (mld[0])
+    {
+    case QUERY:
+      LearnRouter (port, vid);
+      return false;
+    case V1_REPORT:
+    case V1_DONE:
+      {
+        if (size < 24)
+          {
+            return false;
+          }
+        uint8_t address[16];
+        std::copy (mld + 8, mld + 24, address);
+        Report (Mac48Address::GetMulticast (Ipv6Address (address)), port, vid, mld[0] != V1_DONE);
+        return true;
+      }
+    case V2_REPORT:
+      {
+        uint32_t nRecords = (mld[6] << 8) | mld[7];
+        uint32_t offset = 8;
+        for (uint32_t i = 0; i < nRecords && offset + 20 <= size; ++i)
+          {
+            const uint8_t *record = mld + offset;
+            uint8_t type = record[0];
+            uint32_t nSources = (record[2] << 8) | record[3];
+            uint8_t address[16];
+            std::copy (record + 4, record + 20, address);
+            bool leave = (type == 1 || type == 3) && nSources == 0;
+            Report (Mac48Address::GetMulticast (Ipv6Address (address)), port, vid, !leave);
+            offset += 20 + nSources * 16 + record[1] * 4;
+          }
+        return true;
+      }
+    default:
+      return false;
+    }
+}
+
+void
+EthernetSwitchNetDevice::SetIfIndex (const uint32_t index)
+{
+  m_ifIndex = index;
+}
+
+uint32_t
+EthernetSwitchNetDevice::GetIfIndex (void) const
+{
+  return m_ifIndex;
+}
+
+Ptr<Channel>
+EthernetSwitchNetDevice::GetChannel (void) const
+{
+  return m_channel;
+}
+
+void
+EthernetSwitchNetDevice::SetAddress (Address address)
+{
+  m_address = Mac48Address::ConvertFrom (address);
+}
+
+Address
+EthernetSwitchNetDevice::GetAddress (void) const
+{
+  return m_address;
+}
+
+bool
+EthernetSwitchNetDevice::SetMtu (const uint16_t mtu)
+{
+  m_mtu = mtu;
+  return true;
+}
+
+uint16_t
+EthernetSwitchNetDevice::GetMtu (void) const
+{
+  return m_mtu;
+}
+
+bool
+EthernetSwitchNetDevice::IsLinkUp (void) const
+{
+  return true;
+}
+
+void
+EthernetSwitchNetDevice::AddLinkChangeCallback (Callback<void> callback)
+{
+  m_linkChangeCallbacks.ConnectWithoutContext (callback);
+}
+
+bool
+EthernetSwitchNetDevice::IsBroadcast (void) const
+{
+  return true;
+}
+
+Address
+EthernetSwitchNetDevice::GetBroadcast (void) const
+{
+  return Mac48Address ("ff:ff:ff:ff:ff:ff");
+}
+
+bool
+EthernetSwitchNetDevice::IsMulticast (void) const
+{
+  return true;
+}
+
+Address
+EthernetSwitchNetDevice::GetMulticast (Ipv4Address multicastGroup) const
+{
+  return Mac48Address::GetMulticast (multicastGroup);
+}
+
+Address
+EthernetSwitchNetDevice::GetMulticast (Ipv6Address addr) const
+{
+  return Mac48Address::GetMulticast (addr);
+}
+
+bool
+EthernetSwitchNetDevice::IsPointToPoint (void) const
+{
+  return false;
+}
+
+bool
+EthernetSwitchNetDevice::IsBridge (void) const
+{
+  return true;
+}
+
+bool
+EthernetSwitchNetDevice::Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber)
+{
+  NS_LOG_FUNCTION (packet << dest << protocolNumber);
+  return SendFrom (packet, m_address, dest, protocolNumber);
+}
+
+bool
+EthernetSwitchNetDevice::SendFrom (Ptr<Packet> packet, const Address& src, const Address& dest, uint16_t protocolNumber)
+{
+  NS_LOG_FUNCTION (packet << src << dest << protocolNumber);
+  Mac48Address dst48 = Mac48Address::ConvertFrom (dest);
+
+  //
+  // The frames of the switch itself belong to the VLAN of their tag, if
+  // any, and to VLAN 0 otherwise.
+  //
+  EthernetVlanTag tag;
+  packet->PeekPacketTag (tag);
+  uint16_t vid = tag.GetVid ();
+
+  if (!dst48.IsBroadcast () && !dst48.IsGroup ())
+    {
+      Ptr<NetDevice> outPort = LookupPort (dst48, vid);
+      if (outPort != 0)
+        {
+          outPort = SelectEgress (outPort, packet, protocolNumber, Mac48Address::ConvertFrom (src), dst48);
+          return IsVlanMember (outPort, vid) && outPort->SendFrom (packet, src, dest, protocolNumber);
+        }
+    }
+
+  Flood (0, packet, vid, protocolNumber, Mac48Address::ConvertFrom (src), dst48);
+  return true;
+}
+
+Ptr<Node>
+EthernetSwitchNetDevice::GetNode (void) const
+{
+  return m_node;
+}
+
+void
+EthernetSwitchNetDevice::SetNode (Ptr<Node> node)
+{
+  m_node = node;
+}
+
+bool
+EthernetSwitchNetDevice::NeedsArp (void) const
+{
+  return true;
+}
+
+void
+EthernetSwitchNetDevice::SetReceiveCallback (NetDevice::ReceiveCallback cb)
+{
+  m_rxCallback = cb;
+}
+
+void
+EthernetSwitchNetDevice::SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb)
+{
+  m_promiscRxCallback = cb;
+}
+
+bool
+EthernetSwitchNetDevice::SupportsSendFrom (void) const
+{
+  return true;
+}
+
+} // namespace ns3
@@ -0,0 +1,302 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_SWITCH_NET_DEVICE_H
+#define ETHERNET_SWITCH_NET_DEVICE_H
+
+#include <map>
+#include <vector>
+#include "ns3/net-device.h"
+#include "ns3/mac48-address.h"
+#include "ns3/nstime.h"
+#include "ns3/traced-callback.h"
+
+namespace ns3 {
+
+class Node;
+class BridgeChannel;
+class EthernetEcmpGroup;
+class EthernetSnapshotWriter;
+class EthernetSnapshotReader;
+
+/**
+ * \brief A learning Ethernet switch with a static forwarding table.
+ *
+ * Works like BridgeNetDevice: the switch ports are net devices of the node
+ * (normally EthernetNetDevice) whose frames are received promiscuously and
+ * forwarded by destination MAC address.  On top of the learned entries the
+ * forwarding table holds static entries, which never expire and are never
+ * overridden by learning.  EthernetHelper::PopulateForwardingTables fills
+ * them for a whole topology; with the EnableLearning attribute false the
+ * switch then relies on them alone and floods unknown destinations.  When
+ * the link of a port goes down, the entries learned on it are flushed.
+ *
+ * With the Snooping attribute on, the switch listens to the IGMP (v1, v2
+ * and v3) and MLD (v1 and v2) membership reports crossing it and forwards
+ * the frames of a reported group only to the ports its members sit
+ * behind, and to the multicast router ports.  Groups nobody reported,
+ * including the link-local control groups, are flooded as usual.  A port
+ * becomes a router port for RouterTimeout when an IGMP or MLD query or a
+ * PIM message is received on it; membership reports are only forwarded
+ * to the router ports, or flooded while there is none.  A leave does not
+ * prune the port at once but shortens its membership to
+ * LastMemberTimeout, for the other members behind it to answer the query
+ * of the router.
+ *
+ * Each VLAN has its own forwarding and group tables, and frames are only
+ * forwarded and flooded to the ports that are members of their VLAN.  The
+ * VLAN of a frame is given by the EthernetVlanTag its ingress port put on
+ * it when the port is a VLAN-aware EthernetNetDevice (see
+ * EthernetNetDevice::SetVlanMode); the frames of any other port belong to
+ * VLAN 0, which only such ports are members of.  Static entries added for
+ * VLAN 0 apply to every VLAN.
+ */
+class EthernetSwitchNetDevice : public NetDevice
+{
+public:
+  static TypeId GetTypeId (void);
+
+  EthernetSwitchNetDevice ();
+  virtual ~EthernetSwitchNetDevice ();
+
+  /**
+   * Add a port to the switch.  The port must belong to the same node and
+   * support SendFrom.
+   *
+   * @param port the net device to switch frames through
+   */
+  void AddSwitchPort (Ptr<NetDevice> port);
+  /**
+   * @return the number of ports of the switch
+   */
+  uint32_t GetNSwitchPorts (void) const;
+  /**
+   * @param n the index of the port
+   * @return the port
+   */
+  Ptr<NetDevice> GetSwitchPort (uint32_t n) const;
+  /**
+   * Forward frames to an address through a port, for good.
+   *
+   * @param address the destination MAC address
+   * @param port the switch port leading to it
+   * @param vid the VLAN of the entry, 0 for all
+   */
+  void AddStaticEntry (Mac48Address address, Ptr<NetDevice> port, uint16_t vid = 0);
+  /**
+   * Remove all the static entries.
+   */
+  void ClearStaticEntries (void);
+  /**
+   * @param address a destination MAC address
+   * @param vid the VLAN of the frames
+   * @return the port frames to the address are forwarded to, or 0 if the
+   * address is unknown
+   */
+  Ptr<NetDevice> LookupPort (Mac48Address address, uint16_t vid = 0);
+  /**
+   * Spread the frames sent to any member of the group over all its
+   * members, by flow hash.  The members must be ports of the switch, and
+   * are flooded to as a single port.  Members whose link is down are left
+   * out until it comes back up.
+   *
+   * @param group the group of parallel ports
+   */
+  void AddEcmpGroup (Ptr<EthernetEcmpGroup> group);
+  /**
+   * Forward the frames of a multicast group through a port, for good, as
+   * if a member had reported itself there.
+   *
+   * @param group the group MAC address
+   * @param port the switch port a member sits behind
+   * @param vid the VLAN of the group
+   */
+  void AddMulticastMember (Mac48Address group, Ptr<NetDevice> port, uint16_t vid = 0);
+  /**
+   * Stop forwarding the frames of a multicast group through a port.
+   *
+   * @param group the group MAC address
+   * @param port the switch port
+   * @param vid the VLAN of the group
+   */
+  void RemoveMulticastMember (Mac48Address group, Ptr<NetDevice> port, uint16_t vid = 0);
+  /**
+   * Write the learned forwarding entries, the snooped multicast
+   * memberships and the multicast router ports which have not expired yet
+   * to a snapshot.  Static entries
+   * and members are part of the configuration and are not saved.
+   *
+   * @param writer the snapshot to write to
+   */
+  void SaveState (EthernetSnapshotWriter &writer) const;
+  /**
+   * Restore the entries SaveState wrote, as of now, on a switch with the
+   * same ports.  Static entries are kept over restored ones.
+   *
+   * @param reader the snapshot to read from
+   */
+  void RestoreState (EthernetSnapshotReader &reader);
+
+  // The following methods are inherited from NetDevice base class.
+  virtual void SetIfIndex (const uint32_t index);
+  virtual uint32_t GetIfIndex (void) const;
+  virtual Ptr<Channel> GetChannel (void) const;
+  virtual void SetAddress (Address address);
+  virtual Address GetAddress (void) const;
+  virtual bool SetMtu (const uint16_t mtu);
+  virtual uint16_t GetMtu (void) const;
+  virtual bool IsLinkUp (void) const;
+  virtual void AddLinkChangeCallback (Callback<void> callback);
+  virtual bool IsBroadcast (void) const;
+  virtual Address GetBroadcast (void) const;
+  virtual bool IsMulticast (void) const;
+  virtual Address GetMulticast (Ipv4Address multicastGroup) const;
+  virtual Address GetMulticast (Ipv6Address addr) const;
+  virtual bool IsPointToPoint (void) const;
+  virtual bool IsBridge (void) const;
+  virtual bool Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber);
+  virtual bool SendFrom (Ptr<Packet> packet, const Address& source, const Address& dest, uint16_t protocolNumber);
+  virtual Ptr<Node> GetNode (void) const;
+  virtual void SetNode (Ptr<Node> node);
+  virtual bool NeedsArp (void) const;
+  virtual void SetReceiveCallback (NetDevice::ReceiveCallback cb);
+  virtual void SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb);
+  virtual bool SupportsSendFrom (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  EthernetSwitchNetDevice &operator = (const EthernetSwitchNetDevice &o);
+  EthernetSwitchNetDevice (const EthernetSwitchNetDevice &o);
+
+  bool ReceiveFromDevice (Ptr<NetDevice> port, Ptr<const Packet> packet, uint16_t protocol,
+                          const Address &source, const Address &destination, PacketType packetType);
+  void ForwardUnicast (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet, uint16_t vid,
+                       uint16_t protocol, Mac48Address src, Mac48Address dst);
+  void ForwardBroadcast (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet, uint16_t vid,
+                         uint16_t protocol, Mac48Address src, Mac48Address dst);
+  void ForwardMulticast (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet, uint16_t vid,
+                         uint16_t protocol, Mac48Address src, Mac48Address dst);
+  void Learn (Mac48Address source, Ptr<NetDevice> port, uint16_t vid);
+  /**
+   * @return the VLAN a frame received or to be sent through a port belongs
+   * to
+   */
+  static uint16_t GetVlan (Ptr<NetDevice> port, Ptr<const Packet> packet);
+  /**
+   * @return true if a port carries the frames of a VLAN
+   */
+  static bool IsVlanMember (Ptr<NetDevice> port, uint16_t vid);
+  /**
+   * Forward a membership report toward the multicast routers.
+   */
+  void ForwardReport (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet, uint16_t vid,
+                      uint16_t protocol, Mac48Address src, Mac48Address dst);
+  /**
+   * Update the multicast memberships and router ports from the IGMP, MLD
+   * or PIM message carried by a frame, if any.
+   *
+   * @return true if the frame carries a membership report or leave
+   */
+  bool Snoop (Ptr<NetDevice> port, Ptr<const Packet> packet, uint16_t vid, uint16_t protocol);
+  bool SnoopIgmp (Ptr<NetDevice> port, uint16_t vid, const uint8_t *igmp, uint32_t size);
+  bool SnoopMld (Ptr<NetDevice> port, uint16_t vid, const uint8_t *mld, uint32_t size);
+  void Report (Mac48Address group, Ptr<NetDevice> port, uint16_t vid, bool join);
+  void LearnRouter (Ptr<NetDevice> port, uint16_t vid);
+  Ptr<EthernetEcmpGroup> FindEcmpGroup (Ptr<NetDevice> port) const;
+  /**
+   * @return the members of the ECMP group of port whose link is up, or 0
+   * if port belongs to no group
+   */
+  Ptr<EthernetEcmpGroup> FindActiveEcmpGroup (Ptr<NetDevice> port) const;
+  void UpdateEcmpGroups (void);
+  /**
+   * Forget the addresses, the multicast memberships and the multicast
+   * routers learned on the ports whose link is down.
+   */
+  void FlushDownPorts (void);
+  /**
+   * @return the port to send a frame through instead of port, which
+   * differs when port belongs to an ECMP group
+   */
+  Ptr<NetDevice> SelectEgress (Ptr<NetDevice> port, Ptr<const Packet> packet,
+                               uint16_t protocol, Mac48Address src, Mac48Address dst) const;
+  void Flood (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet, uint16_t vid,
+              uint16_t protocol, Mac48Address src, Mac48Address dst);
+
+  struct ForwardingEntry
+  {
+    Ptr<NetDevice> port;
+    Time expirationTime;
+    bool isStatic;
+  };
+  typedef std::map<Mac48Address, ForwardingEntry> ForwardingTable;
+  /**
+   * The forwarding table of every VLAN.
+   */
+  typedef std::map<uint16_t, ForwardingTable> VlanTables;
+  /**
+   * The ports behind which members of a group sit, with the expiration
+   * time of the membership.
+   */
+  typedef std::map<Ptr<NetDevice>, Time> MemberPorts;
+  typedef std::pair<uint16_t, Mac48Address> GroupKey;
+  typedef std::map<GroupKey, MemberPorts> GroupTable;
+
+  /**
+   * Remove the ports whose expiration time has passed.
+   */
+  static void ExpirePorts (MemberPorts &ports);
+
+  Ptr<Node> m_node;
+  Ptr<BridgeChannel> m_channel;
+  std::vector<Ptr<NetDevice> > m_ports;
+  uint32_t m_ifIndex;
+  uint16_t m_mtu;
+  Mac48Address m_address;
+
+  bool m_enableLearning;
+  Time m_expirationTime;
+  VlanTables m_tables;
+  std::vector<Ptr<EthernetEcmpGroup> > m_ecmpGroups;
+  /**
+   * The members of each group of m_ecmpGroups whose link is up.
+   */
+  std::vector<Ptr<EthernetEcmpGroup> > m_activeEcmpGroups;
+
+  bool m_snooping;
+  Time m_membershipTimeout;
+  Time m_lastMemberTimeout;
+  Time m_routerTimeout;
+  GroupTable m_groups;
+  /**
+   * The multicast router ports of every VLAN, with their expiration time.
+   */
+  std::map<uint16_t, MemberPorts> m_routerPorts;
+
+  NetDevice::ReceiveCallback m_rxCallback;
+  NetDevice::PromiscReceiveCallback m_promiscRxCallback;
+  TracedCallback<> m_linkChangeCallbacks;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_SWITCH_NET_DEVICE_H */
@@ -0,0 +1,103 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include "ethernet-timestamp-tag.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (EthernetTimestampTag);
+
+TypeId
+EthernetTimestampTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetTimestampTag")
+    .SetParent<Tag> ()
+    .AddConstructor<EthernetTimestampTag> ()
+    ;
+  return tid;
+}
+
+TypeId
+EthernetTimestampTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+EthernetTimestampTag::EthernetTimestampTag ()
+{
+}
+
+EthernetTimestampTag::EthernetTimestampTag (Time t)
+  : m_origin (t),
+    m_hop (t)
+{
+}
+
+void
+EthernetTimestampTag::SetOrigin (Time t)
+{
+  m_origin = t;
+}
+
+Time
+EthernetTimestampTag::GetOrigin (void) const
+{
+  return m_origin;
+}
+
+void
+EthernetTimestampTag::SetHop (Time t)
+{
+  m_hop = t;
+}
+
+Time
+EthernetTimestampTag::GetHop (void) const
+{
+  return m_hop;
+}
+
+uint32_t
+EthernetTimestampTag::GetSerializedSize (void) const
+{
+  return 16;
+}
+
+void
+EthernetTimestampTag::Serialize (TagBuffer i) const
+{
+  i.WriteU64 (m_origin.GetTimeStep ());
+  i.WriteU64 (m_hop.GetTimeStep ());
+}
+
+void
+EthernetTimestampTag::Deserialize (TagBuffer i)
+{
+  m_origin = TimeStep (i.ReadU64 ());
+  m_hop = TimeStep (i.ReadU64 ());
+}
+
+void
+EthernetTimestampTag::Print (std::ostream &os) const
+{
+  os << "origin=" << m_origin << " hop=" << m_hop;
+}
+
+} // namespace ns3
@@ -0,0 +1,66 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_TIMESTAMP_TAG_H
+#define ETHERNET_TIMESTAMP_TAG_H
+
+#include "ns3/tag.h"
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * \brief Packet tag carrying the times a packet was handed to an
+ * EthernetNetDevice.
+ *
+ * The origin time is set by the first EthernetNetDevice::Send and kept
+ * along the path; the hop time is updated by every device the packet is
+ * sent through.
+ */
+class EthernetTimestampTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  EthernetTimestampTag ();
+  /**
+   * @param t the time the packet was first sent
+   */
+  EthernetTimestampTag (Time t);
+
+  void SetOrigin (Time t);
+  Time GetOrigin (void) const;
+  void SetHop (Time t);
+  Time GetHop (void) const;
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+private:
+  Time m_origin;
+  Time m_hop;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_TIMESTAMP_TAG_H */
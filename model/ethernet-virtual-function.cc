@@ -0,0 +1,413 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/node.h"
+#include "ns3/uinteger.h"
+#include "ns3/trace-source-accessor.h"
+#include "ethernet-virtual-function.h"
+#include "ethernet-net-device.h"
+#include "ethernet-snapshot.h"
+#include "ethernet-profiler.h"
+
+NS_LOG_COMPONENT_DEFINE ("EthernetVirtualFunction");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (EthernetVirtualFunction);
+
+TypeId
+EthernetVirtualFunction::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetVirtualFunction")
+    .SetParent<NetDevice> ()
+    .AddConstructor<EthernetVirtualFunction> ()
+    .AddAttribute ("Mtu", "The MAC-level Maximum Transmission Unit",
+                   UintegerValue (1500),
+                   MakeUintegerAccessor (&EthernetVirtualFunction::SetMtu,
+                                         &EthernetVirtualFunction::GetMtu),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("TxQueueLimit",
+                   "The number of frames waiting for the physical device.",
+                   UintegerValue (100),
+                   MakeUintegerAccessor (&EthernetVirtualFunction::m_txQueueLimit),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddTraceSource ("MacTx",
+                     "Trace source indicating a packet has arrived for transmission by this device",
+                     MakeTraceSourceAccessor (&EthernetVirtualFunction::m_macTxTrace))
+    .AddTraceSource ("MacTxDrop",
+                     "Trace source indicating a packet has been dropped by the device before transmission",
+                     MakeTraceSourceAccessor (&EthernetVirtualFunction::m_macTxDropTrace))
+    .AddTraceSource ("MacPromiscRx",
+                     "A packet has been received by this device, has been passed up from the physical layer "
+                     "and is being forwarded up the local protocol stack.  This is a promiscuous trace,",
+                     MakeTraceSourceAccessor (&EthernetVirtualFunction::m_macPromiscRxTrace))
+    .AddTraceSource ("MacRx",
+                     "A packet has been received by this device, has been passed up from the physical layer "
+                     "and is being forwarded up the local protocol stack.  This is a non-promiscuous trace,",
+                     MakeTraceSourceAccessor (&EthernetVirtualFunction::m_macRxTrace))
+    ;
+  return tid;
+}
+
+EthernetVirtualFunction::EthernetVirtualFunction ()
+  : m_node (0),
+    m_ifIndex (0)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+EthernetVirtualFunction::~EthernetVirtualFunction ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+EthernetVirtualFunction::DoDispose (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_txQueue.clear ();
+  m_device = 0;
+  m_node = 0;
+  m_rxCallback = MakeNullCallback<bool, Ptr<NetDevice>, Ptr<const Packet>, uint16_t, const Address &> ();
+  m_promiscRxCallback = MakeNullCallback<bool, Ptr<NetDevice>, Ptr<const Packet>, uint16_t, const Address &, const Address &, PacketType> ();
+  NetDevice::DoDispose ();
+}
+
+void
+EthernetVirtualFunction::SetPhysicalDevice (Ptr<EthernetNetDevice> device)
+{
+  NS_LOG_FUNCTION (device);
+  NS_ASSERT (m_device == 0);
+  m_device = device;
+  m_device->AddLinkChangeCallback (MakeCallback (&EthernetVirtualFunction::NotifyLinkChange, this));
+}
+
+Ptr<EthernetNetDevice>
+EthernetVirtualFunction::GetPhysicalDevice (void) const
+{
+  return m_device;
+}
+
+void
+EthernetVirtualFunction::NotifyLinkChange (void)
+{
+  if (!m_device->IsLinkUp ())
+    {
+      while (!m_txQueue.empty ())
+        {
+          m_macTxDropTrace (m_txQueue.front ().packet);
+          m_txQueue.pop_front ();
+        }
+    }
+  m_linkChangeCallbacks ();
+}
+
+uint32_t
+EthernetVirtualFunction::GetTxQueueLength (void) const
+{
+  return m_txQueue.size ();
+}
+
+bool
+EthernetVirtualFunction::TransmitNext (void)
+{
+  if (m_txQueue.empty ())
+    {
+      return false;
+    }
+  PendingFrame frame = m_txQueue.front ();
+  m_txQueue.pop_front ();
+  if (!m_device->SendFromVirtualFunction (frame.packet, frame.src, frame.dest, frame.protocol))
+    {
+      m_macTxDropTrace (frame.packet);
+    }
+  return true;
+}
+
+void
+EthernetVirtualFunction::Receive (Ptr<const Packet> packet, uint16_t protocol, const Address &from,
+                                  const Address &to, PacketType packetType)
+{
+  NS_LOG_FUNCTION (packet << protocol << from << to << packetType);
+
+  m_macPromiscRxTrace (packet);
+  if (!m_promiscRxCallback.IsNull ())
+    {
+      ETHERNET_PROFILE (DELIVER);
+      m_promiscRxCallback (this, packet, protocol, from, to, packetType);
+    }
+  if (packetType != PACKET_OTHERHOST && !m_rxCallback.IsNull ())
+    {
+      m_macRxTrace (packet);
+      ETHERNET_PROFILE (DELIVER);
+      m_rxCallback (this, packet, protocol, from);
+    }
+}
+
+void
+EthernetVirtualFunction::SaveState (EthernetSnapshotWriter &writer) const
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  writer.WriteU32 (m_txQueue.size ());
+  for (std::deque<PendingFrame>::const_iterator i = m_txQueue.begin (); i != m_txQueue.end (); ++i)
+    {
+      writer.WriteMac48Address (i->src);
+      writer.WriteMac48Address (i->dest);
+      writer.WriteU16 (i->protocol);
+      writer.WritePacket (i->packet);
+    }
+}
+
+void
+EthernetVirtualFunction::RestoreState (EthernetSnapshotReader &reader)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  uint32_t n = reader.ReadU32 ();
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      PendingFrame frame;
+      frame.src = reader.ReadMac48Address ();
+      frame.dest = reader.ReadMac48Address ();
+      frame.protocol = reader.ReadU16 ();
+      frame.packet = reader.ReadPacket ();
+      if (m_txQueue.size () >= m_txQueueLimit)
+        {
+          m_macTxDropTrace (frame.packet);
+          continue;
+        }
+      m_txQueue.push_back (frame);
+    }
+  if (m_device != 0)
+    {
+      m_device->ServeVirtualFunctions ();
+    }
+}
+
+void
+EthernetVirtualFunction::SetIfIndex (const uint32_t index)
+{
+  m_ifIndex = index;
+}
+
+uint32_t
+EthernetVirtualFunction::GetIfIndex (void) const
+{
+  return m_ifIndex;
+}
+
+Ptr<Channel>
+EthernetVirtualFunction::GetChannel (void) const
+{
+  if (m_device == 0)
+    {
+      return 0;
+    }
+  return m_device->GetChannel ();
+}
+
+void
+EthernetVirtualFunction::SetAddress (Address address)
+{
+  m_address = Mac48Address::ConvertFrom (address);
+  if (m_device != 0)
+    {
+      m_device->RebuildVirtualFunctionTable ();
+    }
+}
+
+Address
+EthernetVirtualFunction::GetAddress (void) const
+{
+  return m_address;
+}
+
+bool
+EthernetVirtualFunction::SetMtu (const uint16_t mtu)
+{
+  m_mtu = mtu;
+  return true;
+}
+
+uint16_t
+EthernetVirtualFunction::GetMtu (void) const
+{
+  return m_mtu;
+}
+
+bool
+EthernetVirtualFunction::IsLinkUp (void) const
+{
+  return m_device != 0 && m_device->IsLinkUp ();
+}
+
+void
+EthernetVirtualFunction::AddLinkChangeCallback (Callback<void> callback)
+{
+  m_linkChangeCallbacks.ConnectWithoutContext (callback);
+}
+
+bool
+EthernetVirtualFunction::IsBroadcast (void) const
+{
+  return true;
+}
+
+Address
+EthernetVirtualFunction::GetBroadcast (void) const
+{
+  return Mac48Address ("ff:ff:ff:ff:ff:ff");
+}
+
+bool
+EthernetVirtualFunction::IsMulticast (void) const
+{
+  return true;
+}
+
+Address
+EthernetVirtualFunction::GetMulticast (Ipv4Address multicastGroup) const
+{
+  return Mac48Address::GetMulticast (multicastGroup);
+}
+
+Address
+EthernetVirtualFunction::GetMulticast (Ipv6Address addr) const
+{
+  return Mac48Address::GetMulticast (addr);
+}
+
+bool
+EthernetVirtualFunction::IsPointToPoint (void) const
+{
+  return false;
+}
+
+bool
+EthernetVirtualFunction::IsBridge (void) const
+{
+  return false;
+}
+
+bool
+EthernetVirtualFunction::Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber)
+{
+  NS_LOG_FUNCTION (packet << dest << protocolNumber);
+  return SendFrom (packet, m_address, dest, protocolNumber);
+}
+
+bool
+EthernetVirtualFunction::SendFrom (Ptr<Packet> packet, const Address& src, const Address& dest, uint16_t protocolNumber)
+{
+  NS_LOG_FUNCTION (packet << src << dest << protocolNumber);
+
+  m_macTxTrace (packet);
+  if (m_device == 0)
+    {
+      m_macTxDropTrace (packet);
+      return false;
+    }
+
+  Mac48Address from = Mac48Address::ConvertFrom (src);
+  Mac48Address to = Mac48Address::ConvertFrom (dest);
+  if (!to.IsGroup ())
+    {
+      if (to == Mac48Address::ConvertFrom (m_device->GetAddress ()))
+        {
+          NS_LOG_LOGIC ("Switching frame to the physical device internally");
+          m_device->ReceiveFromVirtualFunction (packet, protocolNumber, from, to, PACKET_HOST);
+          return true;
+        }
+      Ptr<EthernetVirtualFunction> peer = m_device->FindVirtualFunction (to);
+      if (peer != 0)
+        {
+          NS_LOG_LOGIC ("Switching frame to " << to << " internally");
+          peer->Receive (packet, protocolNumber, src, dest, PACKET_HOST);
+          return true;
+        }
+    }
+  else
+    {
+      PacketType packetType = to.IsBroadcast () ? PACKET_BROADCAST : PACKET_MULTICAST;
+      for (uint32_t i = 0; i < m_device->GetNVirtualFunctions (); ++i)
+        {
+          Ptr<EthernetVirtualFunction> peer = m_device->GetVirtualFunction (i);
+          if (peer != this)
+            {
+              peer->Receive (packet->Copy (), protocolNumber, src, dest, packetType);
+            }
+        }
+      m_device->ReceiveFromVirtualFunction (packet->Copy (), protocolNumber, from, to, packetType);
+    }
+
+  if (m_txQueue.size () >= m_txQueueLimit)
+    {
+      NS_LOG_LOGIC ("Transmit queue full, dropping");
+      m_macTxDropTrace (packet);
+      return false;
+    }
+  PendingFrame frame;
+  frame.packet = packet;
+  frame.src = Mac48Address::ConvertFrom (src);
+  frame.dest = to;
+  frame.protocol = protocolNumber;
+  m_txQueue.push_back (frame);
+  m_device->ServeVirtualFunctions ();
+  return true;
+}
+
+Ptr<Node>
+EthernetVirtualFunction::GetNode (void) const
+{
+  return m_node;
+}
+
+void
+EthernetVirtualFunction::SetNode (Ptr<Node> node)
+{
+  m_node = node;
+}
+
+bool
+EthernetVirtualFunction::NeedsArp (void) const
+{
+  return true;
+}
+
+void
+EthernetVirtualFunction::SetReceiveCallback (NetDevice::ReceiveCallback cb)
+{
+  m_rxCallback = cb;
+}
+
+void
+EthernetVirtualFunction::SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb)
+{
+  m_promiscRxCallback = cb;
+}
+
+bool
+EthernetVirtualFunction::SupportsSendFrom (void) const
+{
+  return true;
+}
+
+} // namespace ns3
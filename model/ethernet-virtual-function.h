@@ -0,0 +1,164 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_VIRTUAL_FUNCTION_H
+#define ETHERNET_VIRTUAL_FUNCTION_H
+
+#include <deque>
+#include "ns3/net-device.h"
+#include "ns3/mac48-address.h"
+#include "ns3/traced-callback.h"
+
+namespace ns3 {
+
+class Node;
+class EthernetNetDevice;
+class EthernetSnapshotWriter;
+class EthernetSnapshotReader;
+
+/**
+ * \brief A virtual function of an EthernetNetDevice, as with SR-IOV.
+ *
+ * A virtual function is a NetDevice of its own, with its own MAC address,
+ * transmit queue and receive callbacks, multiplexed on the channel of its
+ * physical device (see EthernetNetDevice::AddVirtualFunction).  The
+ * physical device delivers the frames it receives for the address of a
+ * virtual function straight to it, and the broadcast and multicast frames
+ * to all of them.  It takes the frames to send from the transmit queues
+ * of its virtual functions in turn, one whenever its own transmit queue
+ * is empty, so each function gets a fair share of the link.
+ *
+ * Like the embedded bridge of a NIC, frames between the virtual functions
+ * of a device and the device itself are switched internally and never
+ * reach the wire; broadcast and multicast frames go both ways.
+ */
+class EthernetVirtualFunction : public NetDevice
+{
+public:
+  static TypeId GetTypeId (void);
+
+  EthernetVirtualFunction ();
+  virtual ~EthernetVirtualFunction ();
+
+  /**
+   * Called by EthernetNetDevice::AddVirtualFunction.
+   *
+   * @param device the physical device of this function
+   */
+  void SetPhysicalDevice (Ptr<EthernetNetDevice> device);
+  /**
+   * @return the physical device of this function
+   */
+  Ptr<EthernetNetDevice> GetPhysicalDevice (void) const;
+  /**
+   * @return the number of frames waiting in the transmit queue
+   */
+  uint32_t GetTxQueueLength (void) const;
+  /**
+   * Hand the frame at the head of the transmit queue to the physical
+   * device.
+   *
+   * @return false if the transmit queue was empty
+   */
+  bool TransmitNext (void);
+  /**
+   * Pass up a frame received by the physical device for this function.
+   */
+  void Receive (Ptr<const Packet> packet, uint16_t protocol, const Address &from,
+                const Address &to, PacketType packetType);
+  /**
+   * Write the frames waiting in the transmit queue to a snapshot.
+   *
+   * @param writer the snapshot to write to
+   */
+  void SaveState (EthernetSnapshotWriter &writer) const;
+  /**
+   * Queue the frames SaveState wrote again, as far as the transmit queue
+   * takes them.
+   *
+   * @param reader the snapshot to read from
+   */
+  void RestoreState (EthernetSnapshotReader &reader);
+
+  // The following methods are inherited from NetDevice base class.
+  virtual void SetIfIndex (const uint32_t index);
+  virtual uint32_t GetIfIndex (void) const;
+  virtual Ptr<Channel> GetChannel (void) const;
+  virtual void SetAddress (Address address);
+  virtual Address GetAddress (void) const;
+  virtual bool SetMtu (const uint16_t mtu);
+  virtual uint16_t GetMtu (void) const;
+  virtual bool IsLinkUp (void) const;
+  virtual void AddLinkChangeCallback (Callback<void> callback);
+  virtual bool IsBroadcast (void) const;
+  virtual Address GetBroadcast (void) const;
+  virtual bool IsMulticast (void) const;
+  virtual Address GetMulticast (Ipv4Address multicastGroup) const;
+  virtual Address GetMulticast (Ipv6Address addr) const;
+  virtual bool IsPointToPoint (void) const;
+  virtual bool IsBridge (void) const;
+  virtual bool Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber);
+  virtual bool SendFrom (Ptr<Packet> packet, const Address& source, const Address& dest, uint16_t protocolNumber);
+  virtual Ptr<Node> GetNode (void) const;
+  virtual void SetNode (Ptr<Node> node);
+  virtual bool NeedsArp (void) const;
+  virtual void SetReceiveCallback (NetDevice::ReceiveCallback cb);
+  virtual void SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb);
+  virtual bool SupportsSendFrom (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  EthernetVirtualFunction &operator = (const EthernetVirtualFunction &o);
+  EthernetVirtualFunction (const EthernetVirtualFunction &o);
+
+  void NotifyLinkChange (void);
+
+  struct PendingFrame
+  {
+    Ptr<Packet> packet;
+    Mac48Address src;
+    Mac48Address dest;
+    uint16_t protocol;
+  };
+
+  Ptr<Node> m_node;
+  Ptr<EthernetNetDevice> m_device;
+  uint32_t m_ifIndex;
+  uint16_t m_mtu;
+  Mac48Address m_address;
+
+  uint32_t m_txQueueLimit;
+  std::deque<PendingFrame> m_txQueue;
+
+  TracedCallback<Ptr<const Packet> > m_macTxTrace;
+  TracedCallback<Ptr<const Packet> > m_macTxDropTrace;
+  TracedCallback<Ptr<const Packet> > m_macRxTrace;
+  TracedCallback<Ptr<const Packet> > m_macPromiscRxTrace;
+  TracedCallback<> m_linkChangeCallbacks;
+
+  NetDevice::ReceiveCallback m_rxCallback;
+  NetDevice::PromiscReceiveCallback m_promiscRxCallback;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_VIRTUAL_FUNCTION_H */
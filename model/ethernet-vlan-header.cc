@@ -0,0 +1,128 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include "ns3/assert.h"
+#include "ethernet-vlan-header.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (EthernetVlanHeader);
+
+TypeId
+EthernetVlanHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetVlanHeader")
+    .SetParent<Header> ()
+    .AddConstructor<EthernetVlanHeader> ()
+    ;
+  return tid;
+}
+
+TypeId
+EthernetVlanHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+EthernetVlanHeader::EthernetVlanHeader ()
+  : m_tci (0),
+    m_lengthType (0)
+{
+}
+
+void
+EthernetVlanHeader::SetVid (uint16_t vid)
+{
+  NS_ASSERT (vid < 4095);
+  m_tci = (m_tci & 0xf000) | vid;
+}
+
+uint16_t
+EthernetVlanHeader::GetVid (void) const
+{
+  return m_tci & 0x0fff;
+}
+
+void
+EthernetVlanHeader::SetPcp (uint8_t pcp)
+{
+  NS_ASSERT (pcp < 8);
+  m_tci = (m_tci & 0x1fff) | (pcp << 13);
+}
+
+uint8_t
+EthernetVlanHeader::GetPcp (void) const
+{
+  return m_tci >> 13;
+}
+
+void
+EthernetVlanHeader::SetDei (bool dei)
+{
+  m_tci = (m_tci & 0xefff) | (dei ? 0x1000 : 0);
+}
+
+bool
+EthernetVlanHeader::GetDei (void) const
+{
+  return m_tci & 0x1000;
+}
+
+void
+EthernetVlanHeader::SetLengthType (uint16_t lengthType)
+{
+  m_lengthType = lengthType;
+}
+
+uint16_t
+EthernetVlanHeader::GetLengthType (void) const
+{
+  return m_lengthType;
+}
+
+uint32_t
+EthernetVlanHeader::GetSerializedSize (void) const
+{
+  return SIZE;
+}
+
+void
+EthernetVlanHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteHtonU16 (m_tci);
+  start.WriteHtonU16 (m_lengthType);
+}
+
+uint32_t
+EthernetVlanHeader::Deserialize (Buffer::Iterator start)
+{
+  m_tci = start.ReadNtohU16 ();
+  m_lengthType = start.ReadNtohU16 ();
+  return SIZE;
+}
+
+void
+EthernetVlanHeader::Print (std::ostream &os) const
+{
+  os << "vid=" << GetVid () << " pcp=" << (uint32_t) GetPcp ()
+     << " dei=" << GetDei () << " length/type=0x" << std::hex << m_lengthType << std::dec;
+}
+
+} // namespace ns3
@@ -0,0 +1,86 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_VLAN_HEADER_H
+#define ETHERNET_VLAN_HEADER_H
+
+#include "ns3/header.h"
+
+namespace ns3 {
+
+/**
+ * \brief The 802.1Q tag of an Ethernet frame.
+ *
+ * Holds the tag control information (priority, drop eligibility and VLAN
+ * identifier) and the length/type of the encapsulated payload.  The tag
+ * protocol identifier, 0x8100, is the length/type of the EthernetHeader in
+ * front of it, so a tagged frame reads: EthernetHeader (0x8100),
+ * EthernetVlanHeader, then the LLC/SNAP header if the inner length/type is
+ * a length, and the payload.
+ */
+class EthernetVlanHeader : public Header
+{
+public:
+  /**
+   * The length/type announcing an 802.1Q tag.
+   */
+  static const uint16_t TPID = 0x8100;
+  /**
+   * The number of bytes a tag adds to a frame.
+   */
+  static const uint32_t SIZE = 4;
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  EthernetVlanHeader ();
+
+  /**
+   * @param vid the VLAN identifier, 0 for a priority-tagged frame
+   */
+  void SetVid (uint16_t vid);
+  uint16_t GetVid (void) const;
+  /**
+   * @param pcp the priority code point, 0 to 7
+   */
+  void SetPcp (uint8_t pcp);
+  uint8_t GetPcp (void) const;
+  void SetDei (bool dei);
+  bool GetDei (void) const;
+  /**
+   * @param lengthType the EtherType of the payload, or its length if the
+   * payload starts with an LLC/SNAP header
+   */
+  void SetLengthType (uint16_t lengthType);
+  uint16_t GetLengthType (void) const;
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+private:
+  uint16_t m_tci;
+  uint16_t m_lengthType;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_VLAN_HEADER_H */
@@ -0,0 +1,109 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#include "ns3/assert.h"
+#include "ethernet-vlan-tag.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (EthernetVlanTag);
+
+TypeId
+EthernetVlanTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EthernetVlanTag")
+    .SetParent<Tag> ()
+    .AddConstructor<EthernetVlanTag> ()
+    ;
+  return tid;
+}
+
+TypeId
+EthernetVlanTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+EthernetVlanTag::EthernetVlanTag ()
+  : m_vid (0),
+    m_pcp (0)
+{
+}
+
+EthernetVlanTag::EthernetVlanTag (uint16_t vid, uint8_t pcp)
+  : m_vid (vid),
+    m_pcp (pcp)
+{
+  NS_ASSERT (vid < 4095 && pcp < 8);
+}
+
+void
+EthernetVlanTag::SetVid (uint16_t vid)
+{
+  NS_ASSERT (vid < 4095);
+  m_vid = vid;
+}
+
+uint16_t
+EthernetVlanTag::GetVid (void) const
+{
+  return m_vid;
+}
+
+void
+EthernetVlanTag::SetPcp (uint8_t pcp)
+{
+  NS_ASSERT (pcp < 8);
+  m_pcp = pcp;
+}
+
+uint8_t
+EthernetVlanTag::GetPcp (void) const
+{
+  return m_pcp;
+}
+
+uint32_t
+EthernetVlanTag::GetSerializedSize (void) const
+{
+  return 3;
+}
+
+void
+EthernetVlanTag::Serialize (TagBuffer i) const
+{
+  i.WriteU16 (m_vid);
+  i.WriteU8 (m_pcp);
+}
+
+void
+EthernetVlanTag::Deserialize (TagBuffer i)
+{
+  m_vid = i.ReadU16 ();
+  m_pcp = i.ReadU8 ();
+}
+
+void
+EthernetVlanTag::Print (std::ostream &os) const
+{
+  os << "vid=" << m_vid << " pcp=" << (uint32_t) m_pcp;
+}
+
+} // namespace ns3
@@ -0,0 +1,66 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 Andrey Churin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrey Churin <aachurin@gmail.com>
+ */
+
+#ifndef ETHERNET_VLAN_TAG_H
+#define ETHERNET_VLAN_TAG_H
+
+#include "ns3/tag.h"
+
+namespace ns3 {
+
+/**
+ * \brief Packet tag carrying the VLAN and priority a frame belongs to.
+ *
+ * A VLAN-aware EthernetNetDevice puts it on every frame it receives, from
+ * the 802.1Q header or from its port VLAN for untagged frames, and reads
+ * it on every frame it sends to decide whether and how to tag it.  A
+ * packet sent without it belongs to the port VLAN of the device.
+ */
+class EthernetVlanTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  EthernetVlanTag ();
+  /**
+   * @param vid the VLAN identifier, 1 to 4094
+   * @param pcp the priority code point, 0 to 7
+   */
+  EthernetVlanTag (uint16_t vid, uint8_t pcp = 0);
+
+  void SetVid (uint16_t vid);
+  uint16_t GetVid (void) const;
+  void SetPcp (uint8_t pcp);
+  uint8_t GetPcp (void) const;
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+private:
+  uint16_t m_vid;
+  uint8_t m_pcp;
+};
+
+} // namespace ns3
+
+#endif /* ETHERNET_VLAN_TAG_H */